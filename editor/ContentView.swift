@@ -20,6 +20,13 @@ class EditorViewModel: ObservableObject {
     
     var undoManager: UndoManager?
     private var trackingTask: Task<Void, Never>?
+    // Bumped whenever in-flight tracking steps become stale (stop, seek, mask
+    // edit); a step only publishes if the generation it started in is current.
+    private var trackingGeneration = 0
+    
+    private func invalidateTracking() {
+        trackingGeneration += 1
+    }
     
     func log(_ message: String) {
         let timestamp = Date().formatted(.dateTime.hour().minute().second())
@@ -84,6 +91,8 @@ class EditorViewModel: ObservableObject {
     }
     
     func seek(to seconds: Double) {
+        if isTracking { stopTracking() }
+        invalidateTracking()
         let time = CMTime(seconds: seconds, preferredTimescale: 600)
         player?.seek(to: time, toleranceBefore: .zero, toleranceAfter: .zero)
     }
@@ -93,11 +102,13 @@ class EditorViewModel: ObservableObject {
         undoManager?.registerUndo(withTarget: self) { target in
             target.updatePoints(oldPoints)
         }
+        invalidateTracking()
         points.append(pt)
     }
     
     func movePoint(at index: Int, to newLocation: CGPoint) {
         guard index < points.count else { return }
+        invalidateTracking()
         points[index] = newLocation
     }
     
@@ -115,6 +126,7 @@ class EditorViewModel: ObservableObject {
         undoManager?.registerUndo(withTarget: self) { target in
             target.updatePoints(oldPoints)
         }
+        invalidateTracking()
         points = newPoints
     }
     
@@ -124,12 +136,14 @@ class EditorViewModel: ObservableObject {
         undoManager?.registerUndo(withTarget: self) { target in
             target.updatePoints(oldPoints)
         }
+        invalidateTracking()
         points.remove(at: index)
     }
     
     func stopTracking() {
         trackingTask?.cancel()
         trackingTask = nil
+        invalidateTracking()
         isTracking = false
         statusText = "⏹️ Stopped"
         log("Tracking stopped manually")
@@ -140,6 +154,7 @@ class EditorViewModel: ObservableObject {
             log("⚠️ Cannot track: player=\(player != nil), points.count=\(points.count)")
             return
         }
+        let generation = trackingGeneration
         log("🎯 === TRACKING STEP \(direction > 0 ? "FORWARD" : "BACKWARD") ===")
         log("Current points count: \(points.count)")
         
@@ -183,6 +198,10 @@ class EditorViewModel: ObservableObject {
             self.log("Seek finished: \(finished)")
             // Small delay to let the output catch up
             DispatchQueue.main.asyncAfter(deadline: .now() + 0.03) {
+                guard generation == self.trackingGeneration else {
+                    self.log("⏭️ Step superseded before tracking, skipped")
+                    return
+                }
                 guard let nextBuffer = self.videoOutput.copyPixelBuffer(forItemTime: nextTime, itemTimeForDisplay: nil) else {
                     self.log("❌ FAILED: Could not get pixel buffer for next frame (likely end/start of video)")
                     self.statusText = direction > 0 ? "🏁 End" : "⏪ Start"
@@ -219,6 +238,12 @@ class EditorViewModel: ObservableObject {
                             self.log("    Point[\(idx)] tracking failed (no observation), retaining old position.")
                         }
                     }
+                    // The user may have stopped, scrubbed or edited the mask
+                    // while Vision ran; those points belong to another state.
+                    guard generation == self.trackingGeneration else {
+                        self.log("⏭️ Step superseded while tracking, discarded")
+                        return
+                    }
                     self.points = newPoints // Direct update for tracking loop
                     self.currentTime = nextTime
                     self.statusText = "✅ Tracked \(successCount)/\(self.points.count)"
@@ -238,7 +263,7 @@ class EditorViewModel: ObservableObject {
         statusText = "Tracking ⏭️..."
         
         trackingTask = Task {
-            while isTracking {
+            while isTracking && !Task.isCancelled {
                 await MainActor.run { trackStep(direction: 1) }
                 try? await Task.sleep(nanoseconds: 100_000_000) // 0.1s
                 
@@ -259,7 +284,7 @@ class EditorViewModel: ObservableObject {
         statusText = "Tracking ⏮️..."
         
         trackingTask = Task {
-            while isTracking {
+            while isTracking && !Task.isCancelled {
                 await MainActor.run { trackStep(direction: -1) }
                 try? await Task.sleep(nanoseconds: 100_000_000)
                 
@@ -277,8 +302,16 @@ class EditorViewModel: ObservableObject {
     func trackFullAuto() {
         Task {
             log("🚀 Auto Track: Forward then Backward")
-            await MainActor.run { trackForward() }
+            // nil when the call stopped a track that was already running.
+            let started = await MainActor.run { () -> Int? in
+                trackForward()
+                return isTracking ? trackingGeneration : nil
+            }
+            guard let generation = started else { return }
             while isTracking { try? await Task.sleep(nanoseconds: 500_000_000) }
+            // Stopped by hand, or the playhead or mask changed: don't go on.
+            let current = await MainActor.run { trackingGeneration }
+            guard current == generation else { return }
             await MainActor.run { trackBackward() }
         }
     }
@@ -1,37 +1,99 @@
 #include <metal_stdlib>
+#include "gPHYXShaderTypes.h"
 using namespace metal;
 
+enum : uint { kSampleNearest = 0, kSampleBilinear = 1, kSampleBicubic = 2 };
+
+static float4 readClamped(texture2d<float, access::read> tex, int x, int y) {
+    x = clamp(x, 0, int(tex.get_width()) - 1);
+    y = clamp(y, 0, int(tex.get_height()) - 1);
+    return tex.read(uint2(x, y));
+}
+
+static float4 catmullRomWeights(float t) {
+    return float4(((-0.5 * t + 1.0) * t - 0.5) * t,
+                  (1.5 * t - 2.5) * t * t + 1.0,
+                  ((-1.5 * t + 2.0) * t + 0.5) * t,
+                  (0.5 * t - 0.5) * t * t);
+}
+
+// Same filters as the CPU samplers in gPHYXInpaintCPU.cpp: nearest truncates
+// the coordinate, the others sample at pixel centres with clamp-to-edge
+// neighbours.
+static float4 sampleReference(texture2d<float, access::read> tex, float2 pos,
+                              uint mode) {
+    if (mode == kSampleNearest) {
+        return tex.read(uint2(pos));
+    }
+    float2 uv = pos - 0.5;
+    float2 base = floor(uv);
+    float2 t = uv - base;
+    int2 b = int2(base);
+    if (mode == kSampleBilinear) {
+        float4 top = mix(readClamped(tex, b.x, b.y),
+                         readClamped(tex, b.x + 1, b.y), t.x);
+        float4 bottom = mix(readClamped(tex, b.x, b.y + 1),
+                            readClamped(tex, b.x + 1, b.y + 1), t.x);
+        return mix(top, bottom, t.y);
+    }
+    float4 wx = catmullRomWeights(t.x);
+    float4 wy = catmullRomWeights(t.y);
+    float4 acc = float4(0.0);
+    for (int j = 0; j < 4; j++) {
+        float4 row = float4(0.0);
+        for (int i = 0; i < 4; i++) {
+            row += readClamped(tex, b.x - 1 + i, b.y - 1 + j) * wx[i];
+        }
+        acc += row * wy[j];
+    }
+    return acc;
+}
+
 // Basic inpainting kernel (Placeholder for PatchMatch or Clean Plate logic)
 // Simply fills pixels within the mask using a solid color or simple blur for now
+// The grid only covers the non-empty mask tiles of params.regionSize, one
+// slice per tile; every other pixel keeps the passthrough copy already
+// written into destTexture.
 kernel void inpaint_kernel(texture2d<float, access::read>  sourceTexture  [[texture(0)]],
                            texture2d<float, access::write> destTexture    [[texture(1)]],
                            texture2d<float, access::read>  maskTexture    [[texture(2)]],
                            texture2d<float, access::read>  refTexture     [[texture(3)]],
                            constant float3x3 &homography                  [[buffer(0)]],
-                           uint2 gid [[thread_position_in_grid]])
+                           constant gPHYXInpaintParams &params            [[buffer(1)]],
+                           const device gPHYXMaskTile *tiles              [[buffer(2)]],
+                           uint3 tid [[thread_position_in_grid]])
 {
-    if (gid.x >= destTexture.get_width() || gid.y >= destTexture.get_height()) {
+    gPHYXMaskTile tile = tiles[tid.z];
+    uint2 lid = uint2(tile.origin) + tid.xy;
+    if (lid.x >= params.regionSize.x || lid.y >= params.regionSize.y) {
+        return;
+    }
+    uint2 pos = lid + params.regionOrigin;
+    uint2 gid = pos - params.destinationOrigin;
+    uint2 sid = pos - params.sourceOrigin;
+    if (gid.x >= destTexture.get_width() || gid.y >= destTexture.get_height() ||
+        sid.x >= sourceTexture.get_width() || sid.y >= sourceTexture.get_height()) {
         return;
     }
 
-    float4 maskColor = maskTexture.read(gid);
-    bool isInMask = maskColor.r > 0.5;
+    bool isInMask = tile.full != 0 || maskTexture.read(lid).r > 0.5;
 
     if (isInMask) {
-        // Map current pixel (gid) to reference frame using homography
-        float3 pos = float3(float(gid.x), float(gid.y), 1.0);
-        float3 mappedPos = homography * pos;
-        
-        uint2 refGid = uint2(mappedPos.x / mappedPos.z, mappedPos.y / mappedPos.z);
-        
-        if (refGid.x < refTexture.get_width() && refGid.y < refTexture.get_height()) {
-            destTexture.write(refTexture.read(refGid), gid);
+        // Map current pixel (image space) to reference frame using homography
+        float3 p = float3(float(pos.x), float(pos.y), 1.0);
+        float3 mappedPos = homography * p;
+        float2 refPos = mappedPos.xy / mappedPos.z - float2(params.referenceOrigin);
+
+        // Same test as the CPU path; also rejects NaN from z == 0.
+        if (refPos.x >= 0.0 && refPos.x < float(refTexture.get_width()) &&
+            refPos.y >= 0.0 && refPos.y < float(refTexture.get_height())) {
+            destTexture.write(sampleReference(refTexture, refPos, params.sampling), gid);
         } else {
             // Fallback: stay with source if out of bounds
-            destTexture.write(sourceTexture.read(gid), gid);
+            destTexture.write(sourceTexture.read(sid), gid);
         }
     } else {
         // Keep original
-        destTexture.write(sourceTexture.read(gid), gid);
+        destTexture.write(sourceTexture.read(sid), gid);
     }
 }
@@ -0,0 +1,161 @@
+#include "gPHYXBlit.h"
+#include "gPHYXParallel.h"
+#include "gPHYXPixel.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace gphyx {
+
+namespace {
+
+// Below this many bytes a single core is already memory-bound.
+const size_t kParallelBlitBytes = 256 * 1024;
+
+template <PixelFormat F> struct LoadRow {
+  static void run(const uint8_t *src, float *rgba, int32_t count) {
+    PixelTraits<F>::loadRow(src, rgba, count);
+  }
+};
+
+template <PixelFormat F> struct StoreRow {
+  static void run(const float *rgba, uint8_t *dst, int32_t count) {
+    PixelTraits<F>::storeRow(rgba, dst, count);
+  }
+};
+
+inline void keepPixels(float *, int32_t) {}
+
+// Converts `area` row by row; same-format copies are plain memcpys.
+template <PixelFormat S, PixelFormat D> struct BlitRows {
+  static void run(const ImageView &dst, const ImageView &src,
+                  const PixelRect &area, size_t begin, size_t end) {
+    const int32_t width = area.width();
+    const TypedView<S> s = typedView<S>(src);
+    const TypedView<D> d = typedView<D>(dst);
+    for (size_t i = begin; i < end; i++) {
+      const int32_t y = area.y0 + (int32_t)i;
+      const uint8_t *in = s.atImage(area.x0, y);
+      uint8_t *out = d.atImage(area.x0, y);
+      if (S == D) {
+        std::memcpy(out, in, (size_t)width * PixelTraits<S>::kBytes);
+        continue;
+      }
+      transformRow<S, D>(in, out, width, keepPixels);
+    }
+  }
+};
+
+template <PixelFormat S, PixelFormat D> struct DownsampleRows {
+  static void run(const ImageView &dst, const ImageView &src, int32_t factor,
+                  size_t begin, size_t end) {
+    const int32_t width = dst.width;
+    const float norm = 1.0f / (float)(factor * factor);
+    std::vector<float> in((size_t)width * factor * 4);
+    std::vector<float> acc((size_t)width * 4);
+    for (size_t i = begin; i < end; i++) {
+      std::fill(acc.begin(), acc.end(), 0.0f);
+      for (int32_t k = 0; k < factor; k++) {
+        PixelTraits<S>::loadRow(src.row((int32_t)i * factor + k), in.data(),
+                                width * factor);
+        for (int32_t x = 0; x < width; x++)
+          for (int32_t j = 0; j < factor; j++)
+            for (int c = 0; c < 4; c++)
+              acc[(size_t)x * 4 + c] += in[((size_t)x * factor + j) * 4 + c];
+      }
+      for (float &v : acc)
+        v *= norm;
+      PixelTraits<D>::storeRow(acc.data(), dst.row((int32_t)i), width);
+    }
+  }
+};
+
+template <PixelFormat S> struct LumaRows {
+  static void run(uint8_t *dst, size_t dstBytesPerRow, const ImageView &src,
+                  int32_t factor, int32_t width, size_t begin, size_t end) {
+    const float norm = 1.0f / (float)(factor * factor);
+    std::vector<float> in((size_t)width * factor * 4);
+    std::vector<float> acc((size_t)width);
+    for (size_t i = begin; i < end; i++) {
+      std::fill(acc.begin(), acc.end(), 0.0f);
+      for (int32_t k = 0; k < factor; k++) {
+        PixelTraits<S>::loadRow(src.row((int32_t)i * factor + k), in.data(),
+                                width * factor);
+        for (int32_t x = 0; x < width; x++)
+          for (int32_t j = 0; j < factor; j++)
+            acc[(size_t)x] += lumaOf(&in[((size_t)x * factor + j) * 4]);
+      }
+      uint8_t *d = dst + i * dstBytesPerRow;
+      for (int32_t x = 0; x < width; x++)
+        d[x] = PixelTraits<PixelFormat::BGRA8>::toByte(acc[(size_t)x] * norm);
+    }
+  }
+};
+
+} // namespace
+
+void loadRowRGBA(PixelFormat format, const uint8_t *src, float *rgba,
+                 int32_t count) {
+  dispatchFormat<LoadRow>(format, src, rgba, count);
+}
+
+void storeRowRGBA(PixelFormat format, const float *rgba, uint8_t *dst,
+                  int32_t count) {
+  dispatchFormat<StoreRow>(format, rgba, dst, count);
+}
+
+bool blitImage(const ImageView &dst, const ImageView &src,
+               const PixelRect *clip) {
+  if (!dst.valid() || !src.valid())
+    return false;
+
+  PixelRect area = intersectRects(dst.imageRect(), src.imageRect());
+  if (clip)
+    area = intersectRects(area, *clip);
+  if (area.empty())
+    return true;
+
+  const size_t srcBpp = bytesPerPixel(src.format);
+  const size_t dstBpp = bytesPerPixel(dst.format);
+  const size_t rowBytes =
+      (size_t)area.width() * (srcBpp > dstBpp ? srcBpp : dstBpp);
+  const size_t grain =
+      rowBytes >= kParallelBlitBytes ? 1 : kParallelBlitBytes / rowBytes;
+
+  parallelFor((size_t)area.height(), grain, [&](size_t begin, size_t end) {
+    dispatchFormats<BlitRows>(src.format, dst.format, dst, src, area, begin,
+                              end);
+  });
+  return true;
+}
+
+bool downsampleImage(const ImageView &dst, const ImageView &src,
+                     int32_t factor) {
+  if (!dst.valid() || !src.valid() || factor < 1 ||
+      dst.width != src.width / factor || dst.height != src.height / factor)
+    return false;
+
+  parallelFor((size_t)dst.height, 1, [&](size_t begin, size_t end) {
+    dispatchFormats<DownsampleRows>(src.format, dst.format, dst, src, factor,
+                                    begin, end);
+  });
+  return true;
+}
+
+bool downsampleLuma(uint8_t *dst, size_t dstBytesPerRow, const ImageView &src,
+                    int32_t factor) {
+  if (!dst || !src.valid() || factor < 1)
+    return false;
+  const int32_t width = src.width / factor;
+  const int32_t height = src.height / factor;
+  if (width <= 0 || height <= 0 || dstBytesPerRow < (size_t)width)
+    return false;
+
+  parallelFor((size_t)height, 1, [&](size_t begin, size_t end) {
+    dispatchFormat<LumaRows>(src.format, dst, dstBytesPerRow, src, factor,
+                             width, begin, end);
+  });
+  return true;
+}
+
+} // namespace gphyx
@@ -0,0 +1,37 @@
+#ifndef gPHYXBlit_h
+#define gPHYXBlit_h
+
+#include "gPHYXImage.h"
+
+namespace gphyx {
+
+// Copies the overlap of `src` and `dst` in image space (further limited to
+// `clip` when given) row by row, honouring each surface's stride and origin
+// and converting between BGRA8, RGBA16F and RGBA32F in the same pass. Rows
+// are spread across cores. Returns false if either view is unusable.
+bool blitImage(const ImageView &dst, const ImageView &src,
+               const PixelRect *clip = nullptr);
+
+// Box-filters `src` down by `factor` in each direction into `dst`, which
+// must be src.width / factor by src.height / factor (remainder rows and
+// columns are dropped). Formats may differ. Origins are ignored.
+bool downsampleImage(const ImageView &dst, const ImageView &src,
+                     int32_t factor);
+
+// Box-filters `src` down by `factor` into 8-bit luma (Rec. 709 weights,
+// clamped to [0, 1]) of src.width / factor by src.height / factor pixels.
+// Frames and plates are reduced to luma the same way for tracking, so both
+// sides of a registration match. Origins are ignored.
+bool downsampleLuma(uint8_t *dst, size_t dstBytesPerRow, const ImageView &src,
+                    int32_t factor);
+
+// Row converters between any supported format and interleaved float RGBA,
+// shared by the CPU kernels that work in float.
+void loadRowRGBA(PixelFormat format, const uint8_t *src, float *rgba,
+                 int32_t count);
+void storeRowRGBA(PixelFormat format, const float *rgba, uint8_t *dst,
+                  int32_t count);
+
+} // namespace gphyx
+
+#endif
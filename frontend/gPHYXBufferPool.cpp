@@ -0,0 +1,143 @@
+#include "gPHYXBufferPool.h"
+#include <list>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace gphyx {
+
+namespace {
+
+// Shared pool budget until the effect configures one.
+const size_t kDefaultPoolBytes = 512u << 20;
+
+} // namespace
+
+struct BufferPool::State {
+  struct Idle {
+    BufferShape shape;
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  mutable std::mutex mutex;
+  std::list<Idle> idle; // most recently released first
+  std::unordered_map<uint64_t, size_t> owners;
+  size_t budget;
+  size_t live = 0;
+  size_t idleBytes = 0;
+
+  void trimLocked(size_t limit) {
+    while (idleBytes > limit && !idle.empty()) {
+      idleBytes -= idle.back().shape.bytes();
+      idle.pop_back();
+    }
+  }
+
+  void release(PixelBlock *block) {
+    std::unique_ptr<PixelBlock> owned(block);
+    std::unique_ptr<uint8_t[]> data(block->data);
+    const size_t size = block->shape.bytes();
+    std::lock_guard<std::mutex> lock(mutex);
+    live -= size;
+    auto it = owners.find(block->owner);
+    if (it != owners.end() && (it->second -= size) == 0)
+      owners.erase(it);
+    if (!data || size > budget)
+      return;
+    idle.push_front(Idle{block->shape, std::move(data)});
+    idleBytes += size;
+    trimLocked(budget > live ? budget - live : 0);
+  }
+};
+
+ImageView PixelBlock::view(PixelFormat format) const {
+  ImageView v;
+  if (bytesPerPixel(format) != shape.bytesPerPixel)
+    return v;
+  v.data = data;
+  v.bytesPerRow = shape.bytesPerRow();
+  v.width = shape.width;
+  v.height = shape.height;
+  v.format = format;
+  return v;
+}
+
+BufferPool::BufferPool(size_t budgetBytes) : state_(std::make_shared<State>()) {
+  state_->budget = budgetBytes;
+}
+
+BufferPool::~BufferPool() { trim(0); }
+
+PooledBuffer BufferPool::acquire(const BufferShape &shape, uint64_t owner) {
+  const size_t size = shape.bytes();
+  if (shape.width <= 0 || shape.height <= 0 || size == 0)
+    return nullptr;
+
+  std::unique_ptr<uint8_t[]> data;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto it = state_->idle.begin(); it != state_->idle.end(); ++it) {
+      if (it->shape == shape) {
+        data = std::move(it->data);
+        state_->idle.erase(it);
+        state_->idleBytes -= size;
+        break;
+      }
+    }
+    // Make room for the new buffer among the waiting ones.
+    if (!data)
+      state_->trimLocked(state_->budget > state_->live + size
+                             ? state_->budget - state_->live - size
+                             : 0);
+    state_->live += size;
+    state_->owners[owner] += size;
+  }
+  if (!data)
+    data.reset(new (std::nothrow) uint8_t[size]);
+
+  PixelBlock *block = new PixelBlock();
+  block->shape = shape;
+  block->owner = owner;
+  block->data = data.release();
+  std::shared_ptr<State> state = state_;
+  PooledBuffer buffer(block, [state](PixelBlock *b) { state->release(b); });
+  // Dropping it undoes the accounting.
+  if (!block->data)
+    return nullptr;
+  return buffer;
+}
+
+void BufferPool::setBudget(size_t budgetBytes) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->budget = budgetBytes;
+  state_->trimLocked(budgetBytes > state_->live ? budgetBytes - state_->live
+                                                : 0);
+}
+
+void BufferPool::trim(size_t idleBytes) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->trimLocked(idleBytes);
+}
+
+size_t BufferPool::liveBytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->live;
+}
+
+size_t BufferPool::idleBytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->idleBytes;
+}
+
+size_t BufferPool::ownerBytes(uint64_t owner) const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  auto it = state_->owners.find(owner);
+  return it != state_->owners.end() ? it->second : 0;
+}
+
+BufferPool &sharedBufferPool() {
+  static BufferPool *pool = new BufferPool(kDefaultPoolBytes);
+  return *pool;
+}
+
+} // namespace gphyx
@@ -0,0 +1,82 @@
+#ifndef gPHYXBufferPool_h
+#define gPHYXBufferPool_h
+
+#include "gPHYXImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace gphyx {
+
+// Size and pixel size of a pooled buffer. Rows are packed.
+struct BufferShape {
+  int32_t width = 0;
+  int32_t height = 0;
+  uint32_t bytesPerPixel = 0;
+
+  size_t bytesPerRow() const { return (size_t)width * bytesPerPixel; }
+  size_t bytes() const { return bytesPerRow() * (size_t)height; }
+  bool operator==(const BufferShape &o) const {
+    return width == o.width && height == o.height &&
+           bytesPerPixel == o.bytesPerPixel;
+  }
+};
+
+inline BufferShape makeBufferShape(int32_t width, int32_t height,
+                                   PixelFormat format) {
+  BufferShape shape;
+  shape.width = width;
+  shape.height = height;
+  shape.bytesPerPixel = (uint32_t)bytesPerPixel(format);
+  return shape;
+}
+
+// A buffer checked out of a BufferPool. Contents are whatever its previous
+// user left.
+struct PixelBlock {
+  BufferShape shape;
+  uint64_t owner = 0;
+  uint8_t *data = nullptr;
+
+  ImageView view(PixelFormat format) const;
+};
+
+// Goes back to its pool when the last reference drops.
+typedef std::shared_ptr<PixelBlock> PooledBuffer;
+
+// Recycles pixel buffers between renders so temporaries of the same size and
+// format are not reallocated every frame. Buffers handed out are charged to
+// an owner (an effect instance, 0 for shared data) until released; released
+// ones wait for reuse, oldest trimmed first once handed-out and waiting
+// buffers together exceed the budget. Thread-safe; buffers may outlive the
+// pool.
+class BufferPool {
+public:
+  explicit BufferPool(size_t budgetBytes);
+  ~BufferPool();
+
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  // Null for an empty shape or when the allocation fails.
+  PooledBuffer acquire(const BufferShape &shape, uint64_t owner = 0);
+
+  void setBudget(size_t budgetBytes);
+  // Frees waiting buffers, oldest first, until at most `idleBytes` remain.
+  void trim(size_t idleBytes);
+
+  size_t liveBytes() const;  // handed out
+  size_t idleBytes() const;  // waiting for reuse
+  size_t ownerBytes(uint64_t owner) const;
+
+private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+// The pool all instances of the effect share.
+BufferPool &sharedBufferPool();
+
+} // namespace gphyx
+
+#endif
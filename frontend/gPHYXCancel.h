@@ -0,0 +1,37 @@
+#ifndef gPHYXCancel_h
+#define gPHYXCancel_h
+
+#include <atomic>
+#include <memory>
+
+namespace gphyx {
+
+// Cooperative cancellation of a background job. Whoever starts the job keeps
+// a copy of the token and cancels it once the result is no longer wanted
+// (the playhead jumped, the mask or plate changed, a newer job superseded
+// it); the stages poll cancelled() between chunks of work and give up
+// without publishing anything. Copies share one flag. A default token is
+// never cancelled.
+class CancelToken {
+public:
+  static CancelToken make() {
+    CancelToken token;
+    token.flag_ = std::make_shared<std::atomic<bool>>(false);
+    return token;
+  }
+
+  void cancel() const {
+    if (flag_)
+      flag_->store(true, std::memory_order_relaxed);
+  }
+  bool cancelled() const {
+    return flag_ && flag_->load(std::memory_order_relaxed);
+  }
+
+private:
+  std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+} // namespace gphyx
+
+#endif
@@ -1,4 +1,5 @@
 #import "gPHYXClient.h"
+#import "gPHYXSurface.h"
 #import <AppKit/AppKit.h>
 #import <IOSurface/IOSurfaceObjC.h>
 
@@ -13,23 +14,36 @@
 }
 
 - (NSData *)dataFromTile:(FxImageTile *)tile {
-  IOSurface *surface = tile.ioSurface;
+  IOSurfaceRef surface = (__bridge IOSurfaceRef)tile.ioSurface;
   if (!surface)
     return nil;
 
-  size_t width = surface.width;
-  size_t height = surface.height;
-  size_t bpr = surface.bytesPerRow;
-  void *base = surface.baseAddress;
-
-  [surface lockWithOptions:kIOSurfaceLockReadOnly seed:NULL];
+  IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+  gphyx::ImageView src = gPHYXImageViewForTile(nil, surface);
+  if (!src.valid()) {
+    IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+    return nil;
+  }
+  // 8-bit BGRA is encoded in place; float tiles are converted to it first,
+  // through a pooled buffer.
+  gphyx::ImageView bgra = src;
+  gphyx::PooledBuffer converted;
+  if (src.format != gphyx::PixelFormat::BGRA8) {
+    converted = gphyx::sharedBufferPool().acquire(gphyx::makeBufferShape(
+        src.width, src.height, gphyx::PixelFormat::BGRA8));
+    if (converted)
+      bgra = converted->view(gphyx::PixelFormat::BGRA8);
+    if (!converted || !gphyx::blitImage(bgra, src)) {
+      IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+      return nil;
+    }
+  }
 
-  // Create BitmapRep. Assuming BGRA 8-bit for simplicity as typical in FCP XPC
-  // transitions
+  unsigned char *planes[1] = {(unsigned char *)bgra.data};
   NSBitmapImageRep *rep = [[NSBitmapImageRep alloc]
-      initWithBitmapDataPlanes:NULL
-                    pixelsWide:width
-                    pixelsHigh:height
+      initWithBitmapDataPlanes:planes
+                    pixelsWide:bgra.width
+                    pixelsHigh:bgra.height
                  bitsPerSample:8
                samplesPerPixel:4
                       hasAlpha:YES
@@ -37,14 +51,14 @@
                 colorSpaceName:NSDeviceRGBColorSpace
                   bitmapFormat:NSBitmapFormatAlphaFirst |
                                NSBitmapFormatThirtyTwoBitLittleEndian
-                   bytesPerRow:bpr
+                   bytesPerRow:bgra.bytesPerRow
                   bitsPerPixel:32];
 
-  memcpy(rep.bitmapData, base, bpr * height);
-  [surface unlockWithOptions:kIOSurfaceLockReadOnly seed:NULL];
-
-  return [rep representationUsingType:NSBitmapImageFileTypeJPEG
-                           properties:@{NSImageCompressionFactor : @0.7}];
+  NSData *jpeg =
+      [rep representationUsingType:NSBitmapImageFileTypeJPEG
+                        properties:@{NSImageCompressionFactor : @0.7}];
+  IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+  return jpeg;
 }
 
 - (void)initializeTrackingWithFrame:(FxImageTile *)tile
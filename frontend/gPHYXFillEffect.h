@@ -6,27 +6,9 @@
 @class gPHYXOsc;
 @class gPHYXVisionTracker;
 
-@interface gPHYXFillEffect : NSObject <FxTileableEffect, FxAnalyzer> {
-  id<PROAPIAccessing> _apiManager;
-  gPHYXOsc *_osc;
-  BOOL _isTracking;
-  BOOL _shouldInitTracking;
-  BOOL _shouldInpaint;
-  float _currentMatrix[9];
-
-  // Metal
-  id<MTLDevice> _device;
-  id<MTLComputePipelineState> _inpaintPipeline;
-  id<MTLCommandQueue> _commandQueue;
-
-  // Vision & Tracking
-  gPHYXVisionTracker *_visionTracker;
-  CVPixelBufferRef _referenceBuffer;
-  float _homography[9];
-
-  // Analysis Cache
-  NSMutableDictionary<NSNumber *, NSData *> *_homographyCache;
-}
+// Per-render state lives in a stack-local render context and per-instance
+// state in the shared registry, so renders may run concurrently.
+@interface gPHYXFillEffect : NSObject <FxTileableEffect, FxAnalyzer>
 
 @property(nonatomic, assign) NSInteger referenceFrameIndex;
 @property(nonatomic, assign) BOOL shouldSetReferenceFrame;
@@ -1,9 +1,34 @@
 #import "gPHYXFillEffect.h"
+#import "gPHYXBlit.h"
+#import "gPHYXBufferPool.h"
+#import "gPHYXCancel.h"
+#import "gPHYXFillStore.h"
 #import "gPHYXFillXPC-Swift.h"
+#import "gPHYXFootprint.h"
+#import "gPHYXFrameIndex.h"
+#import "gPHYXHash.h"
+#import "gPHYXHomography.h"
+#import "gPHYXHomographyStore.h"
+#import "gPHYXInpaintCPU.h"
+#import "gPHYXPrefetcher.h"
+#import "gPHYXRegion.h"
+#import "gPHYXShaderTypes.h"
+#import "gPHYXSnapshot.h"
+#import "gPHYXSurface.h"
+#import "gPHYXTiledImage.h"
+#import "gPHYXTrace.h"
+#import "gPHYXTrackFile.h"
+#import "gPHYXTrackingService.h"
 #import <CoreVideo/CVPixelBuffer.h>
 #import <CoreVideo/CVPixelBufferIOSurface.h>
 #import <Metal/Metal.h>
 #import <PluginManager/PROAPIAccessing.h>
+#import <algorithm>
+#import <atomic>
+#import <list>
+#import <os/lock.h>
+#import <string>
+#import <unordered_map>
 #import <vector>
 
 enum {
@@ -12,7 +37,8 @@ enum {
   kParam_TrackBtn = 10,
   kParam_ClearBtn = 11,
   kParam_ShowOSC = 12,
-  kParam_InpaintBtn = 13,
+  // 13 was the Inpaint button; saved projects may still hold it, so the ID
+  // is not reused.
   kParam_OpenEditor = 14,
   kParam_SourceVideo = 15,
 
@@ -25,53 +51,993 @@ enum {
   kParam_FitROIBtn = 25,
   kParam_DropZone = 30,
   kParam_Status = 40,
-  kParam_InstanceID = 50
+  kParam_InstanceID = 50,
+  kParam_Refresh = 60
 };
 
+// Cached samples this close to a requested time count as that time, so
+// render and analysis times that differ by rounding still match.
+static const double kHomographyTimeTolerance = 0.0001;
+
+// How a homography estimate relates to the tracked samples.
+// Only samples current for the plate and ROI count as tracked here; stale
+// ones still serve as the estimate.
+typedef struct {
+  BOOL exact;      // a tracked sample at this very time
+  BOOL bracketed;  // blended from tracked samples on both sides
+  double distance; // seconds to the nearest tracked sample
+} gPHYXHomographyMatch;
+
+static inline gphyx::MediaTime MediaTimeFromCMTime(CMTime time) {
+  gphyx::MediaTime t;
+  t.value = time.value;
+  t.timescale = time.timescale;
+  return t;
+}
+
+// Content fingerprint of a captured plate, taken from every row of its
+// full-resolution luma (what tracking registers against). Stable across
+// plugin restarts, so sidecar samples stay valid when the same frame is
+// captured again.
+static uint64_t ReferenceSignature(CVPixelBufferRef luma) {
+  if (!luma)
+    return 0;
+  CVPixelBufferLockBaseAddress(luma, kCVPixelBufferLock_ReadOnly);
+  const uint8_t *base = (const uint8_t *)CVPixelBufferGetBaseAddress(luma);
+  const size_t bytesPerRow = CVPixelBufferGetBytesPerRow(luma);
+  const int32_t width = (int32_t)CVPixelBufferGetWidth(luma);
+  const int32_t height = (int32_t)CVPixelBufferGetHeight(luma);
+  uint64_t h = gphyx::hashBytes(&width, sizeof(width));
+  h = gphyx::hashBytes(&height, sizeof(height), h);
+  if (base) {
+    for (int32_t y = 0; y < height; y++)
+      h = gphyx::hashBytesFast(base + (size_t)y * bytesPerRow, (size_t)width,
+                               h);
+  }
+  CVPixelBufferUnlockBaseAddress(luma, kCVPixelBufferLock_ReadOnly);
+  return h;
+}
+
+// Every row of `view`'s pixels, row padding left out, chained on `seed`.
+static uint64_t HashImageRows(const gphyx::ImageView &view, uint64_t seed) {
+  if (!view.valid())
+    return seed;
+  const size_t rowBytes =
+      (size_t)view.width * gphyx::bytesPerPixel(view.format);
+  uint64_t h = gphyx::hashBytes(&view.format, sizeof(view.format), seed);
+  for (int32_t y = 0; y < view.height; y++)
+    h = gphyx::hashBytesFast(view.row(y), rowBytes, h);
+  return h;
+}
+
+// What a tracked sample depends on: the plate it was registered against, the
+// ROI Vision was restricted to and how far both were downsampled. Full
+// resolution leaves the signature as it was before tiers existed.
+static uint64_t TrackingSignature(uint64_t referenceSignature, CGRect roi,
+                                  int32_t downsample = 1) {
+  const float r[4] = {(float)roi.origin.x, (float)roi.origin.y,
+                      (float)roi.size.width, (float)roi.size.height};
+  uint64_t h = gphyx::hashBytes(r, sizeof(r), referenceSignature);
+  return downsample > 1 ? gphyx::hashBytes(&downsample, sizeof(downsample), h)
+                        : h;
+}
+
+// Pixels (top-left origin) of a normalized tracking ROI, which like Vision's
+// regionOfInterest has its origin at the bottom left.
+static gphyx::PixelRect PixelRectForROI(CGRect roi, int32_t width,
+                                        int32_t height) {
+  gphyx::PixelRect r;
+  r.x0 = (int32_t)floor(CGRectGetMinX(roi) * width);
+  r.x1 = (int32_t)ceil(CGRectGetMaxX(roi) * width);
+  r.y0 = (int32_t)floor((1.0 - CGRectGetMaxY(roi)) * height);
+  r.y1 = (int32_t)ceil((1.0 - CGRectGetMinY(roi)) * height);
+  return gphyx::intersectRects(r, gphyx::makePixelRect(0, 0, width, height));
+}
+
+// Distinct frame contents remembered per instance for deduplication.
+static const size_t kFrameIndexCapacity = 4096;
+
+// What a fill depends on besides its frame time; a prefetched or stored
+// patch is only used when the render would have produced exactly the same
+// fill.
+static gphyx::FillKey FillKeyFor(uint64_t referenceSignature,
+                                 const float *homography, uint64_t maskShape,
+                                 NSUInteger width, NSUInteger height,
+                                 gphyx::PixelFormat format,
+                                 gphyx::SampleMode sampling) {
+  const uint64_t geometry[4] = {(uint64_t)width, (uint64_t)height,
+                                (uint64_t)format, (uint64_t)sampling};
+  gphyx::FillKey key;
+  key.content = referenceSignature;
+  key.mask = maskShape;
+  key.params = gphyx::hashBytes(
+      geometry, sizeof(geometry),
+      gphyx::hashBytes(homography, sizeof(float) * 9));
+  return key;
+}
+
+// --- REFERENCE PLATE ---
+// Reductions a plate keeps luma for: those of the quality tiers.
+static const int32_t kPlateLumaFactors[] = {1, 2, 4};
+static const int kPlateLumaLevels = 3;
+
+// Whether a sample was tracked against this plate and ROI, at any tier.
+static BOOL IsCurrentSignature(uint64_t signature, uint64_t referenceSignature,
+                               CGRect roi) {
+  for (int32_t factor : kPlateLumaFactors)
+    if (signature == TrackingSignature(referenceSignature, roi, factor))
+      return YES;
+  return NO;
+}
+// Least margin kept in colour around the mask region at capture.
+static const int32_t kPlateMinMarginPx = 256;
+
+// A captured reference frame in memory the instance owns, so no host surface
+// is retained past the render that captured it: luma at the tracking
+// reductions, which Vision registers against as is, and a colour copy of the
+// part of the frame fills sample from. Fills that warp outside that part
+// keep the source there, as they do outside the frame. The CPU fill reads the
+// colour through a blocked copy made at capture. Immutable.
+@interface gPHYXReferencePlate : NSObject
+@property(nonatomic, readonly) uint64_t signature;
+// What fills sampled from the plate depend on: its content and colour part.
+@property(nonatomic, readonly) uint64_t fillSignature;
+// Where the colour copy sits in the frame (top-left origin).
+@property(nonatomic, readonly) gphyx::PixelRect colorRegion;
+
+// `surface` holds the whole frame. nil if it can't be copied.
+- (instancetype)initWithSurface:(IOSurfaceRef)surface
+                    colorRegion:(gphyx::PixelRect)region;
+// Valid while the plate is.
+- (IOSurfaceRef)colorSurface;
+// Blocked copy of the colour surface; null if it couldn't be made.
+- (const gphyx::TiledImage *)tiledColor;
+// NULL for a reduction the plate has no luma for.
+- (CVPixelBufferRef)copyLumaDownsampledBy:(int32_t)factor CF_RETURNS_RETAINED;
+- (size_t)bytes;
+@end
+
+@implementation gPHYXReferencePlate {
+  CVPixelBufferRef _color;
+  CVPixelBufferRef _luma[kPlateLumaLevels];
+  gphyx::TiledImage _tiledColor;
+}
+
+- (instancetype)initWithSurface:(IOSurfaceRef)surface
+                    colorRegion:(gphyx::PixelRect)region {
+  if (!(self = [super init]))
+    return nil;
+  _color = gPHYXCreatePixelBufferCopy(surface, region);
+  for (int i = 0; i < kPlateLumaLevels; i++)
+    _luma[i] = gPHYXCreateLumaCopy(surface, kPlateLumaFactors[i]);
+  if (!_color || !_luma[0])
+    return nil;
+  _colorRegion = gphyx::intersectRects(
+      region, gphyx::makePixelRect(0, 0, (int32_t)IOSurfaceGetWidth(surface),
+                                   (int32_t)IOSurfaceGetHeight(surface)));
+  _signature = ReferenceSignature(_luma[0]);
+  // Fills sample the colour, which the luma signature doesn't pin down.
+  IOSurfaceRef color = CVPixelBufferGetIOSurface(_color);
+  IOSurfaceLock(color, kIOSurfaceLockReadOnly, NULL);
+  gphyx::ImageView colorView = gPHYXImageViewForTile(nil, color);
+  gphyx::tileImage(colorView, _tiledColor);
+  _fillSignature = HashImageRows(
+      colorView,
+      gphyx::hashBytes(&_colorRegion, sizeof(_colorRegion), _signature));
+  IOSurfaceUnlock(color, kIOSurfaceLockReadOnly, NULL);
+  return self;
+}
+
+- (IOSurfaceRef)colorSurface {
+  return CVPixelBufferGetIOSurface(_color);
+}
+
+- (const gphyx::TiledImage *)tiledColor {
+  return _tiledColor.valid() ? &_tiledColor : nullptr;
+}
+
+- (CVPixelBufferRef)copyLumaDownsampledBy:(int32_t)factor {
+  for (int i = 0; i < kPlateLumaLevels; i++)
+    if (kPlateLumaFactors[i] == factor && _luma[i])
+      return CVPixelBufferRetain(_luma[i]);
+  return NULL;
+}
+
+- (size_t)bytes {
+  size_t bytes = CVPixelBufferGetDataSize(_color) + _tiledColor.bytes();
+  for (CVPixelBufferRef luma : _luma)
+    if (luma)
+      bytes += CVPixelBufferGetDataSize(luma);
+  return bytes;
+}
+
+- (void)dealloc {
+  if (_color)
+    CFRelease(_color);
+  for (CVPixelBufferRef luma : _luma)
+    if (luma)
+      CFRelease(luma);
+}
+@end
+
 // --- SHARED REGISTRY ---
+// Renders for the same instance may run on several threads at once, so all
+// mutable state is behind accessors guarded by a per-instance lock.
 @interface gPHYXSharedData : NSObject
-@property(nonatomic, assign) NSInteger referenceFrame;
-@property(nonatomic, retain)
-    NSMutableDictionary<NSNumber *, NSData *> *homographyCache;
-@property(nonatomic, assign) CVPixelBufferRef referenceBuffer;
-@property(nonatomic, assign) BOOL isTracking;
-@property(nonatomic, retain)
+// Buffers made for this instance are charged to it in the shared pool.
+@property(nonatomic, readonly) uint64_t bufferOwner;
+@property(atomic, assign) NSInteger referenceFrame;
+@property(atomic, assign) BOOL isTracking;
+@property(atomic, strong)
     NSArray<NSValue *> *maskPoints; // New: Points from Editor
-@property(nonatomic, assign)
+@property(atomic, assign)
     NSTimeInterval lastJSONLoadTime; // New: For polling
+
+- (instancetype)initWithBufferOwner:(uint64_t)owner;
+
+// The captured plate; nil until one is captured.
+- (gPHYXReferencePlate *)referencePlate;
+- (void)setReferencePlate:(gPHYXReferencePlate *)plate;
+- (uint64_t)referenceSignature;
+
+- (BOOL)getHomography:(float *)outMatrix atTime:(CMTime)time;
+// Exact sample if there is one, else a blend of the nearest samples around
+// `time` (or the only one on one side). NO when nothing has been tracked.
+// `match` tells whether the samples used are current for `roi`.
+- (BOOL)estimateHomography:(float *)outMatrix
+                    atTime:(CMTime)time
+                       roi:(CGRect)roi
+                 frameSize:(CGSize)frameSize
+                     match:(gPHYXHomographyMatch *)match;
+// `downsample` is how far the frame and plate were reduced for tracking.
+- (void)setHomography:(const float *)matrix
+              atTime:(CMTime)time
+          confidence:(float)confidence
+                 roi:(CGRect)roi
+          downsample:(int32_t)downsample;
+- (void)getLatestHomography:(float *)outMatrix;
+// Frames already tracked, by content. A repeat of one takes over its sample
+// (if it is current for `roi`, tracked at full resolution or `downsample`)
+// and YES is returned with the matrix.
+- (void)noteFrameContent:(const gphyx::FrameContent &)content
+                  atTime:(CMTime)time;
+- (BOOL)reuseHomography:(float *)outMatrix
+             forContent:(const gphyx::FrameContent &)content
+                 atTime:(CMTime)time
+                    roi:(CGRect)roi
+             downsample:(int32_t)downsample;
+// YES if the sample at `time` was tracked against the current plate with
+// this ROI at full resolution, i.e. tracking the frame again would reproduce
+// it.
+- (BOOL)hasCurrentHomographyAtTime:(CMTime)time roi:(CGRect)roi;
+- (void)removeAllHomographies;
+
+// Persists tracked samples to `path` and reloads them on first use. Binding
+// a file for other source media drops the samples held so far.
+- (void)bindTrackFileAtPath:(NSString *)path
+             sourceIdentity:(uint64_t)sourceIdentity;
+
+// How often the fill of the frame at `time` was refined in the background.
+// It goes into that frame's plugin state, so the host renders only that
+// frame again.
+- (int32_t)refinementAtTime:(CMTime)time;
+- (void)noteRefinementAtTime:(CMTime)time;
+
+// Registry bookkeeping: when the instance was last looked up and roughly how
+// much memory it holds.
+- (void)touch;
+- (double)lastUsed;
+- (size_t)residentBytes;
+// Drops what can be rebuilt: remembered frame contents and, once they are in
+// the sidecar, the tracked samples (reloaded on next use). The captured
+// plate stays. Returns the bytes released.
+- (size_t)spill;
 @end
 
-@implementation gPHYXSharedData
-- (instancetype)init {
+@implementation gPHYXSharedData {
+  os_unfair_lock _lock; // reference plate and latest homography
+  gPHYXReferencePlate *_referencePlate;
+  float _latestHomography[9];
+  // Lock-free for readers; has its own writer lock.
+  gphyx::HomographyStore _homographies;
+  std::shared_ptr<gphyx::TrackFile> _trackFile; // guarded by _lock
+  std::atomic<bool> _trackLoaded;
+  std::unique_ptr<gphyx::FrameIndex> _frames; // has its own lock
+  std::atomic<double> _lastUsed;
+  // Refinement counts by frame time hash; guarded by _lock.
+  std::unordered_map<uint64_t, int32_t> _refinements;
+  std::list<uint64_t> _refinementOrder; // time hashes, oldest first
+}
+
+- (instancetype)initWithBufferOwner:(uint64_t)owner {
   if (self = [super init]) {
-    _homographyCache = [NSMutableDictionary dictionary];
+    _bufferOwner = owner;
+    _lock = OS_UNFAIR_LOCK_INIT;
     _isTracking = NO;
+    _trackLoaded = true; // nothing to load until a file is bound
+    _lastUsed = CFAbsoluteTimeGetCurrent();
+    _frames.reset(new gphyx::FrameIndex(kFrameIndexCapacity));
+    for (int i = 0; i < 9; i++)
+      _latestHomography[i] = (i % 4 == 0) ? 1.0f : 0.0f;
   }
   return self;
 }
-- (void)setReferenceBuffer:(CVPixelBufferRef)ref {
-  if (_referenceBuffer)
-    CFRelease(_referenceBuffer);
-  if (ref)
-    CFRetain(ref);
-  _referenceBuffer = ref;
+
+- (gPHYXReferencePlate *)referencePlate {
+  os_unfair_lock_lock(&_lock);
+  gPHYXReferencePlate *plate = _referencePlate;
+  os_unfair_lock_unlock(&_lock);
+  return plate;
 }
-- (void)dealloc {
-  if (_referenceBuffer)
-    CFRelease(_referenceBuffer);
+
+- (void)setReferencePlate:(gPHYXReferencePlate *)plate {
+  os_unfair_lock_lock(&_lock);
+  // The old plate goes with `old`, outside the lock.
+  gPHYXReferencePlate *old = _referencePlate;
+  _referencePlate = plate;
+  os_unfair_lock_unlock(&_lock);
+  (void)old;
+}
+
+- (uint64_t)referenceSignature {
+  return [self referencePlate].signature;
+}
+
+- (std::shared_ptr<gphyx::TrackFile>)trackFile {
+  os_unfair_lock_lock(&_lock);
+  std::shared_ptr<gphyx::TrackFile> file = _trackFile;
+  os_unfair_lock_unlock(&_lock);
+  return file;
+}
+
+- (void)bindTrackFileAtPath:(NSString *)path
+             sourceIdentity:(uint64_t)sourceIdentity {
+  auto file =
+      std::make_shared<gphyx::TrackFile>(path.UTF8String, sourceIdentity);
+  os_unfair_lock_lock(&_lock);
+  BOOL same = _trackFile && _trackFile->path() == file->path() &&
+              _trackFile->sourceIdentity() == sourceIdentity;
+  BOOL rebound = _trackFile != nullptr && !same;
+  if (!same)
+    _trackFile = file;
+  os_unfair_lock_unlock(&_lock);
+  if (same)
+    return;
+  if (rebound)
+    _homographies.clear();
+  _trackLoaded = false;
+}
+
+// Maps the sidecar into the store the first time anyone looks a sample up.
+// Lookups racing the load just see an empty track for a moment.
+- (void)loadTrackIfNeeded {
+  if (_trackLoaded.load(std::memory_order_acquire))
+    return;
+  bool expected = false;
+  if (!_trackLoaded.compare_exchange_strong(expected, true))
+    return;
+  std::shared_ptr<gphyx::TrackFile> file = [self trackFile];
+  std::vector<gphyx::TrackRecord> records;
+  if (!file || !file->load(records) || records.empty())
+    return;
+
+  std::vector<gphyx::HomographySample> samples;
+  samples.reserve(records.size());
+  for (const gphyx::TrackRecord &record : records)
+    samples.push_back(record.sample);
+  _homographies.insertBatch(std::move(samples));
+  os_unfair_lock_lock(&_lock);
+  memcpy(_latestHomography, records.back().sample.matrix.data(),
+         sizeof(_latestHomography));
+  os_unfair_lock_unlock(&_lock);
+  NSLog(@"[gPHYX] 💾 Loaded %lu tracked frames from %s",
+        (unsigned long)records.size(), file->path().c_str());
+}
+
+- (BOOL)getHomography:(float *)outMatrix atTime:(CMTime)time {
+  [self loadTrackIfNeeded];
+  gphyx::Matrix3 h;
+  if (!_homographies.snapshot()->find(MediaTimeFromCMTime(time),
+                                      kHomographyTimeTolerance, &h))
+    return NO;
+  memcpy(outMatrix, h.data(), sizeof(float) * 9);
+  return YES;
+}
+
+- (BOOL)estimateHomography:(float *)outMatrix
+                    atTime:(CMTime)time
+                       roi:(CGRect)roi
+                 frameSize:(CGSize)frameSize
+                     match:(gPHYXHomographyMatch *)match {
+  *match = gPHYXHomographyMatch{};
+  [self loadTrackIfNeeded];
+  std::shared_ptr<const gphyx::HomographyTrack> track =
+      _homographies.snapshot();
+  gphyx::MediaTime t = MediaTimeFromCMTime(time);
+  uint64_t reference = [self referenceSignature];
+
+  // A sample from before a recapture or ROI change is where the frame was,
+  // not where it is: used, but not reported as tracked.
+  gphyx::HomographySample sample;
+  if (track->find(t, kHomographyTimeTolerance, &sample)) {
+    memcpy(outMatrix, sample.matrix.data(), sizeof(float) * 9);
+    match->exact = IsCurrentSignature(sample.signature, reference, roi);
+    return YES;
+  }
+
+  gphyx::HomographyTrack::Neighbours n = track->neighbours(t);
+  if (!n.hasBefore && !n.hasAfter)
+    return NO;
+  double currentSec = t.seconds();
+  double toBefore =
+      n.hasBefore ? currentSec - n.before.time.seconds() : INFINITY;
+  double toAfter = n.hasAfter ? n.after.time.seconds() - currentSec : INFINITY;
+  match->distance = fmin(toBefore, toAfter);
+  if (n.hasBefore && n.hasAfter) {
+    double t01 = toBefore / (toBefore + toAfter);
+    if (gphyx::interpolateHomography(n.before.matrix.data(),
+                                     n.after.matrix.data(), t01,
+                                     frameSize.width, frameSize.height,
+                                     outMatrix)) {
+      match->bracketed =
+          IsCurrentSignature(n.before.signature, reference, roi) &&
+          IsCurrentSignature(n.after.signature, reference, roi);
+      return YES;
+    }
+  }
+  // One-sided, or the blend was degenerate: hold the nearest sample.
+  const gphyx::Matrix3 &nearest =
+      toBefore <= toAfter ? n.before.matrix : n.after.matrix;
+  memcpy(outMatrix, nearest.data(), sizeof(float) * 9);
+  return YES;
+}
+
+- (void)storeRecord:(gphyx::TrackRecord &)record roi:(CGRect)roi {
+  _homographies.insert(record.sample);
+  os_unfair_lock_lock(&_lock);
+  memcpy(_latestHomography, record.sample.matrix.data(),
+         sizeof(_latestHomography));
+  std::shared_ptr<gphyx::TrackFile> file = _trackFile;
+  os_unfair_lock_unlock(&_lock);
+
+  if (file) {
+    record.roi[0] = roi.origin.x;
+    record.roi[1] = roi.origin.y;
+    record.roi[2] = roi.size.width;
+    record.roi[3] = roi.size.height;
+    file->append(record);
+  }
+}
+
+- (void)setHomography:(const float *)matrix
+              atTime:(CMTime)time
+          confidence:(float)confidence
+                 roi:(CGRect)roi
+          downsample:(int32_t)downsample {
+  [self loadTrackIfNeeded];
+  gphyx::TrackRecord record;
+  record.sample.time = MediaTimeFromCMTime(time);
+  record.sample.confidence = confidence;
+  record.sample.signature =
+      TrackingSignature([self referenceSignature], roi, downsample);
+  memcpy(record.sample.matrix.data(), matrix, sizeof(float) * 9);
+  [self storeRecord:record roi:roi];
+}
+
+- (void)noteFrameContent:(const gphyx::FrameContent &)content
+                  atTime:(CMTime)time {
+  _frames->insert(content, MediaTimeFromCMTime(time));
+}
+
+- (BOOL)reuseHomography:(float *)outMatrix
+             forContent:(const gphyx::FrameContent &)content
+                 atTime:(CMTime)time
+                    roi:(CGRect)roi
+             downsample:(int32_t)downsample {
+  gphyx::MediaTime first;
+  if (!_frames->find(content, &first))
+    return NO;
+  [self loadTrackIfNeeded];
+  gphyx::HomographySample sample;
+  if (!_homographies.snapshot()->find(first, kHomographyTimeTolerance,
+                                      &sample))
+    return NO;
+  uint64_t reference = [self referenceSignature];
+  if (sample.signature != TrackingSignature(reference, roi) &&
+      sample.signature != TrackingSignature(reference, roi, downsample))
+    return NO;
+
+  gphyx::TrackRecord record;
+  record.sample = sample;
+  record.sample.time = MediaTimeFromCMTime(time);
+  [self storeRecord:record roi:roi];
+  memcpy(outMatrix, sample.matrix.data(), sizeof(float) * 9);
+  return YES;
+}
+
+- (void)getLatestHomography:(float *)outMatrix {
+  os_unfair_lock_lock(&_lock);
+  memcpy(outMatrix, _latestHomography, sizeof(_latestHomography));
+  os_unfair_lock_unlock(&_lock);
+}
+
+- (BOOL)hasCurrentHomographyAtTime:(CMTime)time roi:(CGRect)roi {
+  [self loadTrackIfNeeded];
+  gphyx::HomographySample sample;
+  if (!_homographies.snapshot()->find(MediaTimeFromCMTime(time),
+                                      kHomographyTimeTolerance, &sample))
+    return NO;
+  return sample.signature ==
+         TrackingSignature([self referenceSignature], roi);
+}
+
+- (void)removeAllHomographies {
+  _homographies.clear();
+  std::shared_ptr<gphyx::TrackFile> file = [self trackFile];
+  if (file)
+    file->reset();
+}
+
+static uint64_t HashTime(CMTime time) {
+  const int64_t t[2] = {time.value, (int64_t)time.timescale};
+  return gphyx::hashBytes(t, sizeof(t));
+}
+
+- (int32_t)refinementAtTime:(CMTime)time {
+  os_unfair_lock_lock(&_lock);
+  auto it = _refinements.find(HashTime(time));
+  int32_t count = it != _refinements.end() ? it->second : 0;
+  os_unfair_lock_unlock(&_lock);
+  return count;
+}
+
+- (void)noteRefinementAtTime:(CMTime)time {
+  os_unfair_lock_lock(&_lock);
+  const uint64_t key = HashTime(time);
+  auto it = _refinements.find(key);
+  if (it == _refinements.end()) {
+    _refinementOrder.push_back(key);
+    it = _refinements.emplace(key, 0).first;
+  }
+  it->second = it->second == INT32_MAX ? 1 : it->second + 1;
+  // Bounded like the frame index, oldest first; forgetting a frame only
+  // risks its cached coarse render being shown again.
+  while (_refinements.size() > kFrameIndexCapacity) {
+    _refinements.erase(_refinementOrder.front());
+    _refinementOrder.pop_front();
+  }
+  os_unfair_lock_unlock(&_lock);
+}
+
+- (void)touch {
+  _lastUsed.store(CFAbsoluteTimeGetCurrent(), std::memory_order_relaxed);
+}
+
+- (double)lastUsed {
+  return _lastUsed.load(std::memory_order_relaxed);
+}
+
+- (size_t)residentBytes {
+  return [self referencePlate].bytes +
+         _homographies.snapshot()->size() * sizeof(gphyx::HomographySample) +
+         _frames->bytes();
+}
+
+- (size_t)spill {
+  const size_t before = [self residentBytes];
+  const BOOL persisted = [self trackFile] != nullptr;
+  _frames->clear();
+  // Every sample stored since the file was bound was appended to it.
+  if (persisted && _trackLoaded.load()) {
+    _homographies.clear();
+    _trackLoaded = false;
+  }
+  const size_t after = [self residentBytes];
+  return before > after ? before - after : 0;
 }
 @end
 
-static NSMutableDictionary<NSString *, gPHYXSharedData *> *s_registry = nil;
+struct gPHYXRegistryEntry {
+  gPHYXSharedData *data = nil;
+  int32_t owners = 0; // live effect instances using this ID
+};
+
+// Instance ID -> shared data. Lookups read an immutable snapshot and never
+// block; only an effect instance's first lookup takes the writer path.
+typedef std::unordered_map<std::string, gPHYXRegistryEntry> gPHYXRegistryMap;
+
+static gphyx::Snapshot<gPHYXRegistryMap> &SharedRegistry() {
+  static gphyx::Snapshot<gPHYXRegistryMap> *registry =
+      new gphyx::Snapshot<gPHYXRegistryMap>();
+  return *registry;
+}
+
+// Instances unused this long have their rebuildable state spilled.
+static const double kRegistryIdleSeconds = 120.0;
+// Data no effect instance uses any more is kept this long in case the
+// deletion is undone; its track is in the sidecar either way.
+static const double kRegistryOrphanSeconds = 30.0;
+static const double kRegistrySweepInterval = 5.0;
+// Memory the registry may hold before instances are spilled or dropped
+// early; override with the gPHYXRegistryCeilingMB user default.
+static const NSInteger kDefaultRegistryCeilingMB = 1024;
+static NSString *const kRegistryCeilingDefaultsKey = @"gPHYXRegistryCeilingMB";
+
+static size_t RegistryCeilingBytes() {
+  static size_t ceiling = 0;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSInteger ceilingMB = [[NSUserDefaults standardUserDefaults]
+        integerForKey:kRegistryCeilingDefaultsKey];
+    if (ceilingMB <= 0)
+      ceilingMB = kDefaultRegistryCeilingMB;
+    ceiling = (size_t)ceilingMB << 20;
+  });
+  return ceiling;
+}
+
+// Spills instances left idle, drops data orphaned for a while and, past the
+// memory ceiling, goes on with orphans and then the least recently used
+// instances. Throttled unless `force`d. Instances being analyzed are left
+// alone.
+static void SweepRegistry(BOOL force) {
+  static std::atomic<double> lastSweep{0.0};
+  const double now = CFAbsoluteTimeGetCurrent();
+  double last = lastSweep.load();
+  if (!force && (now - last < kRegistrySweepInterval ||
+                 !lastSweep.compare_exchange_strong(last, now)))
+    return;
+  lastSweep = now;
+
+  struct Candidate {
+    std::string key;
+    gPHYXSharedData *data;
+    bool orphan;
+    double lastUsed;
+    size_t bytes;
+  };
+  std::vector<Candidate> candidates;
+  std::vector<std::string> dropped;
+  size_t total = 0;
+  size_t spilled = 0;
+  std::shared_ptr<const gPHYXRegistryMap> registry = SharedRegistry().load();
+  for (const auto &item : *registry) {
+    gPHYXSharedData *data = item.second.data;
+    const bool orphan = item.second.owners == 0;
+    const double idle = now - data.lastUsed;
+    if (data.isTracking) {
+      total += data.residentBytes;
+      continue;
+    }
+    if (orphan && idle > kRegistryOrphanSeconds) {
+      dropped.push_back(item.first);
+      continue;
+    }
+    if (idle > kRegistryIdleSeconds)
+      spilled += [data spill];
+    const size_t bytes = data.residentBytes;
+    total += bytes;
+    candidates.push_back({item.first, data, orphan, data.lastUsed, bytes});
+  }
+
+  const size_t ceiling = RegistryCeilingBytes();
+  if (total > ceiling) {
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) {
+                if (a.orphan != b.orphan)
+                  return a.orphan;
+                return a.lastUsed < b.lastUsed;
+              });
+    for (const Candidate &c : candidates) {
+      if (total <= ceiling)
+        break;
+      if (c.orphan) {
+        dropped.push_back(c.key);
+        total -= c.bytes;
+      } else {
+        const size_t released = [c.data spill];
+        spilled += released;
+        total -= std::min(total, released);
+      }
+    }
+  }
+
+  if (!dropped.empty()) {
+    SharedRegistry().update([&](gPHYXRegistryMap &map) {
+      for (const std::string &key : dropped) {
+        auto it = map.find(key);
+        // Re-attached since the snapshot was taken: keep it.
+        if (it != map.end() && it->second.owners == 0)
+          map.erase(it);
+      }
+    });
+  }
+  if (!dropped.empty() || spilled > 0)
+    NSLog(@"[gPHYX] 🧹 Registry: %lu instance(s) dropped, %.1f MB spilled, "
+          @"%.1f MB held",
+          (unsigned long)dropped.size(), spilled / 1048576.0,
+          total / 1048576.0);
+  if (total > ceiling)
+    NSLog(@"[gPHYX] ⚠️ Registry holds %.1f MB of captured plates, over its "
+          @"%.1f MB ceiling",
+          total / 1048576.0, ceiling / 1048576.0);
+}
+
 static NSString *const kDefaultInstanceID = @"MainInstance";
 
+// Processing tiers, picked from the quality the host asks for. Scrubbing
+// gets nearest reference sampling and coarse background tracking, playback
+// bilinear and half resolution, final renders bicubic at full resolution.
+enum class gPHYXRenderTier : uint32_t {
+  Draft = 0,   // kFxQuality_LOW
+  Preview = 1, // kFxQuality_MEDIUM
+  Final = 2,   // kFxQuality_HIGH
+};
+
+// Every parameter a render reads, fetched once per render time in
+// pluginState: and handed to sourceTileRect and the render as the plugin
+// state, instead of each stage asking the host again over XPC. The tier
+// settings are part of it so the host caches each tier's output apart.
+struct gPHYXParameters {
+  NSString *instanceID;
+  NSString *sourceVideo;
+  double roiX1, roiY1, roiX2, roiY2;
+  NSInteger referenceFrame;
+  BOOL showOSC;
+  gPHYXRenderTier tier;
+  gphyx::SampleMode sampling; // reference filter of both inpaint paths
+  int32_t trackingDownsample; // frame and plate reduction for tracking
+  int32_t refinement; // bumped each time this frame's fill is refined
+};
+
+static void ApplyRenderTier(gPHYXParameters *params, gPHYXRenderTier tier) {
+  params->tier = tier;
+  switch (tier) {
+  case gPHYXRenderTier::Draft:
+    params->sampling = gphyx::SampleMode::Nearest;
+    params->trackingDownsample = 4;
+    break;
+  case gPHYXRenderTier::Preview:
+    params->sampling = gphyx::SampleMode::Bilinear;
+    params->trackingDownsample = 2;
+    break;
+  case gPHYXRenderTier::Final:
+    params->sampling = gphyx::SampleMode::Bicubic;
+    params->trackingDownsample = 1;
+    break;
+  }
+}
+
+static gPHYXRenderTier RenderTierForQuality(FxQuality quality) {
+  switch (quality) {
+  case kFxQuality_LOW:
+    return gPHYXRenderTier::Draft;
+  case kFxQuality_MEDIUM:
+    return gPHYXRenderTier::Preview;
+  default:
+    return gPHYXRenderTier::Final;
+  }
+}
+
+// Wire layout of gPHYXParameters; the two UTF-8 strings follow it.
+typedef struct {
+  uint32_t version;
+  uint32_t instanceIDLength;
+  uint32_t sourceVideoLength;
+  uint32_t showOSC;
+  uint32_t tier;
+  uint32_t sampling;
+  int32_t trackingDownsample;
+  int32_t refinement;
+  int64_t referenceFrame;
+  double roi[4];
+} gPHYXParameterHeader;
+
+static const uint32_t kParameterStateVersion = 4; // 4: per-frame refinement
+
+static NSData *EncodeParameters(const gPHYXParameters &params) {
+  NSData *iid =
+      [params.instanceID ?: @"" dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *src =
+      [params.sourceVideo ?: @"" dataUsingEncoding:NSUTF8StringEncoding];
+  gPHYXParameterHeader header = {};
+  header.version = kParameterStateVersion;
+  header.instanceIDLength = (uint32_t)iid.length;
+  header.sourceVideoLength = (uint32_t)src.length;
+  header.showOSC = params.showOSC ? 1 : 0;
+  header.tier = (uint32_t)params.tier;
+  header.sampling = (uint32_t)params.sampling;
+  header.trackingDownsample = params.trackingDownsample;
+  header.refinement = params.refinement;
+  header.referenceFrame = params.referenceFrame;
+  header.roi[0] = params.roiX1;
+  header.roi[1] = params.roiY1;
+  header.roi[2] = params.roiX2;
+  header.roi[3] = params.roiY2;
+
+  NSMutableData *state = [NSMutableData dataWithBytes:&header
+                                               length:sizeof(header)];
+  [state appendData:iid];
+  [state appendData:src];
+  return state;
+}
+
+static BOOL DecodeParameters(NSData *state, gPHYXParameters *params) {
+  gPHYXParameterHeader header;
+  if (state.length < sizeof(header))
+    return NO;
+  memcpy(&header, state.bytes, sizeof(header));
+  if (header.version != kParameterStateVersion ||
+      state.length != sizeof(header) + (NSUInteger)header.instanceIDLength +
+                          header.sourceVideoLength ||
+      header.tier > (uint32_t)gPHYXRenderTier::Final ||
+      header.sampling > (uint32_t)gphyx::SampleMode::Bicubic ||
+      header.trackingDownsample < 1)
+    return NO;
+
+  const char *strings = (const char *)state.bytes + sizeof(header);
+  params->instanceID =
+      [[NSString alloc] initWithBytes:strings
+                               length:header.instanceIDLength
+                             encoding:NSUTF8StringEncoding];
+  params->sourceVideo =
+      [[NSString alloc] initWithBytes:strings + header.instanceIDLength
+                               length:header.sourceVideoLength
+                             encoding:NSUTF8StringEncoding];
+  params->showOSC = header.showOSC != 0;
+  params->tier = (gPHYXRenderTier)header.tier;
+  params->sampling = (gphyx::SampleMode)header.sampling;
+  params->trackingDownsample = header.trackingDownsample;
+  params->refinement = header.refinement;
+  params->referenceFrame = (NSInteger)header.referenceFrame;
+  params->roiX1 = header.roi[0];
+  params->roiY1 = header.roi[1];
+  params->roiX2 = header.roi[2];
+  params->roiY2 = header.roi[3];
+  return params->instanceID != nil && params->sourceVideo != nil;
+}
+
+// Tracking region for the ROI corner parameters: the box plus a margin for
+// the registration search, clamped to the frame (normalized).
+static CGRect TrackingROIForParameters(const gPHYXParameters &params) {
+  double width = params.roiX2 - params.roiX1;
+  double height = params.roiY2 - params.roiY1;
+  double margin = 0.10;
+
+  double finalX = MAX(0.0, params.roiX1 - (width * margin));
+  double finalY = MAX(0.0, params.roiY1 - (height * margin));
+  double finalW = MIN(1.0 - finalX, width * (1.0 + margin * 2.0));
+  double finalH = MIN(1.0 - finalY, height * (1.0 + margin * 2.0));
+
+  return CGRectMake(finalX, finalY, finalW, finalH);
+}
+
+// Everything one renderDestinationImage: call works on, gathered once at the
+// top of the call. Nothing in here is shared with concurrent renders.
+struct gPHYXRenderContext {
+  CMTime renderTime;
+  gPHYXParameters params;
+  NSString *instanceID;
+  gPHYXSharedData *data;
+  CGRect roi; // tracking region, normalized
+  gPHYXReferencePlate *reference;
+  float homography[9];
+  BOOL homographyFound; // tracked, or interpolated close to tracked samples
+  BOOL fullFrame; // the source tile is the whole clip frame
+  BOOL captureReference;
+  BOOL inpaint; // a plate or Drop Zone to fill from; same for every tile
+  BOOL tracking;
+};
+
+// What a fill of one frame needs from the host, read inside a host callback.
+// Fills built from it on the prefetch, fill-store and refine queues make no
+// host calls.
+struct gPHYXFillInputs {
+  gPHYXMaskShape mask;
+  MTLRegion region; // mask region of the whole image, empty without a mask
+  CGRect roi;       // tracking region the homography must be current for
+  gphyx::MaskCoverage coverage; // raster of `region` if already made
+};
+
+// Where the inpaint inputs sit. Positions are image pixels (top-left origin);
+// the tiles the host hands us need not start at the image corner.
+struct gPHYXInpaintGeometry {
+  NSUInteger imageWidth; // full destination image, what the mask spans
+  NSUInteger imageHeight;
+  MTLRegion region; // mask region, inside both the source and dest tiles
+  MTLOrigin sourceOrigin;
+  MTLOrigin destinationOrigin;
+  MTLOrigin referenceOrigin; // in the reference image
+  // Blocked copy of the reference for the CPU path; null to read it as is.
+  const gphyx::TiledImage *tiledReference;
+  gphyx::SampleMode sampling;
+  int32_t coarseStep; // CPU path; 0 or 1 for a full fill
+};
+
+static MTLOrigin OriginOfView(const gphyx::ImageView &view) {
+  return MTLOriginMake((NSUInteger)view.originX, (NSUInteger)view.originY, 0);
+}
+
+// Margin around the mask bbox for feathering and the tracker search window.
+static const double kMaskRegionRelativeMargin = 0.10;
+static const int32_t kMaskRegionMinMarginPx = 16;
+// Interpolated homographies this close to a tracked sample on both sides are
+// trusted as they are; further out the frame is queued for a real track.
+static const double kMaxInterpolationDistance = 0.25;
+// Minimum seconds between tracking progress updates of the status text.
+static const double kStatusUpdateInterval = 0.25;
+// Below the final tier, a fill expected to take longer than this is first
+// rendered coarse and refined in the background.
+static const double kProgressiveBudgetMs = 40.0;
+// Block size of those coarse fills, in image pixels.
+static const int32_t kCoarseFillStep = 4;
+// Most bytes setBytes:length:atIndex: takes; longer tile lists go through a
+// buffer from the instance's tile buffer pool, which keeps this many idle.
+static const NSUInteger kMaxInlineBytes = 4096;
+static const size_t kMaxIdleTileBuffers = 4;
+
+static NSString *const kBufferPoolDefaultsKey = @"gPHYXBufferPoolMB";
+
+// The shared buffer pool keeps its built-in budget unless the user set one.
+static void ConfigureBufferPool() {
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSInteger budgetMB = [[NSUserDefaults standardUserDefaults]
+        integerForKey:kBufferPoolDefaultsKey];
+    if (budgetMB <= 0)
+      return;
+    gphyx::sharedBufferPool().setBudget((size_t)budgetMB << 20);
+    NSLog(@"[gPHYX] 🧮 Buffer pool budget %ld MB", (long)budgetMB);
+  });
+}
+
 void __attribute__((constructor)) initialize_gphyx() {
   NSLog(@"========================================");
   NSLog(@"[gPHYX] gPHYXFillEffect228 loaded");
   NSLog(@"========================================");
 }
 
-@implementation gPHYXFillEffect
+@implementation gPHYXFillEffect {
+  id<PROAPIAccessing> _apiManager;
+  gPHYXOsc *_osc;
+  // Only this effect writes the hidden Instance ID parameter, so once it has
+  // a value it is read from here rather than from the host.
+  os_unfair_lock _instanceIDLock;
+  NSString *_instanceID;
+  std::string _registeredID; // registry entry this effect is counted in
+
+  // Button actions arrive on the main thread, renders anywhere; each flag is
+  // consumed by exactly one render via exchange().
+  std::atomic<bool> _isTracking;
+  std::atomic<bool> _shouldInitTracking;
+  std::atomic<double> _lastStatusUpdate; // CFAbsoluteTime
+
+  // Progressive rendering. Measured cost of full fills per mask pixel, by
+  // sample mode (0 until one was timed).
+  std::atomic<double> _fillNanosPerPixel[3];
+
+  // Tokens of the background work that can go stale: the newest refinement
+  // (each request cancels the one before) and the analysis pass.
+  os_unfair_lock _cancelLock;
+  gphyx::CancelToken _refineCancel;
+  gphyx::CancelToken _analysisCancel;
+
+  // Metal
+  id<MTLDevice> _device;
+  id<MTLComputePipelineState> _inpaintPipeline;
+  id<MTLCommandQueue> _commandQueue;
+  // Idle buffers of _device for tile lists too long for setBytes.
+  os_unfair_lock _tileBufferLock;
+  std::vector<id<MTLBuffer>> _tileBuffers;
+
+  // Vision & Tracking
+  gPHYXVisionTracker *_visionTracker;
+  // Frames of the current analysis pass that were registered, kept, or
+  // copied from an identical frame.
+  std::atomic<NSUInteger> _analysisTracked;
+  std::atomic<NSUInteger> _analysisReused;
+  std::atomic<NSUInteger> _analysisDeduplicated;
+}
 
 - (instancetype)initWithAPIManager:(id<PROAPIAccessing>)newApiManager {
   self = [super init];
@@ -80,12 +1046,9 @@ void __attribute__((constructor)) initialize_gphyx() {
     NSLog(@"║ [gPHYX] com.gphyx.FillEffect228: INIT                  ║");
     NSLog(@"╚══════════════════════════════════════════════════════════╝");
 
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-      s_registry = [NSMutableDictionary dictionary];
-    });
-
     _apiManager = newApiManager;
+    _instanceIDLock = OS_UNFAIR_LOCK_INIT;
+    ConfigureBufferPool();
 
     // ВАЖНО: Создаем OSC ЗДЕСЬ, а не лениво
     _osc = [[gPHYXOsc alloc] initWithAPIManager:_apiManager];
@@ -107,21 +1070,33 @@ void __attribute__((constructor)) initialize_gphyx() {
       }
     }
 
-    _isTracking = NO;
-    _shouldInitTracking = NO;
-    _homographyCache = [[NSMutableDictionary alloc] init];
-    for (int i = 0; i < 9; i++)
-      _currentMatrix[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+    _isTracking = false;
+    _shouldInitTracking = false;
+    _lastStatusUpdate = 0.0;
+    for (std::atomic<double> &cost : _fillNanosPerPixel)
+      cost = 0.0;
+    _cancelLock = OS_UNFAIR_LOCK_INIT;
+    _tileBufferLock = OS_UNFAIR_LOCK_INIT;
   }
   return self;
 }
 
 - (void)dealloc {
-  // NSLog(@"[gPHYX] dealloc called");
-  if (_referenceBuffer) {
-    CFRelease(_referenceBuffer);
-    _referenceBuffer = NULL;
-  }
+  const std::string key = _registeredID;
+  if (key.empty())
+    return;
+  SharedRegistry().update([&](gPHYXRegistryMap &map) {
+    auto it = map.find(key);
+    if (it != map.end() && it->second.owners > 0)
+      it->second.owners--;
+  });
+  // Collect the data once the grace period is over, even if nothing renders.
+  dispatch_after(dispatch_time(DISPATCH_TIME_NOW,
+                               (int64_t)((kRegistryOrphanSeconds + 1.0) *
+                                         NSEC_PER_SEC)),
+                 dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+                   SweepRegistry(YES);
+                 });
 }
 
 - (BOOL)properties:(NSDictionary *_Nonnull *_Nullable)properties
@@ -291,6 +1266,21 @@ void __attribute__((constructor)) initialize_gphyx() {
     res = NO;
   }
 
+  // Bumped when a refined fill is ready, so the host drops its renders.
+  if (![paramAPI addIntSliderWithName:@"Refresh"
+                          parameterID:kParam_Refresh
+                         defaultValue:0
+                         parameterMin:0
+                         parameterMax:INT32_MAX
+                            sliderMin:0
+                            sliderMax:INT32_MAX
+                                delta:1
+                       parameterFlags:kFxParameterFlag_HIDDEN |
+                                      kFxParameterFlag_NOT_ANIMATABLE]) {
+    NSLog(@"gPHYX: Failed to add Refresh");
+    res = NO;
+  }
+
   if (!res) {
     if (outError)
       *outError = [NSError errorWithDomain:FxPlugErrorDomain
@@ -332,11 +1322,10 @@ void __attribute__((constructor)) initialize_gphyx() {
 #pragma mark - Selectors
 
 - (void)initTrackingAction {
-  [self getInstanceID:kCMTimeZero]; // Ensure ID is generated
-  _shouldInitTracking = YES;
+  NSString *iid = [self getInstanceID:kCMTimeZero]; // Ensure ID is generated
+  _shouldInitTracking = true;
   [self updateStatus:@"🟠 Reference Captured!"];
-  NSLog(@"[gPHYX] 🎬 Initialize Tracking triggered (ID: %@)",
-        [self getInstanceID:kCMTimeZero]);
+  NSLog(@"[gPHYX] 🎬 Initialize Tracking triggered (ID: %@)", iid);
 }
 
 - (void)trackMotionAction {
@@ -353,12 +1342,13 @@ void __attribute__((constructor)) initialize_gphyx() {
       NSLog(@"[gPHYX] Failed to start analysis: %@", error);
       [self updateStatus:@"❌ Analysis Failed"];
     } else {
-      _isTracking = YES;
+      _isTracking = true;
     }
   } else {
     NSLog(@"[gPHYX] FxAnalysisAPI not available. Manual tracking only.");
-    _isTracking = !_isTracking;
-    [self updateStatus:_isTracking ? @"🟢 Tracking: ON (Manual)"
+    // fetch_xor flips atomically; the returned value is the old state.
+    bool nowTracking = !_isTracking.fetch_xor(true);
+    [self updateStatus:nowTracking ? @"🟢 Tracking: ON (Manual)"
                                    : @"🔴 Tracking: OFF"];
   }
 }
@@ -442,11 +1432,18 @@ void __attribute__((constructor)) initialize_gphyx() {
 
 - (void)clearMaskAction {
   [_osc clearNodes];
+  [self cancelFillsForInstanceID:[self getInstanceID:kCMTimeZero]];
   [self updateStatus:@"⚪️ Mask Cleared"];
   NSLog(@"[gPHYX] 🗑️ Mask cleared");
 }
 
 - (NSString *)getInstanceID:(CMTime)time {
+  os_unfair_lock_lock(&_instanceIDLock);
+  NSString *cached = _instanceID;
+  os_unfair_lock_unlock(&_instanceIDLock);
+  if (cached)
+    return cached;
+
   id<FxParameterRetrievalAPI_v6> getter =
       [_apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
   NSString *currentID = @"";
@@ -466,23 +1463,199 @@ void __attribute__((constructor)) initialize_gphyx() {
   } else {
     // NSLog(@"[gPHYX] 🆔 Using existing InstanceID: %@", currentID);
   }
+  os_unfair_lock_lock(&_instanceIDLock);
+  _instanceID = [currentID copy];
+  os_unfair_lock_unlock(&_instanceIDLock);
   return currentID;
 }
 
-- (gPHYXSharedData *)getSharedData:(CMTime)time {
-  NSString *instanceID = [self getInstanceID:time];
-  gPHYXSharedData *data = [s_registry objectForKey:instanceID];
-  if (!data) {
-    data = [[gPHYXSharedData alloc] init];
-    [s_registry setObject:data forKey:instanceID];
+- (gPHYXParameters)fetchParametersAtTime:(CMTime)time {
+  gPHYXParameters params = {};
+  params.instanceID = [self getInstanceID:time];
+  params.sourceVideo = @"";
+  params.roiX2 = 1;
+  params.roiY2 = 1;
+  params.showOSC = YES;
+  ApplyRenderTier(&params, gPHYXRenderTier::Final);
+
+  id<FxParameterRetrievalAPI_v6> getter =
+      [_apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
+  if (getter) {
+    NSString *sourceVideo = nil;
+    int referenceFrame = 0;
+    BOOL showOSC = YES;
+    [getter getStringParameterValue:&sourceVideo
+                      fromParameter:kParam_SourceVideo];
+    [getter getIntValue:&referenceFrame
+          fromParameter:kParam_ReferenceFrame
+                 atTime:time];
+    [getter getBoolValue:&showOSC fromParameter:kParam_ShowOSC atTime:time];
+    [getter getFloatValue:&params.roiX1 fromParameter:kParam_ROIX1 atTime:time];
+    [getter getFloatValue:&params.roiY1 fromParameter:kParam_ROIY1 atTime:time];
+    [getter getFloatValue:&params.roiX2 fromParameter:kParam_ROIX2 atTime:time];
+    [getter getFloatValue:&params.roiY2 fromParameter:kParam_ROIY2 atTime:time];
+    params.sourceVideo = sourceVideo ?: @"";
+    params.referenceFrame = referenceFrame;
+    params.showOSC = showOSC;
+  }
+  params.refinement =
+      [[self sharedDataForInstanceID:params.instanceID] refinementAtTime:time];
+  return params;
+}
+
+// The snapshot pluginState: made for this render time, or a fresh fetch (at
+// the final tier) if the host passed none.
+- (gPHYXParameters)parametersFromState:(NSData *)pluginState
+                                atTime:(CMTime)time {
+  gPHYXParameters params;
+  if (DecodeParameters(pluginState, &params))
+    return params;
+  return [self fetchParametersAtTime:time];
+}
+
+// The first lookup of the effect's own ID attaches the effect to it, which
+// keeps the data from being dropped while the effect lives.
+- (gPHYXSharedData *)sharedDataForInstanceID:(NSString *)instanceID {
+  std::string key(instanceID.length ? instanceID.UTF8String
+                                    : kDefaultInstanceID.UTF8String);
+  os_unfair_lock_lock(&_instanceIDLock);
+  const BOOL attached = _registeredID == key;
+  os_unfair_lock_unlock(&_instanceIDLock);
+  if (attached) {
+    std::shared_ptr<const gPHYXRegistryMap> registry = SharedRegistry().load();
+    auto it = registry->find(key);
+    if (it != registry->end()) {
+      [it->second.data touch];
+      return it->second.data;
+    }
   }
+
+  gPHYXSharedData *data = nil;
+  BOOL created = NO;
+  SharedRegistry().update([&](gPHYXRegistryMap &map) {
+    // Another render may have inserted it since our lookup.
+    gPHYXRegistryEntry &entry = map[key];
+    if (!entry.data) {
+      entry.data = [[gPHYXSharedData alloc]
+          initWithBufferOwner:gphyx::hashBytes(key.data(), key.size())];
+      created = YES;
+    }
+    os_unfair_lock_lock(&_instanceIDLock);
+    std::string previous = _registeredID;
+    _registeredID = key;
+    os_unfair_lock_unlock(&_instanceIDLock);
+    if (previous != key) {
+      entry.owners++;
+      auto old = map.find(previous);
+      if (old != map.end() && old->second.owners > 0)
+        old->second.owners--;
+    }
+    data = entry.data;
+  });
+  [data touch];
+  if (created)
+    [self bindTrackFileForData:data instanceID:@(key.c_str())];
   return data;
 }
 
-- (void)inpaintAction {
-  _shouldInpaint = YES;
-  [self updateStatus:@"🔵 Inpainting Done"];
-  NSLog(@"gPHYX: Inpainting triggered...");
+// <Caches>/com.gphyx.FillEffect/<name>, created if missing; nil on failure.
+static NSURL *CreateCacheDirectory(NSString *name) {
+  NSFileManager *fm = [NSFileManager defaultManager];
+  NSURL *caches = [[fm URLsForDirectory:NSCachesDirectory
+                              inDomains:NSUserDomainMask] firstObject];
+  NSURL *url = [[caches URLByAppendingPathComponent:@"com.gphyx.FillEffect"]
+      URLByAppendingPathComponent:name];
+  NSError *error = nil;
+  if (![fm createDirectoryAtURL:url
+          withIntermediateDirectories:YES
+                           attributes:nil
+                                error:&error]) {
+    NSLog(@"[gPHYX] ❌ No %@ cache directory: %@", name, error);
+    return nil;
+  }
+  return url;
+}
+
+static NSURL *TrackDirectoryURL() {
+  static NSURL *directory = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    directory = CreateCacheDirectory(@"tracks");
+  });
+  return directory;
+}
+
+// Disk budget for rendered fills; override with the gPHYXFillCacheMB user
+// default.
+static const NSInteger kDefaultFillCacheMB = 2048;
+static NSString *const kFillCacheDefaultsKey = @"gPHYXFillCacheMB";
+
+// Rendered fills of every instance, kept across sessions. NULL if the cache
+// directory can't be created.
+static gphyx::FillStore *SharedFillStore() {
+  static gphyx::FillStore *store = nullptr;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    NSURL *directory = CreateCacheDirectory(@"fills");
+    if (!directory)
+      return;
+    NSInteger budgetMB = [[NSUserDefaults standardUserDefaults]
+        integerForKey:kFillCacheDefaultsKey];
+    if (budgetMB <= 0)
+      budgetMB = kDefaultFillCacheMB;
+    store = new gphyx::FillStore(directory.path.UTF8String,
+                                 (size_t)budgetMB << 20);
+    NSLog(@"[gPHYX] 💾 Fill cache budget %ld MB", (long)budgetMB);
+  });
+  return store;
+}
+
+// Fills a render computed itself are written back from here, off the render
+// thread.
+static dispatch_queue_t FillStoreQueue() {
+  static dispatch_queue_t queue;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    queue = dispatch_queue_create(
+        "com.gphyx.fillstore",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL,
+                                                QOS_CLASS_UTILITY, 0));
+  });
+  return queue;
+}
+
+// Background refinement of coarse renders. Serial, and above the fill-store
+// queue: the frame under the playhead should converge within a second.
+static dispatch_queue_t RefineQueue() {
+  static dispatch_queue_t queue;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    queue = dispatch_queue_create(
+        "com.gphyx.refine",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL,
+                                                QOS_CLASS_USER_INITIATED, 0));
+  });
+  return queue;
+}
+
+// The sidecar belongs to the instance and the Source Video it was tracked
+// on; pointing the instance at other media starts a fresh track.
+- (void)bindTrackFileForData:(gPHYXSharedData *)data
+                  instanceID:(NSString *)instanceID {
+  NSURL *directory = TrackDirectoryURL();
+  if (!directory)
+    return;
+  NSString *videoPath = @"";
+  id<FxParameterRetrievalAPI_v6> getter =
+      [_apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
+  if (getter)
+    [getter getStringParameterValue:&videoPath
+                      fromParameter:kParam_SourceVideo];
+  const char *source = (videoPath ?: @"").UTF8String;
+
+  NSString *name = [instanceID stringByAppendingPathExtension:@"gphyxtrack"];
+  [data bindTrackFileAtPath:[directory URLByAppendingPathComponent:name].path
+             sourceIdentity:gphyx::hashBytes(source, strlen(source))];
 }
 
 - (void)updateStatus:(NSString *)text {
@@ -493,6 +1666,95 @@ void __attribute__((constructor)) initialize_gphyx() {
   }
 }
 
+// `content`, when given, is noted for the frame once it is tracked.
+- (void)queueTrackingForContext:(const gPHYXRenderContext &)ctx
+                       surface:(IOSurfaceRef)surface
+                       content:(const gphyx::FrameContent *)content {
+  gPHYXTrackingService *service = [gPHYXTrackingService sharedService];
+  if ([service hasJobForInstanceID:ctx.instanceID time:ctx.renderTime])
+    return;
+
+  // The host recycles srcRef after this render, so the job gets a copy, in
+  // luma and reduced like the plate level it is registered against.
+  const int32_t downsample = ctx.params.trackingDownsample;
+  CVPixelBufferRef scaledReference =
+      [ctx.reference copyLumaDownsampledBy:downsample];
+  CVPixelBufferRef frame =
+      scaledReference ? gPHYXCreatePooledLumaCopy(surface, downsample,
+                                                  ctx.data.bufferOwner)
+                      : NULL;
+  if (!frame) {
+    if (scaledReference)
+      CFRelease(scaledReference);
+    return;
+  }
+
+  gPHYXSharedData *data = ctx.data;
+  const uint64_t signature = ctx.reference.signature;
+  CMTime time = ctx.renderTime;
+  CGRect roi = ctx.roi;
+  const BOOL hashed = content != nullptr;
+  const gphyx::FrameContent frameContent =
+      hashed ? *content : gphyx::FrameContent();
+  [service enqueueFrame:frame
+              reference:scaledReference
+                    roi:roi
+             instanceID:ctx.instanceID
+                   time:time
+             completion:^(const float *homography, float confidence) {
+               // A re-captured plate makes older results meaningless.
+               if ([data referenceSignature] == signature) {
+                 float full[9];
+                 gphyx::scaleHomography(homography, downsample, full);
+                 [data setHomography:full
+                              atTime:time
+                          confidence:confidence
+                                 roi:roi
+                          downsample:downsample];
+                 if (hashed)
+                   [data noteFrameContent:frameContent atTime:time];
+               }
+             }];
+  CFRelease(scaledReference);
+  CFRelease(frame);
+}
+
+// Setting a parameter makes the host re-evaluate the inspector, so progress
+// is posted a few times a second at most rather than on every frame.
+- (void)updateTrackingProgressAtTime:(CMTime)renderTime {
+  double now = CFAbsoluteTimeGetCurrent();
+  double last = _lastStatusUpdate.load();
+  if (now - last < kStatusUpdateInterval ||
+      !_lastStatusUpdate.compare_exchange_strong(last, now))
+    return;
+
+  id<FxTimingAPI_v4> timingAPI =
+      [_apiManager apiForProtocol:@protocol(FxTimingAPI_v4)];
+  if (!timingAPI)
+    return;
+
+  CMTime startTime, duration;
+  [timingAPI startTimeOfInputToFilter:&startTime];
+  [timingAPI durationTimeOfInputToFilter:&duration];
+
+  double startSec = CMTimeGetSeconds(startTime);
+  double durationSec = CMTimeGetSeconds(duration);
+  double currentSec = CMTimeGetSeconds(renderTime);
+
+  if (durationSec > 0) {
+    float percent = ((currentSec - startSec) / durationSec) * 100.0f;
+    if (percent < 0)
+      percent = 0;
+    if (percent > 100)
+      percent = 100;
+
+    NSString *progressTxt =
+        [NSString stringWithFormat:@"🟢 Tracking: %@",
+                                   [self getProgressBarForPercent:percent]];
+    [self updateStatus:progressTxt];
+  }
+}
+
 - (NSString *)getProgressBarForPercent:(float)percent {
   int width = 10;
   int progress = (int)(percent / (100.0 / width));
@@ -508,26 +1770,62 @@ void __attribute__((constructor)) initialize_gphyx() {
 }
 
 - (CGRect)calculateROIRectAtTime:(CMTime)time {
-  double roiX1 = 0, roiY1 = 0, roiX2 = 1, roiY2 = 1;
+  gPHYXParameters params = {};
+  params.roiX2 = 1;
+  params.roiY2 = 1;
   id<FxParameterRetrievalAPI_v6> getAPI =
       [_apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
   if (getAPI) {
-    [getAPI getFloatValue:&roiX1 fromParameter:kParam_ROIX1 atTime:time];
-    [getAPI getFloatValue:&roiY1 fromParameter:kParam_ROIY1 atTime:time];
-    [getAPI getFloatValue:&roiX2 fromParameter:kParam_ROIX2 atTime:time];
-    [getAPI getFloatValue:&roiY2 fromParameter:kParam_ROIY2 atTime:time];
+    [getAPI getFloatValue:&params.roiX1 fromParameter:kParam_ROIX1 atTime:time];
+    [getAPI getFloatValue:&params.roiY1 fromParameter:kParam_ROIY1 atTime:time];
+    [getAPI getFloatValue:&params.roiX2 fromParameter:kParam_ROIX2 atTime:time];
+    [getAPI getFloatValue:&params.roiY2 fromParameter:kParam_ROIY2 atTime:time];
   }
+  return TrackingROIForParameters(params);
+}
 
-  double width = roiX2 - roiX1;
-  double height = roiY2 - roiY1;
-  double margin = 0.10;
+// Surface region the expensive stages (mask raster, warp, blend) run on: the
+// mask bbox plus a feather/search margin. Pixels outside it keep the
+// fail-safe passthrough copy.
+- (MTLRegion)maskRegionForWidth:(NSUInteger)width
+                         height:(NSUInteger)height
+                         atTime:(CMTime)time {
+  if (!_osc)
+    return MTLRegionMake2D(0, 0, 0, 0);
+  return [self maskRegionForShape:[_osc maskShapeSnapshotAtTime:time
+                                                     apiManager:_apiManager]
+                            width:width
+                           height:height];
+}
 
-  double finalX = MAX(0.0, roiX1 - (width * margin));
-  double finalY = MAX(0.0, roiY1 - (height * margin));
-  double finalW = MIN(1.0 - finalX, width * (1.0 + margin * 2.0));
-  double finalH = MIN(1.0 - finalY, height * (1.0 + margin * 2.0));
+// The same from a mask read earlier; no host calls.
+- (MTLRegion)maskRegionForShape:(const gPHYXMaskShape &)shape
+                          width:(NSUInteger)width
+                         height:(NSUInteger)height {
+  if (!_osc)
+    return MTLRegionMake2D(0, 0, 0, 0);
+  CGRect bounds = [_osc maskBoundsForShape:shape];
+  gphyx::PixelRect region = gphyx::maskRegionForNormalizedBounds(
+      CGRectGetMinX(bounds), CGRectGetMinY(bounds), CGRectGetMaxX(bounds),
+      CGRectGetMaxY(bounds), (int32_t)width, (int32_t)height,
+      kMaskRegionRelativeMargin, kMaskRegionMinMarginPx);
+  return MTLRegionMake2D(region.x0, region.y0, region.width(),
+                         region.height());
+}
 
-  return CGRectMake(finalX, finalY, finalW, finalH);
+// Reads the mask at `time` for a fill built later, off the host's threads.
+- (gPHYXFillInputs)fillInputsAtTime:(CMTime)time
+                              width:(NSUInteger)width
+                             height:(NSUInteger)height
+                                roi:(CGRect)roi {
+  gPHYXFillInputs inputs = {};
+  inputs.roi = roi;
+  if (_osc)
+    inputs.mask = [_osc maskShapeSnapshotAtTime:time apiManager:_apiManager];
+  inputs.region = [self maskRegionForShape:inputs.mask
+                                     width:width
+                                    height:height];
+  return inputs;
 }
 
 #pragma mark - FxAnalyzer Implementation
@@ -542,10 +1840,19 @@ void __attribute__((constructor)) initialize_gphyx() {
 - (BOOL)setupAnalysisForTimeRange:(CMTimeRange)analysisRange
                     frameDuration:(CMTime)frameDuration
                             error:(NSError **)error {
-  gPHYXSharedData *data = [self getSharedData:analysisRange.start];
-  NSLog(@"[gPHYX] 🟢 setupAnalysisForTimeRange (ID: %@)",
-        [self getInstanceID:analysisRange.start]);
-  [data.homographyCache removeAllObjects];
+  NSString *iid = [self getInstanceID:analysisRange.start];
+  gPHYXSharedData *data = [self sharedDataForInstanceID:iid];
+  NSLog(@"[gPHYX] 🟢 setupAnalysisForTimeRange (ID: %@)", iid);
+  [self bindTrackFileForData:data instanceID:iid];
+  // Samples are kept: analyzeFrame skips those whose tracking inputs are
+  // unchanged, so a pass only pays for new or invalidated frames.
+  _analysisTracked = 0;
+  _analysisReused = 0;
+  _analysisDeduplicated = 0;
+  os_unfair_lock_lock(&_cancelLock);
+  _analysisCancel.cancel();
+  _analysisCancel = gphyx::CancelToken::make();
+  os_unfair_lock_unlock(&_cancelLock);
   data.isTracking = YES;
   [self updateStatus:@"🟠 Tracking in progress..."];
   return YES;
@@ -554,44 +1861,97 @@ void __attribute__((constructor)) initialize_gphyx() {
 - (BOOL)analyzeFrame:(FxImageTile *)frame
               atTime:(CMTime)frameTime
                error:(NSError **)error {
-  gPHYXSharedData *data = [self getSharedData:frameTime];
-  if (!data.referenceBuffer) {
+  os_unfair_lock_lock(&_cancelLock);
+  const gphyx::CancelToken cancel = _analysisCancel;
+  os_unfair_lock_unlock(&_cancelLock);
+  // A pass whose plate was replaced would only track against the old one.
+  if (cancel.cancelled())
+    return YES;
+
+  NSString *iid = [self getInstanceID:frameTime];
+  gPHYXSharedData *data = [self sharedDataForInstanceID:iid];
+  gPHYXReferencePlate *plate = [data referencePlate];
+  CVPixelBufferRef referenceBuffer = [plate copyLumaDownsampledBy:1];
+  if (!referenceBuffer) {
     NSLog(@"[gPHYX] AnalyzeFrame: No reference buffer for ID %@. Cannot track.",
-          [self getInstanceID:frameTime]);
+          iid);
     return YES;
   }
 
   CGRect roiRect = [self calculateROIRectAtTime:frameTime];
+  if ([data hasCurrentHomographyAtTime:frameTime roi:roiRect]) {
+    _analysisReused++;
+    CFRelease(referenceBuffer);
+    return YES;
+  }
+
   IOSurfaceRef surface = (__bridge IOSurfaceRef)frame.ioSurface;
-  CVPixelBufferRef currentBuffer = NULL;
-  CVReturn status = CVPixelBufferCreateWithIOSurface(
-      kCFAllocatorDefault, surface, NULL, &currentBuffer);
-
-  if (status == kCVReturnSuccess && currentBuffer) {
-    NSArray<NSNumber *> *matrix =
-        [_visionTracker estimateHomographyFrom:currentBuffer
-                                            to:data.referenceBuffer
-                                           roi:roiRect];
-    if (matrix.count == 9) {
+  FxRect bounds = frame.imagePixelBounds;
+  gphyx::FrameContent content;
+  IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+  BOOL hashed = gphyx::frameContent(
+      gPHYXImageViewForTile(frame, surface),
+      PixelRectForROI(roiRect, (int32_t)(bounds.right - bounds.left),
+                      (int32_t)(bounds.top - bounds.bottom)),
+      content);
+  IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+  float reused[9];
+  if (hashed && [data reuseHomography:reused
+                           forContent:content
+                               atTime:frameTime
+                                  roi:roiRect
+                           downsample:1]) {
+    _analysisDeduplicated++;
+    CFRelease(referenceBuffer);
+    return YES;
+  }
+
+  // Registered in luma, like the plate.
+  CVPixelBufferRef currentBuffer =
+      gPHYXCreatePooledLumaCopy(surface, 1, data.bufferOwner);
+  if (currentBuffer) {
+    NSArray<NSNumber *> *result =
+        [_visionTracker estimateHomographyWithConfidenceFrom:currentBuffer
+                                                          to:referenceBuffer
+                                                         roi:roiRect];
+    // Cancelled registrations report identity; never store those.
+    if (result.count == 10 && !cancel.cancelled() &&
+        [data referenceSignature] == plate.signature) {
       float h[9];
       for (int i = 0; i < 9; i++)
-        h[i] = [matrix[i] floatValue];
-
-      // Use tick-based key to avoid precision issues
-      NSNumber *key = [NSNumber numberWithLongLong:frameTime.value];
-      [data.homographyCache setObject:[NSData dataWithBytes:h length:sizeof(h)]
-                               forKey:key];
+        h[i] = [result[i] floatValue];
+      [data setHomography:h
+                   atTime:frameTime
+               confidence:[result[9] floatValue]
+                      roi:roiRect
+               downsample:1];
+      if (hashed)
+        [data noteFrameContent:content atTime:frameTime];
+      _analysisTracked++;
     }
     CFRelease(currentBuffer);
   }
+  CFRelease(referenceBuffer);
   return YES;
 }
 
 - (BOOL)cleanupAnalysis:(NSError **)error {
-  gPHYXSharedData *data = [self getSharedData:kCMTimeZero];
+  os_unfair_lock_lock(&_cancelLock);
+  _analysisCancel.cancel();
+  os_unfair_lock_unlock(&_cancelLock);
+  NSString *iid = [self getInstanceID:kCMTimeZero];
+  gPHYXSharedData *data = [self sharedDataForInstanceID:iid];
   data.isTracking = NO;
-  NSLog(@"[gPHYX] 🏁 cleanupAnalysis (ID: %@)",
-        [self getInstanceID:kCMTimeZero]);
+  NSLog(@"[gPHYX] 🏁 cleanupAnalysis (ID: %@): %lu tracked, %lu kept, %lu "
+        @"repeated",
+        iid, (unsigned long)_analysisTracked.load(),
+        (unsigned long)_analysisReused.load(),
+        (unsigned long)_analysisDeduplicated.load());
+  gphyx::BufferPool &pool = gphyx::sharedBufferPool();
+  NSLog(@"[gPHYX] 🧮 Buffer pool: %.1f MB held by this instance, %.1f MB "
+        @"in use, %.1f MB idle",
+        pool.ownerBytes(data.bufferOwner) / 1048576.0,
+        pool.liveBytes() / 1048576.0, pool.idleBytes() / 1048576.0);
   [self updateStatus:@"✅ Tracking Completed"];
   return YES;
 }
@@ -726,7 +2086,9 @@ void __attribute__((constructor)) initialize_gphyx() {
              atTime:(CMTime)renderTime
             quality:(FxQuality)qualityLevel
               error:(NSError **)error {
-  *pluginState = [NSData data];
+  gPHYXParameters params = [self fetchParametersAtTime:renderTime];
+  ApplyRenderTier(&params, RenderTierForQuality(qualityLevel));
+  *pluginState = EncodeParameters(params);
   return YES;
 }
 
@@ -750,14 +2112,90 @@ void __attribute__((constructor)) initialize_gphyx() {
             pluginState:(NSData *)pluginState
                  atTime:(CMTime)renderTime
                   error:(NSError **)outError {
-  if (sourceImages.count > 0) {
-    *sourceTileRect = sourceImages[0].imagePixelBounds;
+  if (sourceImageIndex >= sourceImages.count) {
+    return YES;
+  }
+  FxRect imageBounds = sourceImages[sourceImageIndex].imagePixelBounds;
+  gPHYXParameters params = [self parametersFromState:pluginState
+                                              atTime:renderTime];
+  gPHYXSharedData *data = [self sharedDataForInstanceID:params.instanceID];
+  FxRect dstImage = destinationImage.imagePixelBounds;
+  float homography[9];
+  BOOL settled = [self
+      resolveHomography:homography
+                forData:data
+                 atTime:renderTime
+                    roi:TrackingROIForParameters(params)
+              frameSize:CGSizeMake(dstImage.right - dstImage.left,
+                                   dstImage.top - dstImage.bottom)];
+
+  if (sourceImageIndex == 0) {
+    // The clip maps 1:1 onto the destination, unless this render still has
+    // to capture the whole frame or copy it for tracking.
+    BOOL fullFrame = _shouldInitTracking.load() ||
+                     (!settled && [self wantsTrackingForData:data]);
+    *sourceTileRect = fullFrame ? imageBounds : destinationTileRect;
+    return YES;
+  }
+
+  // Reference (Drop Zone): the masked part of the tile, warped. An unsettled
+  // estimate may be replaced before the render runs, so take it all then.
+  if (!settled) {
+    *sourceTileRect = imageBounds;
+    return YES;
   }
+  MTLRegion mask =
+      [self maskRegionForWidth:(NSUInteger)(dstImage.right - dstImage.left)
+                        height:(NSUInteger)(dstImage.top - dstImage.bottom)
+                        atTime:renderTime];
+  gphyx::PixelRect refBounds =
+      gPHYXPixelRectForFxRect(imageBounds, imageBounds);
+  gphyx::PixelRect footprint = gphyx::referenceFootprint(
+      gPHYXPixelRectForFxRect(destinationTileRect, dstImage),
+      gphyx::makePixelRect((int32_t)mask.origin.x, (int32_t)mask.origin.y,
+                           (int32_t)mask.size.width,
+                           (int32_t)mask.size.height),
+      homography, params.sampling, refBounds);
+  if (footprint.empty()) {
+    // Nothing in this tile reads the reference; keep the transfer minimal.
+    footprint = gphyx::intersectRects(gphyx::makePixelRect(0, 0, 1, 1),
+                                      refBounds);
+  }
+  *sourceTileRect = gPHYXFxRectForPixelRect(footprint, imageBounds);
   return YES;
 }
 
-- (void)checkForUpdatedTrackingData:(NSString *)instanceID {
-  gPHYXSharedData *data = [self getSharedData:kCMTimeZero];
+// Best homography for `time` from what has been tracked so far. YES when it
+// is a sample tracked against the current plate and `roi`, or a short
+// interpolation between two; NO when a real track of this frame would
+// improve it (outMatrix still holds the fallback).
+- (BOOL)resolveHomography:(float *)outMatrix
+                  forData:(gPHYXSharedData *)data
+                   atTime:(CMTime)time
+                      roi:(CGRect)roi
+                frameSize:(CGSize)frameSize {
+  gPHYXHomographyMatch match;
+  if (![data estimateHomography:outMatrix
+                         atTime:time
+                            roi:roi
+                      frameSize:frameSize
+                          match:&match]) {
+    [data getLatestHomography:outMatrix];
+    return NO;
+  }
+  return match.exact ||
+         (match.bracketed && match.distance <= kMaxInterpolationDistance);
+}
+
+// Whether an unsettled frame gets queued for tracking by the render.
+- (BOOL)wantsTrackingForData:(gPHYXSharedData *)data {
+  if (!_isTracking.load() && !data.isTracking)
+    return NO;
+  return [data referencePlate] != nil;
+}
+
+- (void)checkForUpdatedTrackingData:(NSString *)instanceID
+                               data:(gPHYXSharedData *)data {
   if (!data)
     return;
 
@@ -804,30 +2242,53 @@ void __attribute__((constructor)) initialize_gphyx() {
                         atTime:(CMTime)renderTime
                          error:(NSError **)outError {
 
-  NSString *iid = [self getInstanceID:renderTime];
-  [self checkForUpdatedTrackingData:iid];
-
-  gPHYXSharedData *data = [self getSharedData:renderTime];
-  if (data) {
-    if (_osc.maskPoints != data.maskPoints) {
-      _osc.maskPoints = data.maskPoints;
-      // КРИТИЧНО: Принудительно уведомляем хост, что OSC кастомный и должен
-      // быть перерисован Это заставляет Motion/FCP вызвать drawOSCWithWidth
-    }
+  // Everything below works on this context only; the host may run several
+  // renders of this instance at the same time.
+  gPHYXRenderContext ctx = {};
+  ctx.renderTime = renderTime;
+  ctx.params = [self parametersFromState:pluginState atTime:renderTime];
+  ctx.instanceID = ctx.params.instanceID;
+  ctx.roi = TrackingROIForParameters(ctx.params);
+  ctx.data = [self sharedDataForInstanceID:ctx.instanceID];
+  SweepRegistry(NO);
+  ctx.tracking = _isTracking.load() || ctx.data.isTracking;
+  [self checkForUpdatedTrackingData:ctx.instanceID data:ctx.data];
+
+  gPHYXSharedData *data = ctx.data;
+  // parameterChanged: is not sent for values restored with a project.
+  if (_osc.hidden == ctx.params.showOSC)
+    _osc.hidden = !ctx.params.showOSC;
+  NSArray<NSValue *> *maskPoints = data.maskPoints;
+  if (_osc.maskPoints != maskPoints) {
+    _osc.maskPoints = maskPoints;
+    [self cancelFillsForInstanceID:ctx.instanceID];
+    // КРИТИЧНО: Принудительно уведомляем хост, что OSC кастомный и должен
+    // быть перерисован Это заставляет Motion/FCP вызвать drawOSCWithWidth
   }
 
   // NSLog(@"[gPHYX] renderDestinationImage called, sourceImages=%lu", (unsigned
   // long)sourceImages.count);
 
   if (sourceImages.count == 0) {
-    NSLog(@"[gPHYX] WARNING: No source images!");
+    gPHYXTrace(@"[gPHYX] WARNING: No source images!");
     return YES;
   }
   FxImageTile *inputTile = sourceImages[0];
 
+  // Capturing and tracking need the whole frame; sourceTileRect asks for it
+  // whenever either is due, so a partial tile here can skip both.
+  FxRect tileBounds = inputTile.tilePixelBounds;
+  FxRect imageBounds = inputTile.imagePixelBounds;
+  ctx.fullFrame = tileBounds.left == imageBounds.left &&
+                  tileBounds.bottom == imageBounds.bottom &&
+                  tileBounds.right == imageBounds.right &&
+                  tileBounds.top == imageBounds.top;
+  ctx.captureReference = ctx.fullFrame && _shouldInitTracking.exchange(false);
+  ctx.tracking = ctx.tracking && ctx.fullFrame;
+
   // --- FAIL-SAFE: Always copy input to output FIRST to prevent black screen
   // ---
-  NSLog(@"[gPHYX] Copying input -> output (fail-safe)");
+  gPHYXTrace(@"[gPHYX] Copying input -> output (fail-safe)");
   IOSurfaceRef srcRef = (__bridge IOSurfaceRef)inputTile.ioSurface;
   IOSurfaceRef dstRef = (__bridge IOSurfaceRef)destinationImage.ioSurface;
 
@@ -837,227 +2298,809 @@ void __attribute__((constructor)) initialize_gphyx() {
     void *srcBase = IOSurfaceGetBaseAddress(srcRef);
     void *dstBase = IOSurfaceGetBaseAddress(dstRef);
     if (srcBase && dstBase) {
-      size_t srcSize = IOSurfaceGetAllocSize(srcRef);
-      size_t dstSize = IOSurfaceGetAllocSize(dstRef);
-      memcpy(dstBase, srcBase, (srcSize < dstSize) ? srcSize : dstSize);
+      // Stride/origin aware, format converting, multi-core copy
+      gphyx::ImageView srcView = gPHYXImageViewForTile(inputTile, srcRef);
+      gphyx::ImageView dstView =
+          gPHYXImageViewForTile(destinationImage, dstRef);
+      if (!gphyx::blitImage(dstView, srcView)) {
+        // Unknown pixel format: fall back to a raw copy
+        size_t srcSize = IOSurfaceGetAllocSize(srcRef);
+        size_t dstSize = IOSurfaceGetAllocSize(dstRef);
+        memcpy(dstBase, srcBase, (srcSize < dstSize) ? srcSize : dstSize);
+      }
     }
 
     // --- CLEAN PLATE: Capture Reference Frame if requested
-    if (_shouldInitTracking) {
-      _shouldInitTracking = NO;
-      CVPixelBufferRef pref = NULL;
-      CVPixelBufferCreateWithIOSurface(kCFAllocatorDefault, srcRef, NULL,
-                                       &pref);
-      [data setReferenceBuffer:(CVPixelBufferRef)pref];
-      if (pref)
-        CFRelease(pref);
-      NSLog(@"[gPHYX] Reference Frame Captured for ID %@.",
-            [self getInstanceID:renderTime]);
+    if (ctx.captureReference) {
+      // Copied: background tracking keeps using it after srcRef is recycled.
+      // Colour is only kept around the mask; tracking needs just the luma.
+      const int32_t width = (int32_t)(imageBounds.right - imageBounds.left);
+      const int32_t height = (int32_t)(imageBounds.top - imageBounds.bottom);
+      MTLRegion mask = [self maskRegionForWidth:(NSUInteger)width
+                                         height:(NSUInteger)height
+                                         atTime:renderTime];
+      gphyx::PixelRect colorRegion = gphyx::plateRegionForMask(
+          gphyx::makePixelRect((int32_t)mask.origin.x, (int32_t)mask.origin.y,
+                               (int32_t)mask.size.width,
+                               (int32_t)mask.size.height),
+          width, height, kPlateMinMarginPx);
+      gPHYXReferencePlate *plate =
+          [[gPHYXReferencePlate alloc] initWithSurface:srcRef
+                                           colorRegion:colorRegion];
+      [[gPHYXTrackingService sharedService]
+          cancelJobsForInstanceID:ctx.instanceID];
+      [self cancelFillsForInstanceID:ctx.instanceID];
+      [self cancelAnalysis];
+      [data setReferencePlate:plate];
+      data.referenceFrame = ctx.params.referenceFrame;
+      NSLog(@"[gPHYX] Reference Frame Captured for ID %@ (%d x %d colour, "
+            @"%zu KB)",
+            ctx.instanceID, colorRegion.width(), colorRegion.height(),
+            plate.bytes >> 10);
     }
+    ctx.reference = [data referencePlate];
 
     // --- CLEAN PLATE: Plan Homography
-    BOOL hFound = NO;
-    // Try tick-based lookup
-    NSData *cachedH = [data.homographyCache
-        objectForKey:[NSNumber numberWithLongLong:renderTime.value]];
-
-    // Fallback: search by small tolerance
-    if (!cachedH) {
-      double currentSec = CMTimeGetSeconds(renderTime);
-      for (NSNumber *key in [data.homographyCache allKeys]) {
-        // We don't know the exact timescale stored, but we assume it's
-        // consistent with the project. If not, we'd need to store the timescale
-        // too. For now, assume renderTime.timescale is the one.
-        double keySec =
-            (double)[key longLongValue] / (double)renderTime.timescale;
-        if (fabs(keySec - currentSec) < 0.0001) {
-          cachedH = [data.homographyCache objectForKey:key];
-          // NSLog(@"[gPHYX] 🎯 Cache hit via tolerance: %.4f vs %.4f", keySec,
-          // currentSec);
-          break;
-        }
-      }
-    }
-
-    if (cachedH) {
-      memcpy(_homography, [cachedH bytes], sizeof(float) * 9);
-      hFound = YES;
-    } else if (data.homographyCache.count > 0) {
-      // NSLog(@"[gPHYX] ❓ Cache miss for time %.4f (Cache size: %lu)",
-      //      CMTimeGetSeconds(renderTime), (unsigned
-      //      long)data.homographyCache.count);
-    }
-
-    if ((_isTracking || data.isTracking) && data.referenceBuffer && !hFound) {
-      CVPixelBufferRef currentBuffer = NULL;
-      CVPixelBufferCreateWithIOSurface(kCFAllocatorDefault, srcRef, NULL,
-                                       &currentBuffer);
-      if (currentBuffer) {
-        CGRect roiRect = [self calculateROIRectAtTime:renderTime];
-        NSArray<NSNumber *> *matrix =
-            [_visionTracker estimateHomographyFrom:currentBuffer
-                                                to:data.referenceBuffer
-                                               roi:roiRect];
-        for (int i = 0; i < 9; i++) {
-          _homography[i] = [matrix[i] floatValue];
-        }
-
-        [data.homographyCache
-            setObject:[NSData dataWithBytes:_homography
-                                     length:sizeof(_homography)]
-               forKey:@(renderTime.value)];
-
-        // --- Progress Bar Logic ---
-        id<FxTimingAPI_v4> timingAPI =
-            [_apiManager apiForProtocol:@protocol(FxTimingAPI_v4)];
-        if (timingAPI) {
-          CMTime startTime, duration;
-          [timingAPI startTimeOfInputToFilter:&startTime];
-          [timingAPI durationTimeOfInputToFilter:&duration];
-
-          double startSec = CMTimeGetSeconds(startTime);
-          double durationSec = CMTimeGetSeconds(duration);
-          double currentSec = CMTimeGetSeconds(renderTime);
-
-          if (durationSec > 0) {
-            float percent = ((currentSec - startSec) / durationSec) * 100.0f;
-            if (percent < 0)
-              percent = 0;
-            if (percent > 100)
-              percent = 100;
-
-            NSString *progressTxt = [NSString
-                stringWithFormat:@"🟢 Tracking: %@",
-                                 [self getProgressBarForPercent:percent]];
-            [self updateStatus:progressTxt];
-          }
-        }
-        CFRelease(currentBuffer);
+    ctx.homographyFound =
+        [self resolveHomography:ctx.homography
+                        forData:data
+                         atTime:renderTime
+                            roi:ctx.roi
+                      frameSize:CGSizeMake(imageBounds.right - imageBounds.left,
+                                           imageBounds.top -
+                                               imageBounds.bottom)];
+
+    // A repeat of an already tracked frame takes over its result. Anything
+    // else is registered in the background; this render keeps the estimate
+    // above and a later one picks up the result.
+    if (ctx.tracking && ctx.reference && !ctx.homographyFound) {
+      gphyx::FrameContent content;
+      BOOL hashed = gphyx::frameContent(
+          gPHYXImageViewForTile(inputTile, srcRef),
+          PixelRectForROI(ctx.roi,
+                          (int32_t)(imageBounds.right - imageBounds.left),
+                          (int32_t)(imageBounds.top - imageBounds.bottom)),
+          content);
+      if (hashed && [data reuseHomography:ctx.homography
+                               forContent:content
+                                   atTime:renderTime
+                                      roi:ctx.roi
+                               downsample:ctx.params.trackingDownsample]) {
+        ctx.homographyFound = YES;
+        gPHYXTrace(@"[gPHYX] ♻️ Repeated frame, tracking reused");
+      } else {
+        [self queueTrackingForContext:ctx
+                              surface:srcRef
+                              content:hashed ? &content : nullptr];
+        [self updateTrackingProgressAtTime:renderTime];
       }
     }
 
     // Pass the calculated homography to OSC for drawing
     if (_osc) {
-      [_osc setDrawHomography:_homography];
+      [_osc setDrawHomography:ctx.homography];
     }
 
+    IOSurfaceUnlock(dstRef, 0, NULL);
     IOSurfaceUnlock(srcRef, kIOSurfaceLockReadOnly, NULL);
   }
 
-  if (_shouldInpaint && _inpaintPipeline) {
-    _shouldInpaint = NO;
-    NSLog(@"[gPHYX] Metal Inpainting triggered...");
+  // Decided from state, not a one-shot flag: the host may render a frame as
+  // several tiles, and each of them has to fill its part.
+  BOOL dropZone = sourceImages.count > 1 && sourceImages[1].ioSurface != nil;
+  ctx.inpaint = ctx.reference != nil || dropZone;
+  [self scheduleRenderAheadForContext:ctx
+                     destinationImage:destinationImage
+                             dropZone:dropZone];
+
+  if (ctx.inpaint) {
+    [self inpaintWithContext:ctx
+                 sourceImages:sourceImages
+             destinationImage:destinationImage];
+  }
+  return YES;
+}
 
-    id<MTLCommandBuffer> commandBuffer = [_commandQueue commandBuffer];
-    id<MTLComputeCommandEncoder> encoder =
-        [commandBuffer computeCommandEncoder];
-    [encoder setComputePipelineState:_inpaintPipeline];
+// Renders that inpaint hand the prefetcher a planner for the frames ahead:
+// it reads each frame's mask here, inside the render, and the builder works
+// from that copy. All renders feed the playhead prediction, which also tells
+// jumps apart. Fills from a Drop Zone image are not prefetched: only the
+// render gets that image.
+- (void)scheduleRenderAheadForContext:(const gPHYXRenderContext &)ctx
+                     destinationImage:(FxImageTile *)destinationImage
+                             dropZone:(BOOL)dropZone {
+  gPHYXFillPlanner planner = nil;
+  IOSurfaceRef dstSurface = (__bridge IOSurfaceRef)destinationImage.ioSurface;
+  if (ctx.inpaint && !dropZone && dstSurface) {
+    FxRect bounds = destinationImage.imagePixelBounds;
+    NSUInteger width = (NSUInteger)(bounds.right - bounds.left);
+    NSUInteger height = (NSUInteger)(bounds.top - bounds.bottom);
+    gphyx::PixelFormat format = gPHYXPixelFormatForSurface(dstSurface);
+    gphyx::SampleMode sampling = ctx.params.sampling;
+    gPHYXSharedData *data = ctx.data;
+    CGRect roi = ctx.roi;
+    __weak gPHYXFillEffect *weakSelf = self;
+    planner = ^gPHYXFillBuilder(CMTime time) {
+      gPHYXFillEffect *strongSelf = weakSelf;
+      if (!strongSelf)
+        return nil;
+      const gPHYXFillInputs inputs = [strongSelf fillInputsAtTime:time
+                                                            width:width
+                                                           height:height
+                                                              roi:roi];
+      if (inputs.region.size.width == 0 || inputs.region.size.height == 0)
+        return nil;
+      return ^BOOL(CMTime t, gphyx::FillPatch &patch,
+                   const gphyx::CancelToken &cancel) {
+        return [weakSelf buildFillPatch:patch
+                                forData:data
+                                 atTime:t
+                                 inputs:inputs
+                                  width:width
+                                 height:height
+                                 format:format
+                               sampling:sampling
+                                 cancel:cancel];
+      };
+    };
+  }
+  BOOL jumped =
+      [[gPHYXPrefetcher sharedPrefetcher] noteRenderForInstanceID:ctx.instanceID
+                                                             time:ctx.renderTime
+                                                          planner:planner];
+  // After a jump, frames tracked or refined for where the playhead was only
+  // hold the workers up; the frame now shown keeps its tracking job.
+  if (jumped) {
+    [[gPHYXTrackingService sharedService]
+        cancelJobsForInstanceID:ctx.instanceID
+                     exceptTime:ctx.renderTime];
+    [self cancelRefinement];
+  }
+}
 
-    // Create textures from IOSurfaces
-    IOSurfaceRef srcSurface = (__bridge IOSurfaceRef)[inputTile ioSurface];
-    IOSurfaceRef dstSurface =
-        (__bridge IOSurfaceRef)[destinationImage ioSurface];
+// Runs on the prefetch, fill-store and refine workers, so everything from
+// the host comes in `inputs`. Only settled frames are filled; the others need
+// their own render to be tracked first. Fills the disk cache holds are read
+// back, computed ones are written to it.
+- (BOOL)buildFillPatch:(gphyx::FillPatch &)patch
+               forData:(gPHYXSharedData *)data
+                atTime:(CMTime)time
+                inputs:(const gPHYXFillInputs &)inputs
+                 width:(NSUInteger)width
+                height:(NSUInteger)height
+                format:(gphyx::PixelFormat)format
+              sampling:(gphyx::SampleMode)sampling
+                cancel:(const gphyx::CancelToken &)cancel {
+  float homography[9];
+  if (![self resolveHomography:homography
+                       forData:data
+                        atTime:time
+                           roi:inputs.roi
+                     frameSize:CGSizeMake(width, height)])
+    return NO;
+  const MTLRegion region = inputs.region;
+  if (region.size.width == 0 || region.size.height == 0)
+    return NO;
+  gPHYXReferencePlate *plate = [data referencePlate];
+  if (!plate)
+    return NO;
+  // Held on its own: the plate may be replaced while the fill is made.
+  IOSurfaceRef refSurface = (IOSurfaceRef)CFRetain(plate.colorSurface);
+  const gphyx::PixelRect colorRegion = plate.colorRegion;
+
+  gphyx::FillKey key = FillKeyFor(plate.fillSignature, homography,
+                                  inputs.mask.hash, width, height, format,
+                                  sampling);
+  gphyx::FillStore *store = SharedFillStore();
+  if (store && store->find(key, patch)) {
+    CFRelease(refSurface);
+    return YES;
+  }
 
-    MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
-        texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
-                                     width:IOSurfaceGetWidth(srcSurface)
-                                    height:IOSurfaceGetHeight(srcSurface)
-                                 mipmapped:NO];
-    texDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+  gphyx::MaskCoverage coverage = inputs.coverage;
+  if (!coverage)
+    coverage = [_osc maskCoverageForShape:inputs.mask
+                                    width:width
+                                   height:height
+                                   region:region];
+  if (!coverage) {
+    CFRelease(refSurface);
+    return NO;
+  }
 
-    id<MTLTexture> srcTex = [_device newTextureWithDescriptor:texDesc
-                                                    iosurface:srcSurface
-                                                        plane:0];
+  gphyx::InpaintJob job;
+  job.mask.data = coverage->coverage->data;
+  job.mask.bytesPerRow = region.size.width;
+  job.mask.width = (int32_t)region.size.width;
+  job.mask.height = (int32_t)region.size.height;
+  job.mask.tiles = &coverage->tiles;
+  job.region = gphyx::makePixelRect(
+      (int32_t)region.origin.x, (int32_t)region.origin.y,
+      (int32_t)region.size.width, (int32_t)region.size.height);
+  memcpy(job.homography, homography, sizeof(homography));
+  job.sampling = sampling;
+
+  IOSurfaceLock(refSurface, kIOSurfaceLockReadOnly, NULL);
+  job.reference = gPHYXImageViewForTile(nil, refSurface);
+  job.reference.originX = colorRegion.x0;
+  job.reference.originY = colorRegion.y0;
+  job.tiledReference = plate.tiledColor;
+  job.cancel = cancel;
+  BOOL built = gphyx::makeFillPatch(job, format, patch);
+  IOSurfaceUnlock(refSurface, kIOSurfaceLockReadOnly, NULL);
+  CFRelease(refSurface);
+
+  patch.signature = gphyx::hashFillKey(key);
+  if (built && store)
+    store->insert(key, patch);
+  return built;
+}
 
-    MTLTextureDescriptor *dstDesc = [MTLTextureDescriptor
-        texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
-                                     width:IOSurfaceGetWidth(dstSurface)
-                                    height:IOSurfaceGetHeight(dstSurface)
-                                 mipmapped:NO];
-    dstDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
-
-    id<MTLTexture> dstTex = [_device newTextureWithDescriptor:dstDesc
-                                                    iosurface:dstSurface
-                                                        plane:0];
-
-    // Rasterize mask from OSC (Path API)
-    NSLog(@"[gPHYX] Requesting mask texture from OSC (%lu x %lu)",
-          (unsigned long)dstTex.width, (unsigned long)dstTex.height);
-    id<MTLTexture> maskTex = [_osc getMaskTextureForDevice:_device
-                                                     width:dstTex.width
-                                                    height:dstTex.height
-                                                apiManager:_apiManager
-                                                    atTime:renderTime];
-
-    if (!maskTex) {
-      NSLog(@"[gPHYX] Warning: OSC returned nil mask. Creating fallback.");
-      // Fallback: Empty mask (black)
-      MTLTextureDescriptor *maskDesc = [MTLTextureDescriptor
-          texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
-                                       width:dstTex.width
-                                      height:dstTex.height
-                                   mipmapped:NO];
-      maskTex = [_device newTextureWithDescriptor:maskDesc];
-    } else {
-      NSLog(@"[gPHYX] Mask texture received.");
+// Writes the fill this render computed to the disk cache, rebuilding it on
+// the fill-store queue: the render itself may only have covered one tile.
+// `inputs` are the render's, so the stored fill matches its key.
+- (void)persistFillForContext:(const gPHYXRenderContext &)ctx
+                          key:(const gphyx::FillKey &)key
+                       inputs:(const gPHYXFillInputs &)renderInputs
+                     geometry:(const gPHYXInpaintGeometry &)geometry
+                       format:(gphyx::PixelFormat)format {
+  gphyx::FillStore *store = SharedFillStore();
+  if (!store || store->contains(key))
+    return;
+  gPHYXSharedData *data = ctx.data;
+  CMTime time = ctx.renderTime;
+  NSUInteger width = geometry.imageWidth;
+  NSUInteger height = geometry.imageHeight;
+  const gPHYXFillInputs inputs = renderInputs;
+  gphyx::SampleMode sampling = geometry.sampling;
+  gphyx::FillKey wanted = key;
+  __weak gPHYXFillEffect *weakSelf = self;
+  dispatch_async(FillStoreQueue(), ^{
+    if (store->contains(wanted))
+      return;
+    gphyx::FillPatch patch;
+    [weakSelf buildFillPatch:patch
+                     forData:data
+                      atTime:time
+                      inputs:inputs
+                       width:width
+                      height:height
+                      format:format
+                    sampling:sampling
+                      cancel:gphyx::CancelToken()];
+  });
+}
+
+// Paints a prefetched or stored fill into the destination tile if it is the
+// one this render would compute. YES when the tile is done.
+- (BOOL)compositeCachedFillForContext:(const gPHYXRenderContext &)ctx
+                                  key:(const gphyx::FillKey &)key
+                          destination:(IOSurfaceRef)dstSurface
+                                 view:(const gphyx::ImageView &)dstView {
+  std::shared_ptr<const gphyx::FillPatch> patch =
+      [[gPHYXPrefetcher sharedPrefetcher] patchForInstanceID:ctx.instanceID
+                                                        time:ctx.renderTime];
+  BOOL prefetched = YES;
+  if (!patch || patch->signature != gphyx::hashFillKey(key)) {
+    gphyx::FillStore *store = SharedFillStore();
+    auto stored = std::make_shared<gphyx::FillPatch>();
+    if (!store || !store->find(key, *stored))
+      return NO;
+    patch = stored;
+    prefetched = NO;
+  }
+
+  IOSurfaceLock(dstSurface, 0, NULL);
+  BOOL done = gphyx::compositeFillPatch(*patch, dstView);
+  IOSurfaceUnlock(dstSurface, 0, NULL);
+  if (done)
+    gPHYXTrace(@"[gPHYX] %@", prefetched ? @"⏩ Prefetched fill used"
+                                         : @"💾 Stored fill used");
+  return done;
+}
+
+- (void)inpaintWithContext:(const gPHYXRenderContext &)ctx
+              sourceImages:(NSArray<FxImageTile *> *)sourceImages
+          destinationImage:(FxImageTile *)destinationImage {
+  IOSurfaceRef srcSurface = (__bridge IOSurfaceRef)[sourceImages[0] ioSurface];
+  IOSurfaceRef dstSurface = (__bridge IOSurfaceRef)[destinationImage ioSurface];
+  if (!srcSurface || !dstSurface) {
+    return;
+  }
+
+  gphyx::ImageView srcView = gPHYXImageViewForTile(sourceImages[0], srcSurface);
+  gphyx::ImageView dstView =
+      gPHYXImageViewForTile(destinationImage, dstSurface);
+  FxRect imageBounds = destinationImage.imagePixelBounds;
+
+  gPHYXInpaintGeometry geometry = {};
+  geometry.imageWidth = (NSUInteger)(imageBounds.right - imageBounds.left);
+  geometry.imageHeight = (NSUInteger)(imageBounds.top - imageBounds.bottom);
+  geometry.sourceOrigin = OriginOfView(srcView);
+  geometry.destinationOrigin = OriginOfView(dstView);
+  geometry.sampling = ctx.params.sampling;
+
+  // The mask is read once: its region, the fill key and the raster all come
+  // from the same shape. Only the part of the region this tile covers is
+  // filled.
+  gPHYXFillInputs inputs = [self fillInputsAtTime:ctx.renderTime
+                                            width:geometry.imageWidth
+                                           height:geometry.imageHeight
+                                              roi:ctx.roi];
+  const MTLRegion maskRegion = inputs.region;
+  const gphyx::PixelRect maskRect = gphyx::makePixelRect(
+      (int32_t)maskRegion.origin.x, (int32_t)maskRegion.origin.y,
+      (int32_t)maskRegion.size.width, (int32_t)maskRegion.size.height);
+  gphyx::PixelRect region = gphyx::intersectRects(
+      gphyx::intersectRects(maskRect, dstView.imageRect()),
+      srcView.imageRect());
+  if (region.empty()) {
+    gPHYXTrace(@"[gPHYX] Mask region is empty, passthrough only.");
+    return;
+  }
+  geometry.region =
+      MTLRegionMake2D(region.x0, region.y0, region.width(), region.height());
+  gPHYXTrace(@"[gPHYX] Inpaint region %dx%d@(%d,%d) of %lux%lu", region.width(),
+             region.height(), region.x0, region.y0,
+             (unsigned long)geometry.imageWidth,
+             (unsigned long)geometry.imageHeight);
+
+  // Reference surface prioritized:
+  // 1. External Drop Zone Image (if available) -> sourceImages[1]
+  // 2. Internal Captured Reference Frame (ctx.reference)
+  // 3. Current Source Frame (Fallback)
+  IOSurfaceRef refSurface = srcSurface;
+  geometry.referenceOrigin = geometry.sourceOrigin;
+  IOSurfaceRef dropSurface = NULL;
+  BOOL persist = NO;
+  gphyx::FillKey key;
+  if (sourceImages.count > 1) {
+    dropSurface = (__bridge IOSurfaceRef)[sourceImages[1] ioSurface];
+  }
+  if (dropSurface) {
+    // If scheduleInputs worked, Drop Zone image is here
+    refSurface = dropSurface;
+    geometry.referenceOrigin =
+        OriginOfView(gPHYXImageViewForTile(sourceImages[1], dropSurface));
+    gPHYXTrace(@"[gPHYX] Using Drop Zone image for inpainting");
+  } else if (ctx.reference) {
+    key = FillKeyFor(ctx.reference.fillSignature, ctx.homography,
+                     inputs.mask.hash, geometry.imageWidth,
+                     geometry.imageHeight, dstView.format, geometry.sampling);
+    if ([self compositeCachedFillForContext:ctx
+                                        key:key
+                                destination:dstSurface
+                                       view:dstView])
+      return;
+    // An estimate may still change; only tracked fills are worth keeping.
+    persist = ctx.homographyFound;
+    refSurface = ctx.reference.colorSurface;
+    geometry.tiledReference = ctx.reference.tiledColor;
+    geometry.referenceOrigin =
+        MTLOriginMake((NSUInteger)ctx.reference.colorRegion.x0,
+                      (NSUInteger)ctx.reference.colorRegion.y0, 0);
+    gPHYXTrace(@"[gPHYX] Using Shared Internal Reference Frame");
+  }
+
+  // Progressive: a tracked frame whose fill would overrun the budget gets a
+  // coarse one now, nearest-sampled in blocks. The full fill is made in the
+  // background into the fill store, and the host renders the frame again
+  // once it is there.
+  const double pixels = (double)region.area();
+  const BOOL coarse =
+      persist && ctx.params.tier != gPHYXRenderTier::Final &&
+      SharedFillStore() &&
+      [self expectedFillMsForPixels:pixels sampling:geometry.sampling] >
+          kProgressiveBudgetMs;
+  gPHYXInpaintGeometry pass = geometry;
+  if (coarse) {
+    pass.sampling = gphyx::SampleMode::Nearest;
+    pass.coarseStep = kCoarseFillStep;
+    gPHYXTrace(@"[gPHYX] 🟡 Coarse fill, refining in the background");
+  }
+
+  // Rasterize the mask read above, region-sized. A tile holding the whole
+  // region leaves its raster to the background fills as well.
+  const double start = CFAbsoluteTimeGetCurrent();
+  gPHYXTrace(@"[gPHYX] Requesting mask from OSC (%lu x %lu)",
+             (unsigned long)geometry.region.size.width,
+             (unsigned long)geometry.region.size.height);
+  gphyx::MaskCoverage coverage =
+      [_osc maskCoverageForShape:inputs.mask
+                           width:geometry.imageWidth
+                          height:geometry.imageHeight
+                          region:geometry.region];
+  if (region.area() == maskRect.area())
+    inputs.coverage = coverage;
+  if (_inpaintPipeline) {
+    [self inpaintOnGPUWithSource:srcSurface
+                     destination:dstSurface
+                       reference:refSurface
+                        geometry:pass
+                      homography:ctx.homography
+                        coverage:coverage];
+  } else {
+    [self inpaintOnCPUWithSource:srcSurface
+                     destination:dstSurface
+                       reference:refSurface
+                        geometry:pass
+                      homography:ctx.homography
+                        coverage:coverage];
+  }
+  if (coarse) {
+    [self refineFillForContext:ctx
+                           key:key
+                        inputs:inputs
+                      geometry:geometry
+                        format:dstView.format];
+  } else {
+    [self noteFillMs:(CFAbsoluteTimeGetCurrent() - start) * 1000.0
+           forPixels:pixels
+            sampling:geometry.sampling];
+    if (persist)
+      [self persistFillForContext:ctx
+                              key:key
+                           inputs:inputs
+                         geometry:geometry
+                           format:dstView.format];
+  }
+}
+
+// Full fills are timed per mask pixel, by sample mode, to predict the next.
+- (double)expectedFillMsForPixels:(double)pixels
+                         sampling:(gphyx::SampleMode)sampling {
+  return _fillNanosPerPixel[(uint32_t)sampling].load() * pixels * 1e-6;
+}
+
+- (void)noteFillMs:(double)ms
+         forPixels:(double)pixels
+          sampling:(gphyx::SampleMode)sampling {
+  if (pixels <= 0.0)
+    return;
+  std::atomic<double> &cost = _fillNanosPerPixel[(uint32_t)sampling];
+  const double sample = ms * 1e6 / pixels;
+  const double last = cost.load();
+  cost = last > 0.0 ? 0.75 * last + 0.25 * sample : sample;
+}
+
+// Makes the full fill of a frame that was rendered coarse, on the refine
+// queue, from the render's `inputs`, then has the host render the frame
+// again. Only the newest request runs: each one cancels the one before,
+// queued or running.
+- (void)refineFillForContext:(const gPHYXRenderContext &)ctx
+                         key:(const gphyx::FillKey &)key
+                      inputs:(const gPHYXFillInputs &)renderInputs
+                    geometry:(const gPHYXInpaintGeometry &)geometry
+                      format:(gphyx::PixelFormat)format {
+  gphyx::FillStore *store = SharedFillStore();
+  if (!store)
+    return;
+  gPHYXSharedData *data = ctx.data;
+  CMTime time = ctx.renderTime;
+  NSUInteger width = geometry.imageWidth;
+  NSUInteger height = geometry.imageHeight;
+  const gPHYXFillInputs inputs = renderInputs;
+  NSString *instanceID = ctx.instanceID;
+  gphyx::SampleMode sampling = geometry.sampling;
+  gphyx::FillKey wanted = key;
+  const gphyx::CancelToken cancel = gphyx::CancelToken::make();
+  os_unfair_lock_lock(&_cancelLock);
+  _refineCancel.cancel();
+  _refineCancel = cancel;
+  os_unfair_lock_unlock(&_cancelLock);
+  __weak gPHYXFillEffect *weakSelf = self;
+  dispatch_async(RefineQueue(), ^{
+    gPHYXFillEffect *strongSelf = weakSelf;
+    if (!strongSelf || cancel.cancelled())
+      return;
+    if (!store->contains(wanted)) {
+      gphyx::FillPatch patch;
+      if (![strongSelf buildFillPatch:patch
+                              forData:data
+                               atTime:time
+                               inputs:inputs
+                                width:width
+                               height:height
+                               format:format
+                             sampling:sampling
+                               cancel:cancel] ||
+          !store->contains(wanted))
+        return;
     }
+    if (!cancel.cancelled())
+      [strongSelf refreshFrameAtTime:time
+                                data:data
+                          instanceID:instanceID
+                              cancel:cancel];
+  });
+}
+
+// Fills being made for the old mask or plate: the prefetched ones and the
+// refinement.
+- (void)cancelFillsForInstanceID:(NSString *)instanceID {
+  [[gPHYXPrefetcher sharedPrefetcher] invalidateInstanceID:instanceID];
+  [self cancelRefinement];
+}
+
+// Stops the analysis pass under way: the frames left are skipped and the
+// registration in flight is cut short.
+- (void)cancelAnalysis {
+  os_unfair_lock_lock(&_cancelLock);
+  _analysisCancel.cancel();
+  os_unfair_lock_unlock(&_cancelLock);
+  [_visionTracker cancel];
+}
+
+// Stops the refinement queued or running, e.g. once the playhead has left
+// its frame.
+- (void)cancelRefinement {
+  os_unfair_lock_lock(&_cancelLock);
+  _refineCancel.cancel();
+  os_unfair_lock_unlock(&_cancelLock);
+}
+
+// Counting the refinement changes the plugin state of this frame only, so
+// its next render takes the refined fill straight from the fill store. If
+// the playhead is still parked on the frame, the hidden Refresh parameter is
+// bumped as well: the host drops the coarse render it cached and renders
+// again. The playhead itself is left alone. A bump that loses a race with
+// the playhead costs a redundant render, nothing more; without the APIs the
+// refined fill waits for the next natural render.
+- (void)refreshFrameAtTime:(CMTime)time
+                      data:(gPHYXSharedData *)data
+                instanceID:(NSString *)instanceID
+                    cancel:(const gphyx::CancelToken &)cancel {
+  [data noteRefinementAtTime:time];
+  const gphyx::CancelToken token = cancel;
+  __weak gPHYXFillEffect *weakSelf = self;
+  dispatch_async(dispatch_get_main_queue(), ^{
+    gPHYXFillEffect *strongSelf = weakSelf;
+    if (!strongSelf || token.cancelled() ||
+        ![[gPHYXPrefetcher sharedPrefetcher] isLastRenderOfInstanceID:instanceID
+                                                               atTime:time])
+      return;
+    id<PROAPIAccessing> apiManager = strongSelf->_apiManager;
+    id<FxCustomParameterActionAPI_v4> action =
+        [apiManager apiForProtocol:@protocol(FxCustomParameterActionAPI_v4)];
+    id<FxParameterRetrievalAPI_v6> getter =
+        [apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
+    id<FxParameterSettingAPI_v6> setter =
+        [apiManager apiForProtocol:@protocol(FxParameterSettingAPI_v6)];
+    if (!action || !getter || !setter)
+      return;
+    [action startAction:strongSelf];
+    int generation = 0;
+    [getter getIntValue:&generation
+          fromParameter:kParam_Refresh
+                 atTime:kCMTimeZero];
+    [setter setIntValue:generation == INT32_MAX ? 0 : generation + 1
+            toParameter:kParam_Refresh
+                 atTime:kCMTimeZero];
+    [action endAction:strongSelf];
+  });
+}
+
+- (void)inpaintOnGPUWithSource:(IOSurfaceRef)srcSurface
+                   destination:(IOSurfaceRef)dstSurface
+                     reference:(IOSurfaceRef)refSurface
+                      geometry:(const gPHYXInpaintGeometry &)geometry
+                    homography:(const float *)homography
+                      coverage:(const gphyx::MaskCoverage &)coverage {
+  const MTLRegion region = geometry.region;
+  gPHYXTrace(@"[gPHYX] Metal Inpainting triggered...");
+  const MTLPixelFormat srcFormat = gPHYXMetalPixelFormatForSurface(srcSurface);
+  const MTLPixelFormat dstFormat = gPHYXMetalPixelFormatForSurface(dstSurface);
+  const MTLPixelFormat refFormat = gPHYXMetalPixelFormatForSurface(refSurface);
+  if (srcFormat == MTLPixelFormatInvalid ||
+      dstFormat == MTLPixelFormatInvalid ||
+      refFormat == MTLPixelFormatInvalid) {
+    gPHYXTrace(@"[gPHYX] ⚠️ Unsupported surface format, passthrough only.");
+    return;
+  }
 
-    // Reference texture prioritized:
-    // 1. External Drop Zone Image (if available) -> sourceImages[1]
-    // 2. Internal Captured Reference Frame (_referenceBuffer)
-    // 3. Current Source Frame (Fallback)
-    id<MTLTexture> refTex = srcTex;
-
-    if (sourceImages.count > 1) {
-      // If scheduleInputs worked, Drop Zone image is here
-      FxImageTile *dropZoneTile = sourceImages[1];
-      IOSurfaceRef dropSurface =
-          (__bridge IOSurfaceRef)[dropZoneTile ioSurface];
-      MTLTextureDescriptor *dropDesc = [MTLTextureDescriptor
-          texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
-                                       width:IOSurfaceGetWidth(dropSurface)
-                                      height:IOSurfaceGetHeight(dropSurface)
-                                   mipmapped:NO];
-      refTex = [_device newTextureWithDescriptor:dropDesc
-                                       iosurface:dropSurface
-                                           plane:0];
-      NSLog(@"[gPHYX] Using Drop Zone image for inpainting");
-    } else if (data.referenceBuffer) {
-      IOSurfaceRef refSurface = CVPixelBufferGetIOSurface(data.referenceBuffer);
-      MTLTextureDescriptor *refDesc = [MTLTextureDescriptor
-          texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA16Float
-                                       width:IOSurfaceGetWidth(refSurface)
-                                      height:IOSurfaceGetHeight(refSurface)
-                                   mipmapped:NO];
-      refTex = [_device newTextureWithDescriptor:refDesc
-                                       iosurface:refSurface
-                                           plane:0];
-      NSLog(@"[gPHYX] Using Shared Internal Reference Frame");
+  id<MTLTexture> maskTex = [_osc getMaskTextureForDevice:_device
+                                                coverage:coverage
+                                                  region:region];
+  // Empty tiles keep the passthrough copy, so only the others are dispatched.
+  std::vector<gPHYXMaskTile> tiles;
+  if (maskTex) {
+    const gphyx::MaskTiles &occupancy = coverage->tiles;
+    tiles.reserve(occupancy.active.size());
+    for (uint32_t index : occupancy.active) {
+      const int32_t column = (int32_t)(index % (uint32_t)occupancy.columns);
+      const int32_t row = (int32_t)(index / (uint32_t)occupancy.columns);
+      gPHYXMaskTile tile;
+      tile.origin = simd_make_ushort2(
+          (uint16_t)(column * gphyx::kMaskTileSize),
+          (uint16_t)(row * gphyx::kMaskTileSize));
+      tile.full = occupancy.at(column, row) == gphyx::TileCoverage::Full;
+      tiles.push_back(tile);
     }
+  }
+  if (tiles.empty()) {
+    gPHYXTrace(@"[gPHYX] Mask is empty in this region, passthrough only.");
+    return;
+  }
+  gPHYXTrace(@"[gPHYX] Mask texture received, %lu of %lu tiles active.",
+             (unsigned long)tiles.size(),
+             (unsigned long)coverage->tiles.tiles.size());
+
+  id<MTLCommandBuffer> commandBuffer = [_commandQueue commandBuffer];
+  id<MTLComputeCommandEncoder> encoder = [commandBuffer computeCommandEncoder];
+  [encoder setComputePipelineState:_inpaintPipeline];
+
+  // Create textures from IOSurfaces
+  MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
+      texture2DDescriptorWithPixelFormat:srcFormat
+                                   width:IOSurfaceGetWidth(srcSurface)
+                                  height:IOSurfaceGetHeight(srcSurface)
+                               mipmapped:NO];
+  texDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+
+  id<MTLTexture> srcTex = [_device newTextureWithDescriptor:texDesc
+                                                  iosurface:srcSurface
+                                                      plane:0];
+
+  MTLTextureDescriptor *dstDesc = [MTLTextureDescriptor
+      texture2DDescriptorWithPixelFormat:dstFormat
+                                   width:IOSurfaceGetWidth(dstSurface)
+                                  height:IOSurfaceGetHeight(dstSurface)
+                               mipmapped:NO];
+  dstDesc.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+
+  id<MTLTexture> dstTex = [_device newTextureWithDescriptor:dstDesc
+                                                  iosurface:dstSurface
+                                                      plane:0];
+
+  id<MTLTexture> refTex = srcTex;
+  if (refSurface != srcSurface) {
+    MTLTextureDescriptor *refDesc = [MTLTextureDescriptor
+        texture2DDescriptorWithPixelFormat:refFormat
+                                     width:IOSurfaceGetWidth(refSurface)
+                                    height:IOSurfaceGetHeight(refSurface)
+                                 mipmapped:NO];
+    refTex = [_device newTextureWithDescriptor:refDesc
+                                     iosurface:refSurface
+                                         plane:0];
+  }
+
+  // Homography Matrix (Buffer 0). float3x3 columns are 16-byte aligned in
+  // Metal, so pack through simd rather than passing the 9 raw floats.
+  simd_float3x3 h = simd_matrix(
+      simd_make_float3(homography[0], homography[1], homography[2]),
+      simd_make_float3(homography[3], homography[4], homography[5]),
+      simd_make_float3(homography[6], homography[7], homography[8]));
+  [encoder setBytes:&h length:sizeof(h) atIndex:0];
+
+  gPHYXInpaintParams params;
+  params.regionOrigin =
+      simd_make_uint2((uint32_t)region.origin.x, (uint32_t)region.origin.y);
+  params.regionSize = simd_make_uint2((uint32_t)region.size.width,
+                                      (uint32_t)region.size.height);
+  params.sourceOrigin = simd_make_uint2((uint32_t)geometry.sourceOrigin.x,
+                                        (uint32_t)geometry.sourceOrigin.y);
+  params.destinationOrigin =
+      simd_make_uint2((uint32_t)geometry.destinationOrigin.x,
+                      (uint32_t)geometry.destinationOrigin.y);
+  params.referenceOrigin =
+      simd_make_uint2((uint32_t)geometry.referenceOrigin.x,
+                      (uint32_t)geometry.referenceOrigin.y);
+  params.sampling = (uint32_t)geometry.sampling;
+  [encoder setBytes:&params length:sizeof(params) atIndex:1];
+  // Tile list (Buffer 2): inline when it fits, else a pooled buffer that is
+  // free again once the command buffer completed below.
+  const NSUInteger tileBytes = tiles.size() * sizeof(gPHYXMaskTile);
+  id<MTLBuffer> tileBuffer = nil;
+  if (tileBytes <= kMaxInlineBytes) {
+    [encoder setBytes:tiles.data() length:tileBytes atIndex:2];
+  } else {
+    tileBuffer = [self acquireTileBufferWithLength:tileBytes];
+    memcpy(tileBuffer.contents, tiles.data(), tileBytes);
+    [encoder setBuffer:tileBuffer offset:0 atIndex:2];
+  }
 
-    // Homography Matrix (Buffer 0)
-    [encoder setBytes:_homography length:sizeof(_homography) atIndex:0];
+  [encoder setTexture:srcTex atIndex:0];
+  [encoder setTexture:dstTex atIndex:1];
+  [encoder setTexture:maskTex atIndex:2];
+  [encoder setTexture:refTex atIndex:3];
+
+  MTLSize threadGroupSize = MTLSizeMake(16, 16, 1);
+  MTLSize threadGroups =
+      MTLSizeMake(GPHYX_MASK_TILE_SIZE / threadGroupSize.width,
+                  GPHYX_MASK_TILE_SIZE / threadGroupSize.height, tiles.size());
+
+  [encoder dispatchThreadgroups:threadGroups
+          threadsPerThreadgroup:threadGroupSize];
+  [encoder endEncoding];
+  [commandBuffer commit];
+  [commandBuffer waitUntilCompleted];
+  if (tileBuffer)
+    [self recycleTileBuffer:tileBuffer];
+  gPHYXTrace(@"[gPHYX] Metal Clean Plate Inpainting completed.");
+}
 
-    [encoder setTexture:srcTex atIndex:0];
-    [encoder setTexture:dstTex atIndex:1];
-    [encoder setTexture:maskTex atIndex:2];
-    [encoder setTexture:refTex atIndex:3];
+// An idle tile buffer of at least `length` bytes, or a new one. Concurrent
+// renders each get their own.
+- (id<MTLBuffer>)acquireTileBufferWithLength:(NSUInteger)length {
+  os_unfair_lock_lock(&_tileBufferLock);
+  for (auto it = _tileBuffers.begin(); it != _tileBuffers.end(); ++it) {
+    if ((*it).length >= length) {
+      id<MTLBuffer> buffer = *it;
+      _tileBuffers.erase(it);
+      os_unfair_lock_unlock(&_tileBufferLock);
+      return buffer;
+    }
+  }
+  os_unfair_lock_unlock(&_tileBufferLock);
+  // Rounded up so a slightly larger mask next frame still fits.
+  NSUInteger rounded = kMaxInlineBytes;
+  while (rounded < length)
+    rounded *= 2;
+  return [_device newBufferWithLength:rounded
+                              options:MTLResourceStorageModeShared];
+}
 
-    MTLSize threadGroupSize = MTLSizeMake(16, 16, 1);
-    MTLSize threadGroups = MTLSizeMake(
-        (dstTex.width + threadGroupSize.width - 1) / threadGroupSize.width,
-        (dstTex.height + threadGroupSize.height - 1) / threadGroupSize.height,
-        1);
+- (void)recycleTileBuffer:(id<MTLBuffer>)buffer {
+  os_unfair_lock_lock(&_tileBufferLock);
+  if (_tileBuffers.size() < kMaxIdleTileBuffers)
+    _tileBuffers.push_back(buffer);
+  os_unfair_lock_unlock(&_tileBufferLock);
+}
 
-    [encoder dispatchThreadgroups:threadGroups
-            threadsPerThreadgroup:threadGroupSize];
-    [encoder endEncoding];
-    [commandBuffer commit];
-    [commandBuffer waitUntilCompleted];
-    NSLog(@"[gPHYX] Metal Clean Plate Inpainting completed.");
+// Same clean-plate composite as inpaint_kernel, on the CPU. Used when no
+// Metal pipeline is available.
+- (void)inpaintOnCPUWithSource:(IOSurfaceRef)srcSurface
+                   destination:(IOSurfaceRef)dstSurface
+                     reference:(IOSurfaceRef)refSurface
+                      geometry:(const gPHYXInpaintGeometry &)geometry
+                    homography:(const float *)homography
+                      coverage:(const gphyx::MaskCoverage &)coverage {
+  gPHYXTrace(@"[gPHYX] CPU Inpainting triggered...");
+  const MTLRegion region = geometry.region;
+
+  if (!coverage) {
+    gPHYXTrace(@"[gPHYX] Warning: OSC returned nil mask. Passthrough only.");
+    return;
   }
 
-  return YES;
+  IOSurfaceLock(srcSurface, kIOSurfaceLockReadOnly, NULL);
+  if (refSurface != srcSurface)
+    IOSurfaceLock(refSurface, kIOSurfaceLockReadOnly, NULL);
+  IOSurfaceLock(dstSurface, 0, NULL);
+
+  gphyx::InpaintJob job;
+  job.source = gPHYXImageViewForTile(nil, srcSurface);
+  job.destination = gPHYXImageViewForTile(nil, dstSurface);
+  job.reference = gPHYXImageViewForTile(nil, refSurface);
+  job.source.originX = (int32_t)geometry.sourceOrigin.x;
+  job.source.originY = (int32_t)geometry.sourceOrigin.y;
+  job.destination.originX = (int32_t)geometry.destinationOrigin.x;
+  job.destination.originY = (int32_t)geometry.destinationOrigin.y;
+  job.reference.originX = (int32_t)geometry.referenceOrigin.x;
+  job.reference.originY = (int32_t)geometry.referenceOrigin.y;
+  job.tiledReference = geometry.tiledReference;
+  job.coarseStep = std::max(geometry.coarseStep, 1);
+  job.mask.data = coverage->coverage->data;
+  job.mask.bytesPerRow = region.size.width;
+  job.mask.width = (int32_t)region.size.width;
+  job.mask.height = (int32_t)region.size.height;
+  job.mask.tiles = &coverage->tiles;
+  job.region = gphyx::makePixelRect(
+      (int32_t)region.origin.x, (int32_t)region.origin.y,
+      (int32_t)region.size.width, (int32_t)region.size.height);
+  memcpy(job.homography, homography, sizeof(job.homography));
+  job.sampling = geometry.sampling;
+
+  if (gphyx::inpaintCPU(job)) {
+    gPHYXTrace(@"[gPHYX] CPU Clean Plate Inpainting completed.");
+  } else {
+    gPHYXTrace(@"[gPHYX] CPU Inpainting skipped: unsupported surfaces.");
+  }
+
+  IOSurfaceUnlock(dstSurface, 0, NULL);
+  if (refSurface != srcSurface)
+    IOSurfaceUnlock(refSurface, kIOSurfaceLockReadOnly, NULL);
+  IOSurfaceUnlock(srcSurface, kIOSurfaceLockReadOnly, NULL);
 }
 
 - (BOOL)scheduleInputs:(NSArray<FxImageTileRequest *> *_Nullable *_Nullable)
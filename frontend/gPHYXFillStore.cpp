@@ -0,0 +1,430 @@
+#include "gPHYXFillStore.h"
+#include "gPHYXHash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+namespace gphyx {
+
+namespace {
+
+const char kSegmentMagic[8] = {'G', 'P', 'H', 'X', 'F', 'I', 'L', 0};
+const uint32_t kSegmentVersion = 2; // 2: hashBytesFast payload hash
+const char kSegmentSuffix[] = ".gphyxfill";
+
+struct SegmentHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordHeaderSize;
+  uint8_t reserved[48];
+};
+static_assert(sizeof(SegmentHeader) == 64, "fill segment header layout");
+
+// Followed by storedBytes of zlib data: the pixels, then the coverage.
+struct RecordHeader {
+  uint64_t content;
+  uint64_t mask;
+  uint64_t params;
+  int32_t x0, y0, x1, y1;
+  uint32_t format;
+  uint32_t pixelBytes;
+  uint32_t coverageBytes;
+  uint32_t storedBytes;
+  uint64_t payloadHash;
+  uint32_t reserved;
+  uint32_t checksum; // of everything above
+};
+static_assert(sizeof(RecordHeader) == 72, "fill record header layout");
+
+uint32_t headerChecksum(const RecordHeader &h) {
+  return (uint32_t)hashBytes(&h, offsetof(RecordHeader, checksum));
+}
+
+bool headerValid(const RecordHeader &h) {
+  if (h.checksum != headerChecksum(h) || h.x1 <= h.x0 || h.y1 <= h.y0 ||
+      h.format == 0 || h.format > (uint32_t)PixelFormat::RGBA32F)
+    return false;
+  const uint64_t area = (uint64_t)(h.x1 - h.x0) * (uint64_t)(h.y1 - h.y0);
+  return h.coverageBytes == area &&
+         h.pixelBytes == area * bytesPerPixel((PixelFormat)h.format);
+}
+
+std::string segmentPath(const std::string &directory, uint32_t id) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%08x%s", id, kSegmentSuffix);
+  return directory + "/" + name;
+}
+
+// Segment id from a file name, false for anything else in the directory.
+bool parseSegmentName(const char *name, uint32_t *id) {
+  const size_t length = std::strlen(name);
+  const size_t suffix = sizeof(kSegmentSuffix) - 1;
+  if (length != 8 + suffix || std::strcmp(name + 8, kSegmentSuffix) != 0)
+    return false;
+  char *end = nullptr;
+  unsigned long value = std::strtoul(name, &end, 16);
+  if (end != name + 8)
+    return false;
+  *id = (uint32_t)value;
+  return true;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0)
+      return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+bool deflatePatch(const FillPatch &patch, std::vector<uint8_t> &out) {
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  // Fills are re-read far more often than written, but a write must not
+  // outlast the render that caused it: fastest level.
+  if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK)
+    return false;
+  out.resize(deflateBound(&zs, (uLong)patch.bytes()));
+  zs.next_out = out.data();
+  zs.avail_out = (uInt)out.size();
+
+  zs.next_in = const_cast<Bytef *>(patch.pixels.data());
+  zs.avail_in = (uInt)patch.pixels.size();
+  int status = deflate(&zs, Z_NO_FLUSH);
+  if (status == Z_OK) {
+    zs.next_in = const_cast<Bytef *>(patch.coverage.data());
+    zs.avail_in = (uInt)patch.coverage.size();
+    status = deflate(&zs, Z_FINISH);
+  }
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return status == Z_STREAM_END;
+}
+
+bool inflatePatch(const uint8_t *data, size_t size, FillPatch &out) {
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  if (inflateInit(&zs) != Z_OK)
+    return false;
+  zs.next_in = const_cast<Bytef *>(data);
+  zs.avail_in = (uInt)size;
+
+  zs.next_out = out.pixels.data();
+  zs.avail_out = (uInt)out.pixels.size();
+  int status = inflate(&zs, Z_SYNC_FLUSH);
+  if (status == Z_OK && zs.avail_out == 0) {
+    zs.next_out = out.coverage.data();
+    zs.avail_out = (uInt)out.coverage.size();
+    status = inflate(&zs, Z_FINISH);
+  }
+  const bool complete = status == Z_STREAM_END && zs.avail_out == 0;
+  inflateEnd(&zs);
+  return complete;
+}
+
+} // namespace
+
+uint64_t hashFillKey(const FillKey &key) {
+  const uint64_t words[3] = {key.content, key.mask, key.params};
+  return hashBytes(words, sizeof(words));
+}
+
+struct FillStore::Mapping {
+  const uint8_t *base = nullptr;
+  size_t size = 0;
+
+  ~Mapping() {
+    if (base)
+      ::munmap(const_cast<uint8_t *>(base), size);
+  }
+};
+
+// Segments are the unit of eviction, so keep a handful per budget.
+FillStore::FillStore(std::string directory, size_t budgetBytes,
+                     size_t segmentBytes)
+    : directory_(std::move(directory)), budget_(budgetBytes),
+      segmentBytes_(std::max<size_t>(
+          1u << 20, std::min(segmentBytes, budgetBytes / 4))) {}
+
+FillStore::~FillStore() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+void FillStore::openLocked() {
+  if (opened_)
+    return;
+  opened_ = true;
+  DIR *dir = ::opendir(directory_.c_str());
+  if (!dir)
+    return;
+  std::vector<uint32_t> ids;
+  while (struct dirent *entry = ::readdir(dir)) {
+    uint32_t id;
+    if (parseSegmentName(entry->d_name, &id))
+      ids.push_back(id);
+  }
+  ::closedir(dir);
+
+  std::sort(ids.begin(), ids.end());
+  for (uint32_t id : ids) {
+    Segment segment;
+    segment.path = segmentPath(directory_, id);
+    scanLocked(id, segment);
+    if (segment.size == 0) {
+      ::unlink(segment.path.c_str());
+      continue;
+    }
+    bytes_ += segment.size;
+    segments_[id] = std::move(segment);
+  }
+  evictLocked();
+}
+
+// Indexes the records of one segment, later ones replacing earlier ones with
+// the same key, and cuts off a record torn by a crash mid-append. Leaves
+// segment.size at 0 when the file is not a segment.
+void FillStore::scanLocked(uint32_t id, Segment &segment) {
+  int fd = ::open(segment.path.c_str(), O_RDWR);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SegmentHeader)) {
+    ::close(fd);
+    return;
+  }
+  const size_t size = (size_t)st.st_size;
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    ::close(fd);
+    return;
+  }
+  auto mapping = std::make_shared<Mapping>();
+  mapping->base = static_cast<const uint8_t *>(map);
+  mapping->size = size;
+
+  SegmentHeader header;
+  std::memcpy(&header, mapping->base, sizeof(header));
+  if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+      header.version != kSegmentVersion ||
+      header.recordHeaderSize != sizeof(RecordHeader)) {
+    ::close(fd);
+    return;
+  }
+
+  size_t offset = sizeof(SegmentHeader);
+  while (offset + sizeof(RecordHeader) <= size) {
+    RecordHeader record;
+    std::memcpy(&record, mapping->base + offset, sizeof(record));
+    if (!headerValid(record) ||
+        record.storedBytes > size - offset - sizeof(RecordHeader))
+      break;
+    index_[FillKey{record.content, record.mask, record.params}] =
+        Location{id, offset};
+    offset += sizeof(RecordHeader) + record.storedBytes;
+  }
+  if (offset < size)
+    ::ftruncate(fd, (off_t)offset);
+  ::close(fd);
+  segment.size = offset;
+  segment.mapping = mapping;
+}
+
+std::shared_ptr<const FillStore::Mapping>
+FillStore::mappingLocked(uint32_t id, size_t end) {
+  auto it = segments_.find(id);
+  if (it == segments_.end() || end > it->second.size)
+    return nullptr;
+  Segment &segment = it->second;
+  if (segment.mapping && segment.mapping->size >= end)
+    return segment.mapping;
+
+  // The newest segment grew since it was mapped; map all of it again.
+  int fd = ::open(segment.path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  void *map = ::mmap(nullptr, segment.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return nullptr;
+  auto mapping = std::make_shared<Mapping>();
+  mapping->base = static_cast<const uint8_t *>(map);
+  mapping->size = segment.size;
+  segment.mapping = mapping;
+  return mapping;
+}
+
+bool FillStore::find(const FillKey &key, FillPatch &out) {
+  std::shared_ptr<const Mapping> mapping;
+  Location location;
+  RecordHeader record;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    openLocked();
+    auto it = index_.find(key);
+    if (it == index_.end())
+      return false;
+    location = it->second;
+    mapping = mappingLocked(location.segment,
+                            location.offset + sizeof(RecordHeader));
+    if (!mapping)
+      return false;
+    std::memcpy(&record, mapping->base + location.offset, sizeof(record));
+    mapping = mappingLocked(location.segment, location.offset +
+                                                  sizeof(RecordHeader) +
+                                                  record.storedBytes);
+    if (!mapping)
+      return false;
+  }
+
+  // Decompressed outside the lock; the mapping stays valid even if the
+  // segment is evicted meanwhile.
+  const uint8_t *payload =
+      mapping->base + location.offset + sizeof(RecordHeader);
+  out.region = PixelRect{record.x0, record.y0, record.x1, record.y1};
+  out.format = (PixelFormat)record.format;
+  out.signature = hashFillKey(key);
+  out.pixels.resize(record.pixelBytes);
+  out.coverage.resize(record.coverageBytes);
+  if (hashBytesFast(payload, record.storedBytes) == record.payloadHash &&
+      inflatePatch(payload, record.storedBytes, out))
+    return true;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end() && it->second.segment == location.segment &&
+      it->second.offset == location.offset)
+    index_.erase(it);
+  return false;
+}
+
+bool FillStore::contains(const FillKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  openLocked();
+  return index_.count(key) != 0;
+}
+
+bool FillStore::insert(const FillKey &key, const FillPatch &patch) {
+  const size_t area = (size_t)patch.region.width() * patch.region.height();
+  if (patch.region.empty() || patch.coverage.size() != area ||
+      patch.pixels.size() != area * bytesPerPixel(patch.format) ||
+      patch.pixels.size() > UINT32_MAX || contains(key))
+    return false;
+
+  std::vector<uint8_t> payload;
+  if (!deflatePatch(patch, payload) || payload.size() > UINT32_MAX)
+    return false;
+  RecordHeader record;
+  std::memset(&record, 0, sizeof(record));
+  record.content = key.content;
+  record.mask = key.mask;
+  record.params = key.params;
+  record.x0 = patch.region.x0;
+  record.y0 = patch.region.y0;
+  record.x1 = patch.region.x1;
+  record.y1 = patch.region.y1;
+  record.format = (uint32_t)patch.format;
+  record.pixelBytes = (uint32_t)patch.pixels.size();
+  record.coverageBytes = (uint32_t)patch.coverage.size();
+  record.storedBytes = (uint32_t)payload.size();
+  record.payloadHash = hashBytesFast(payload.data(), payload.size());
+  record.checksum = headerChecksum(record);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.count(key))
+    return true;
+  if (!appendLocked(key, &record, sizeof(record), payload.data(),
+                    payload.size()))
+    return false;
+  evictLocked();
+  return true;
+}
+
+bool FillStore::appendLocked(const FillKey &key, const void *header,
+                             size_t headerSize, const void *payload,
+                             size_t payloadSize) {
+  const size_t recordSize = headerSize + payloadSize;
+  const bool rotate =
+      segments_.empty() ||
+      (segments_.rbegin()->second.size > sizeof(SegmentHeader) &&
+       segments_.rbegin()->second.size + recordSize > segmentBytes_);
+  if (rotate) {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    const uint32_t id = segments_.empty() ? 1 : segments_.rbegin()->first + 1;
+    Segment segment;
+    segment.path = segmentPath(directory_, id);
+    int fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND,
+                    0644);
+    if (fd < 0)
+      return false;
+    SegmentHeader sh;
+    std::memset(&sh, 0, sizeof(sh));
+    std::memcpy(sh.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    sh.version = kSegmentVersion;
+    sh.recordHeaderSize = sizeof(RecordHeader);
+    if (!writeAll(fd, &sh, sizeof(sh))) {
+      ::close(fd);
+      ::unlink(segment.path.c_str());
+      return false;
+    }
+    segment.size = sizeof(sh);
+    bytes_ += segment.size;
+    segments_[id] = std::move(segment);
+    fd_ = fd;
+  } else if (fd_ < 0) {
+    fd_ = ::open(segments_.rbegin()->second.path.c_str(), O_RDWR | O_APPEND);
+    if (fd_ < 0)
+      return false;
+  }
+
+  Segment &segment = segments_.rbegin()->second;
+  if (!writeAll(fd_, header, headerSize) ||
+      !writeAll(fd_, payload, payloadSize)) {
+    // Leave no partial record behind for the next append to follow.
+    ::ftruncate(fd_, (off_t)segment.size);
+    return false;
+  }
+  index_[key] = Location{segments_.rbegin()->first, segment.size};
+  segment.size += recordSize;
+  bytes_ += recordSize;
+  return true;
+}
+
+void FillStore::evictLocked() {
+  while (bytes_ > budget_ && segments_.size() > 1) {
+    auto oldest = segments_.begin();
+    const uint32_t id = oldest->first;
+    for (auto it = index_.begin(); it != index_.end();) {
+      if (it->second.segment == id)
+        it = index_.erase(it);
+      else
+        ++it;
+    }
+    ::unlink(oldest->second.path.c_str());
+    bytes_ -= oldest->second.size;
+    segments_.erase(oldest);
+  }
+}
+
+size_t FillStore::bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  openLocked();
+  return bytes_;
+}
+
+} // namespace gphyx
@@ -0,0 +1,88 @@
+#ifndef gPHYXFillStore_h
+#define gPHYXFillStore_h
+
+#include "gPHYXRenderAhead.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace gphyx {
+
+// Everything a fill's pixels are a function of. The source frame is not part
+// of it: a fill only replaces covered pixels, which come from the plate.
+struct FillKey {
+  uint64_t content = 0; // reference plate the fill samples
+  uint64_t mask = 0;    // mask shape at the frame
+  uint64_t params = 0;  // homography, frame size, format, sampling
+
+  bool operator==(const FillKey &o) const {
+    return content == o.content && mask == o.mask && params == o.params;
+  }
+};
+
+uint64_t hashFillKey(const FillKey &key);
+
+// Disk cache of fill patches shared by all instances, so re-renders and
+// repeated exports read fills back instead of recomputing them. Patches are
+// zlib-compressed and appended to segment files of a bounded size in
+// `directory`; segments are memory-mapped for reads and dropped oldest first
+// once the files exceed the budget. Native byte order.
+class FillStore {
+public:
+  FillStore(std::string directory, size_t budgetBytes,
+            size_t segmentBytes = 64u << 20);
+  ~FillStore();
+
+  FillStore(const FillStore &) = delete;
+  FillStore &operator=(const FillStore &) = delete;
+
+  // Decodes the patch stored for `key`; its signature is hashFillKey(key).
+  bool find(const FillKey &key, FillPatch &out);
+  bool contains(const FillKey &key);
+  // Appends `patch` unless `key` is stored already.
+  bool insert(const FillKey &key, const FillPatch &patch);
+
+  size_t bytes();
+
+private:
+  struct Mapping; // read-only map of a segment prefix
+  struct Segment {
+    std::string path;
+    size_t size = 0;
+    std::shared_ptr<const Mapping> mapping;
+  };
+  struct Location {
+    uint32_t segment;
+    size_t offset; // of the record header
+  };
+  struct KeyHash {
+    size_t operator()(const FillKey &k) const {
+      return (size_t)hashFillKey(k);
+    }
+  };
+
+  void openLocked();
+  void scanLocked(uint32_t id, Segment &segment);
+  bool appendLocked(const FillKey &key, const void *header, size_t headerSize,
+                    const void *payload, size_t payloadSize);
+  void evictLocked();
+  std::shared_ptr<const Mapping> mappingLocked(uint32_t id, size_t end);
+
+  std::string directory_;
+  size_t budget_;
+  size_t segmentBytes_;
+  std::mutex mutex_;
+  bool opened_ = false;
+  std::map<uint32_t, Segment> segments_; // by id, oldest first
+  std::unordered_map<FillKey, Location, KeyHash> index_;
+  size_t bytes_ = 0;
+  int fd_ = -1; // newest segment, open for append
+};
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,77 @@
+#include "gPHYXFootprint.h"
+#include <algorithm>
+#include <cmath>
+
+namespace gphyx {
+
+namespace {
+
+// The kernels warp in float; keep their rounding error inside the footprint.
+const double kWarpSlack = 1.0 / 64.0;
+
+} // namespace
+
+int32_t samplingRadius(SampleMode mode) {
+  switch (mode) {
+  case SampleMode::Bilinear:
+    return 1;
+  case SampleMode::Bicubic:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+PixelRect warpedFootprint(const PixelRect &rect, const float *homography,
+                          int32_t radius, const PixelRect &refBounds) {
+  if (rect.empty() || refBounds.empty())
+    return PixelRect();
+
+  const float *h = homography;
+  // The kernels map integer pixel positions, so the outermost ones are the
+  // corners that matter.
+  const double xs[2] = {(double)rect.x0, (double)(rect.x1 - 1)};
+  const double ys[2] = {(double)rect.y0, (double)(rect.y1 - 1)};
+
+  double minX = INFINITY, minY = INFINITY;
+  double maxX = -INFINITY, maxY = -INFINITY;
+  for (double y : ys) {
+    for (double x : xs) {
+      // w is affine in (x, y), so w > 0 at the corners means w > 0 over the
+      // whole rect and the warped rect is the convex hull of its corners.
+      double w = h[2] * x + h[5] * y + h[8];
+      if (!(w > 1e-12))
+        return refBounds;
+      double mx = (h[0] * x + h[3] * y + h[6]) / w;
+      double my = (h[1] * x + h[4] * y + h[7]) / w;
+      if (!std::isfinite(mx) || !std::isfinite(my))
+        return refBounds;
+      minX = std::min(minX, mx - kWarpSlack);
+      minY = std::min(minY, my - kWarpSlack);
+      maxX = std::max(maxX, mx + kWarpSlack);
+      maxY = std::max(maxY, my + kWarpSlack);
+    }
+  }
+
+  // Clamp in double first so far-away warps can't overflow int32. The +1
+  // covers the pixel the max corner falls in.
+  const double lo = (double)INT32_MIN / 2, hi = (double)INT32_MAX / 2;
+  PixelRect r;
+  r.x0 = (int32_t)std::floor(std::max(lo, minX)) - radius;
+  r.y0 = (int32_t)std::floor(std::max(lo, minY)) - radius;
+  r.x1 = (int32_t)std::floor(std::min(hi, maxX)) + 1 + radius;
+  r.y1 = (int32_t)std::floor(std::min(hi, maxY)) + 1 + radius;
+  return intersectRects(r, refBounds);
+}
+
+PixelRect referenceFootprint(const PixelRect &dstTile,
+                             const PixelRect &maskRegion,
+                             const float *homography, SampleMode mode,
+                             const PixelRect &refBounds) {
+  PixelRect filled = intersectRects(dstTile, maskRegion);
+  if (filled.empty())
+    return PixelRect();
+  return warpedFootprint(filled, homography, samplingRadius(mode), refBounds);
+}
+
+} // namespace gphyx
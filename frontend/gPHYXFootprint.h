@@ -0,0 +1,31 @@
+#ifndef gPHYXFootprint_h
+#define gPHYXFootprint_h
+
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXRegion.h"
+
+namespace gphyx {
+
+// Source footprints for tiled rendering. Every rect is in the image space of
+// its own image (top-left origin); the homography maps destination image
+// pixels to reference image pixels, column-major, as in InpaintJob.
+
+// Reference pixels a sampler reads beyond the one its position falls in.
+int32_t samplingRadius(SampleMode mode);
+
+// Bounds of `rect` pushed through `homography`, grown by `radius` and clipped
+// to `refBounds`. Returns all of refBounds when the warp is degenerate over
+// the rect (a corner on or behind the horizon, non-finite result).
+PixelRect warpedFootprint(const PixelRect &rect, const float *homography,
+                          int32_t radius, const PixelRect &refBounds);
+
+// Reference pixels needed to fill `dstTile`: only the part of the tile inside
+// `maskRegion` reads the reference. Empty when the tile misses the mask.
+PixelRect referenceFootprint(const PixelRect &dstTile,
+                             const PixelRect &maskRegion,
+                             const float *homography, SampleMode mode,
+                             const PixelRect &refBounds);
+
+} // namespace gphyx
+
+#endif
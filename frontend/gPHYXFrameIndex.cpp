@@ -0,0 +1,98 @@
+#include "gPHYXFrameIndex.h"
+#include "gPHYXHash.h"
+#include <cstring>
+
+namespace gphyx {
+
+namespace {
+
+// Probe grid per axis: 64 raw pixels, at most 1 KB per entry.
+const int32_t kProbeGrid = 8;
+
+} // namespace
+
+bool FrameContent::sameAs(const FrameContent &o) const {
+  return hash == o.hash && format == o.format && rect.x0 == o.rect.x0 &&
+         rect.y0 == o.rect.y0 && rect.x1 == o.rect.x1 &&
+         rect.y1 == o.rect.y1 && probe == o.probe;
+}
+
+bool frameContent(const ImageView &view, const PixelRect &rect,
+                  FrameContent &out) {
+  if (!view.valid() || rect.empty())
+    return false;
+  const PixelRect covered = intersectRects(rect, view.imageRect());
+  if (covered.x0 != rect.x0 || covered.y0 != rect.y0 ||
+      covered.x1 != rect.x1 || covered.y1 != rect.y1)
+    return false;
+
+  const size_t bpp = bytesPerPixel(view.format);
+  const size_t rowBytes = (size_t)rect.width() * bpp;
+  const size_t x0 = (size_t)(rect.x0 - view.originX) * bpp;
+  const int32_t coords[4] = {rect.x0, rect.y0, rect.x1, rect.y1};
+  uint64_t h = hashBytes(coords, sizeof(coords));
+  for (int32_t y = rect.y0; y < rect.y1; y++)
+    h = hashBytesFast(view.row(y - view.originY) + x0, rowBytes, h);
+
+  out.hash = h;
+  out.rect = rect;
+  out.format = view.format;
+  out.probe.resize((size_t)(kProbeGrid * kProbeGrid) * bpp);
+  uint8_t *probe = out.probe.data();
+  for (int32_t j = 0; j < kProbeGrid; j++) {
+    int32_t y = rect.y0 + (int32_t)((int64_t)rect.height() * (2 * j + 1) /
+                                    (2 * kProbeGrid));
+    const uint8_t *row = view.row(y - view.originY);
+    for (int32_t i = 0; i < kProbeGrid; i++, probe += bpp) {
+      int32_t x = rect.x0 + (int32_t)((int64_t)rect.width() * (2 * i + 1) /
+                                      (2 * kProbeGrid));
+      std::memcpy(probe, row + (size_t)(x - view.originX) * bpp, bpp);
+    }
+  }
+  return true;
+}
+
+FrameIndex::FrameIndex(size_t capacity) : capacity_(capacity) {}
+
+bool FrameIndex::find(const FrameContent &content, MediaTime *out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(content.hash);
+  if (it == entries_.end() || !it->second.content.sameAs(content))
+    return false;
+  *out = it->second.time;
+  return true;
+}
+
+void FrameIndex::insert(const FrameContent &content, const MediaTime &t) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(content.hash);
+  if (it != entries_.end()) {
+    // Same content keeps its first frame; a colliding one takes the slot.
+    if (it->second.content.sameAs(content))
+      return;
+    it->second.content = content;
+    it->second.time = t;
+    return;
+  }
+  order_.push_back(content.hash);
+  entries_[content.hash] = Entry{content, t};
+  while (entries_.size() > capacity_) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+  }
+}
+
+void FrameIndex::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  order_.clear();
+}
+
+size_t FrameIndex::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Map node plus list node per entry.
+  return entries_.size() * (sizeof(Entry) + 4 * sizeof(void *) +
+                            sizeof(uint64_t) + 2 * sizeof(void *));
+}
+
+} // namespace gphyx
@@ -0,0 +1,59 @@
+#ifndef gPHYXFrameIndex_h
+#define gPHYXFrameIndex_h
+
+#include "gPHYXHomographyStore.h"
+#include "gPHYXImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace gphyx {
+
+// Identity of the pixels in one rect of a frame: a hash of every row plus a
+// sparse grid of raw pixels that a hash collision would also have to match.
+struct FrameContent {
+  uint64_t hash = 0;
+  PixelRect rect; // image space
+  PixelFormat format = PixelFormat::Unknown;
+  std::vector<uint8_t> probe;
+
+  bool sameAs(const FrameContent &o) const;
+};
+
+// Hashes `rect` of `view`. False if the view does not cover all of it.
+bool frameContent(const ImageView &view, const PixelRect &rect,
+                  FrameContent &out);
+
+// Remembers the first frame seen with each content, so frames repeating it
+// (locked-off shots, freeze frames, held titles) can take over its results
+// instead of recomputing them. Oldest entries go first past `capacity`.
+class FrameIndex {
+public:
+  explicit FrameIndex(size_t capacity);
+
+  // An earlier frame with exactly this content.
+  bool find(const FrameContent &content, MediaTime *out) const;
+  void insert(const FrameContent &content, const MediaTime &t);
+  void clear();
+
+  // Rough heap footprint, for memory accounting.
+  size_t bytes() const;
+
+private:
+  struct Entry {
+    FrameContent content;
+    MediaTime time;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  std::list<uint64_t> order_; // hashes, oldest first
+  size_t capacity_;
+};
+
+} // namespace gphyx
+
+#endif
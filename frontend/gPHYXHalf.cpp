@@ -0,0 +1,132 @@
+#include "gPHYXHalf.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define GPHYX_HALF_F16C 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define GPHYX_HALF_NEON 1
+#endif
+
+namespace gphyx {
+
+namespace {
+
+void halfToFloatScalar(const uint16_t *src, float *dst, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    dst[i] = halfToFloat(src[i]);
+}
+
+void floatToHalfScalar(const float *src, uint16_t *dst, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    dst[i] = floatToHalf(src[i]);
+}
+
+#if GPHYX_HALF_F16C
+// Built for F16C alone so the rest of the binary keeps the baseline ISA.
+__attribute__((target("avx,f16c"))) void
+halfToFloatF16C(const uint16_t *src, float *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  halfToFloatScalar(src + i, dst + i, count - i);
+}
+
+__attribute__((target("avx,f16c"))) void
+floatToHalfF16C(const float *src, uint16_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+  }
+  floatToHalfScalar(src + i, dst + i, count - i);
+}
+
+__attribute__((target("f16c"))) void halfToFloat4F16C(const uint16_t *src,
+                                                       float *dst) {
+  _mm_storeu_ps(dst, _mm_cvtph_ps(_mm_loadl_epi64(
+                         reinterpret_cast<const __m128i *>(src))));
+}
+
+__attribute__((target("f16c"))) void floatToHalf4F16C(const float *src,
+                                                       uint16_t *dst) {
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(dst),
+                   _mm_cvtps_ph(_mm_loadu_ps(src), _MM_FROUND_TO_NEAREST_INT |
+                                                       _MM_FROUND_NO_EXC));
+}
+
+bool hasF16C() {
+  static const bool has = __builtin_cpu_supports("f16c") &&
+                          __builtin_cpu_supports("avx");
+  return has;
+}
+#endif
+
+} // namespace
+
+void halfToFloatRow(const uint16_t *src, float *dst, size_t count) {
+#if GPHYX_HALF_F16C
+  if (hasF16C()) {
+    halfToFloatF16C(src, dst, count);
+    return;
+  }
+#elif GPHYX_HALF_NEON
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+    vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+  }
+  src += i;
+  dst += i;
+  count -= i;
+#endif
+  halfToFloatScalar(src, dst, count);
+}
+
+void floatToHalfRow(const float *src, uint16_t *dst, size_t count) {
+#if GPHYX_HALF_F16C
+  if (hasF16C()) {
+    floatToHalfF16C(src, dst, count);
+    return;
+  }
+#elif GPHYX_HALF_NEON
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    float16x4_t lo = vcvt_f16_f32(vld1q_f32(src + i));
+    float16x8_t h = vcvt_high_f16_f32(lo, vld1q_f32(src + i + 4));
+    vst1q_u16(dst + i, vreinterpretq_u16_f16(h));
+  }
+  src += i;
+  dst += i;
+  count -= i;
+#endif
+  floatToHalfScalar(src, dst, count);
+}
+
+#if !defined(__aarch64__)
+void halfToFloat4(const uint16_t *src, float *dst) {
+#if GPHYX_HALF_F16C
+  if (hasF16C()) {
+    halfToFloat4F16C(src, dst);
+    return;
+  }
+#endif
+  halfToFloatScalar(src, dst, 4);
+}
+
+void floatToHalf4(const float *src, uint16_t *dst) {
+#if GPHYX_HALF_F16C
+  if (hasF16C()) {
+    floatToHalf4F16C(src, dst);
+    return;
+  }
+#endif
+  floatToHalfScalar(src, dst, 4);
+}
+#endif
+
+} // namespace gphyx
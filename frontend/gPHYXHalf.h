@@ -0,0 +1,96 @@
+#ifndef gPHYXHalf_h
+#define gPHYXHalf_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace gphyx {
+
+// IEEE 754 binary16 <-> binary32, round-to-nearest-even. Branch-light bit
+// manipulation so it behaves identically on every compiler and CPU.
+inline float halfToFloat(uint16_t h) {
+  const uint32_t shiftedExp = 0x7c00u << 13;
+  uint32_t o = (uint32_t)(h & 0x7fffu) << 13;
+  uint32_t exp = shiftedExp & o;
+  o += (uint32_t)(127 - 15) << 23;
+
+  float f;
+  if (exp == shiftedExp) {
+    o += (uint32_t)(128 - 16) << 23; // Inf / NaN
+    std::memcpy(&f, &o, 4);
+  } else if (exp == 0) {
+    const uint32_t magicBits = 113u << 23; // Subnormal: renormalize
+    float magic;
+    std::memcpy(&magic, &magicBits, 4);
+    o += 1u << 23;
+    std::memcpy(&f, &o, 4);
+    f -= magic;
+  } else {
+    std::memcpy(&f, &o, 4);
+  }
+
+  uint32_t bits;
+  std::memcpy(&bits, &f, 4);
+  bits |= (uint32_t)(h & 0x8000u) << 16;
+  std::memcpy(&f, &bits, 4);
+  return f;
+}
+
+inline uint16_t floatToHalf(float value) {
+  uint32_t x;
+  std::memcpy(&x, &value, 4);
+  uint32_t sign = (x >> 16) & 0x8000u;
+  x &= 0x7fffffffu;
+
+  uint16_t o;
+  if (x >= 0x47800000u) {
+    o = (x > 0x7f800000u) ? 0x7e00 : 0x7c00; // NaN stays NaN, else Inf
+  } else if (x < 0x38800000u) {
+    // Result is subnormal or zero: let the FPU do the rounding.
+    const uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+    float denormMagic, f;
+    std::memcpy(&denormMagic, &denormMagicBits, 4);
+    std::memcpy(&f, &x, 4);
+    f += denormMagic;
+    uint32_t r;
+    std::memcpy(&r, &f, 4);
+    o = (uint16_t)(r - denormMagicBits);
+  } else {
+    uint32_t mantOdd = (x >> 13) & 1u;
+    x += ((uint32_t)(15 - 127) << 23) + 0xfffu;
+    x += mantOdd;
+    o = (uint16_t)(x >> 13);
+  }
+  return (uint16_t)(o | sign);
+}
+
+// Bulk conversions for rows of halves (four per RGBA16F pixel): F16C on x86
+// CPUs that have it, checked once at run time, NEON on ARM64, the scalar
+// functions above otherwise. Results match the scalar functions bit for bit
+// except for NaN payloads.
+void halfToFloatRow(const uint16_t *src, float *dst, size_t count);
+void floatToHalfRow(const float *src, uint16_t *dst, size_t count);
+
+// One RGBA16F pixel, for per-pixel reads and writes: the same results as the
+// row conversions. Inline NEON on ARM64; on x86 F16C behind the same run-time
+// check, out of line.
+#if defined(__aarch64__)
+inline void halfToFloat4(const uint16_t *src, float *dst) {
+  vst1q_f32(dst, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src))));
+}
+inline void floatToHalf4(const float *src, uint16_t *dst) {
+  vst1_u16(dst, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src))));
+}
+#else
+void halfToFloat4(const uint16_t *src, float *dst);
+void floatToHalf4(const float *src, uint16_t *dst);
+#endif
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,170 @@
+#include "gPHYXHash.h"
+#include "gPHYXSimd.h"
+#include <cstring>
+
+namespace gphyx {
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  uint64_t h = seed;
+  for (size_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+namespace {
+
+const size_t kStripeBytes = 32;
+const size_t kStripesPerBlock = 8;
+const size_t kBlockBytes = kStripeBytes * kStripesPerBlock;
+const uint32_t kPrime32 = 0x9e3779b1u;
+const uint64_t kPrime64 = 0x9e3779b185ebca87ull;
+
+// Four keys per stripe of a block, then the four scramble keys.
+alignas(16) const uint64_t kSecret[kStripesPerBlock * 4 + 4] = {
+    0x781ef86f5c8cc1abull, 0x48f165d57b00c7f4ull, 0x3a0562d56abd685aull,
+    0x017f9ee6725ed09dull, 0xdaa8b2a668d605d4ull, 0xb6043106a85f68b6ull,
+    0x3ce44e27424458b6ull, 0x38f12d92a28f17d8ull, 0x4bedce030297c5e5ull,
+    0xd09e04924d52bc61ull, 0xaaadd6b855c6b62bull, 0xf3a160712456de76ull,
+    0x9a23bef7be506564ull, 0x05adb3fc4f634127ull, 0x3868e6d9ca0bc36cull,
+    0x9a508bb1f4c9da65ull, 0x05372ef440e5c51eull, 0x2769e927e4bf1564ull,
+    0x9b25f81fcec1496eull, 0xa1865506aadbf831ull, 0x76f87a640701ad82ull,
+    0x994395a774f0147full, 0xb41b5669a0729b23ull, 0xfc45228f4bd571b0ull,
+    0xc85bd78d396e0d55ull, 0x5c9dc8b64f4e68e5ull, 0x6b978d7d421bb123ull,
+    0x1600314ac9aee9cfull, 0x7e89f91859082551ull, 0x844948a86c51ce92ull,
+    0x2c199bd3a49d1ce2ull, 0x900977a9f2c94386ull, 0x9429523c4b037d52ull,
+    0x486580790b44045full, 0x156724d0f9507c87ull, 0xfffc3436d523583bull,
+};
+const uint64_t *const kScrambleKeys = kSecret + kStripesPerBlock * 4;
+
+// Lane i takes the product of the two halves of its keyed word; the raw
+// word goes to its neighbour so that no input is lost when a product is 0.
+inline void accumulateScalar(uint64_t *acc, const uint8_t *stripe,
+                             const uint64_t *keys) {
+  for (int i = 0; i < 4; i++) {
+    uint64_t d;
+    std::memcpy(&d, stripe + i * 8, 8);
+    const uint64_t dk = d ^ keys[i];
+    acc[i ^ 1] += d;
+    acc[i] += (dk & 0xffffffffull) * (dk >> 32);
+  }
+}
+
+inline void scrambleScalar(uint64_t *acc) {
+  for (int i = 0; i < 4; i++) {
+    acc[i] ^= acc[i] >> 47;
+    acc[i] ^= kScrambleKeys[i];
+    acc[i] *= kPrime32;
+  }
+}
+
+#if GPHYX_SIMD_SSE
+void accumulateBlocks(uint64_t *acc, const uint8_t *p, size_t blocks) {
+  __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc));
+  __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + 2));
+  const __m128i prime = _mm_set1_epi32((int)kPrime32);
+  const __m128i *keys = reinterpret_cast<const __m128i *>(kSecret);
+  for (size_t b = 0; b < blocks; b++, p += kBlockBytes) {
+    for (size_t s = 0; s < kStripesPerBlock; s++) {
+      const __m128i *stripe =
+          reinterpret_cast<const __m128i *>(p + s * kStripeBytes);
+      __m128i d0 = _mm_loadu_si128(stripe);
+      __m128i d1 = _mm_loadu_si128(stripe + 1);
+      __m128i k0 = _mm_xor_si128(d0, _mm_load_si128(keys + s * 2));
+      __m128i k1 = _mm_xor_si128(d1, _mm_load_si128(keys + s * 2 + 1));
+      __m128i m0 = _mm_mul_epu32(k0, _mm_srli_epi64(k0, 32));
+      __m128i m1 = _mm_mul_epu32(k1, _mm_srli_epi64(k1, 32));
+      a0 = _mm_add_epi64(a0, _mm_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2)));
+      a1 = _mm_add_epi64(a1, _mm_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2)));
+      a0 = _mm_add_epi64(a0, m0);
+      a1 = _mm_add_epi64(a1, m1);
+    }
+    __m128i *regs[2] = {&a0, &a1};
+    for (int r = 0; r < 2; r++) {
+      __m128i a = *regs[r];
+      a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+      a = _mm_xor_si128(a, _mm_load_si128(keys + kStripesPerBlock * 2 + r));
+      __m128i lo = _mm_mul_epu32(a, prime);
+      __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+      *regs[r] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(acc), a0);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + 2), a1);
+}
+#elif GPHYX_SIMD_NEON
+void accumulateBlocks(uint64_t *acc, const uint8_t *p, size_t blocks) {
+  uint64x2_t a[2] = {vld1q_u64(acc), vld1q_u64(acc + 2)};
+  const uint32x2_t prime = vdup_n_u32(kPrime32);
+  for (size_t b = 0; b < blocks; b++, p += kBlockBytes) {
+    for (size_t s = 0; s < kStripesPerBlock; s++) {
+      for (int r = 0; r < 2; r++) {
+        uint64x2_t d = vreinterpretq_u64_u8(
+            vld1q_u8(p + s * kStripeBytes + r * 16));
+        uint64x2_t k = veorq_u64(d, vld1q_u64(kSecret + s * 4 + r * 2));
+        uint64x2_t m = vmull_u32(vmovn_u64(k), vshrn_n_u64(k, 32));
+        a[r] = vaddq_u64(a[r], vextq_u64(d, d, 1));
+        a[r] = vaddq_u64(a[r], m);
+      }
+    }
+    for (int r = 0; r < 2; r++) {
+      uint64x2_t x = veorq_u64(a[r], vshrq_n_u64(a[r], 47));
+      x = veorq_u64(x, vld1q_u64(kScrambleKeys + r * 2));
+      uint64x2_t lo = vmull_u32(vmovn_u64(x), prime);
+      uint64x2_t hi = vmull_u32(vshrn_n_u64(x, 32), prime);
+      a[r] = vaddq_u64(lo, vshlq_n_u64(hi, 32));
+    }
+  }
+  vst1q_u64(acc, a[0]);
+  vst1q_u64(acc + 2, a[1]);
+}
+#else
+void accumulateBlocks(uint64_t *acc, const uint8_t *p, size_t blocks) {
+  for (size_t b = 0; b < blocks; b++, p += kBlockBytes) {
+    for (size_t s = 0; s < kStripesPerBlock; s++)
+      accumulateScalar(acc, p + s * kStripeBytes, kSecret + s * 4);
+    scrambleScalar(acc);
+  }
+}
+#endif
+
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+} // namespace
+
+uint64_t hashBytesFast(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  uint64_t acc[4] = {seed ^ kSecret[0], seed + kSecret[1], seed ^ kSecret[2],
+                     seed - kSecret[3]};
+
+  const size_t blocks = size / kBlockBytes;
+  accumulateBlocks(acc, p, blocks);
+  p += blocks * kBlockBytes;
+
+  // The rest, fewer than a block: whole stripes, then a zero-padded one.
+  size_t rest = size - blocks * kBlockBytes;
+  size_t s = 0;
+  for (; rest >= kStripeBytes; s++, rest -= kStripeBytes, p += kStripeBytes)
+    accumulateScalar(acc, p, kSecret + s * 4);
+  if (rest > 0) {
+    uint8_t last[kStripeBytes] = {};
+    std::memcpy(last, p, rest);
+    accumulateScalar(acc, last, kSecret + s * 4);
+  }
+
+  uint64_t h = mix64(seed ^ ((uint64_t)size * kPrime64));
+  for (int i = 0; i < 4; i++)
+    h = mix64(h ^ acc[i]);
+  return h;
+}
+
+} // namespace gphyx
@@ -0,0 +1,24 @@
+#ifndef gPHYXHash_h
+#define gPHYXHash_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gphyx {
+
+const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+// FNV-1a. Chain calls by passing the previous result as `seed`.
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = kHashSeed);
+
+// Multiply-accumulate hash over 32-byte stripes, SSE2 or NEON where
+// available, for hashing pixels: an order of magnitude faster than hashBytes
+// on large inputs. Not cryptographic; callers that act on a match must guard
+// against collisions. Results differ from hashBytes but are the same with
+// and without SIMD. Chains like hashBytes.
+uint64_t hashBytesFast(const void *data, size_t size,
+                       uint64_t seed = kHashSeed);
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,124 @@
+#include "gPHYXHomography.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace gphyx {
+
+namespace {
+
+// Solves the 8x8 system a * x = b in place (Gaussian elimination, partial
+// pivoting). `a` is row-major.
+bool solve8(double a[8][8], double b[8], double x[8]) {
+  for (int col = 0; col < 8; col++) {
+    int pivot = col;
+    for (int r = col + 1; r < 8; r++)
+      if (std::fabs(a[r][col]) > std::fabs(a[pivot][col]))
+        pivot = r;
+    if (std::fabs(a[pivot][col]) < 1e-12)
+      return false;
+    if (pivot != col) {
+      for (int c = 0; c < 8; c++)
+        std::swap(a[col][c], a[pivot][c]);
+      std::swap(b[col], b[pivot]);
+    }
+    for (int r = col + 1; r < 8; r++) {
+      double f = a[r][col] / a[col][col];
+      for (int c = col; c < 8; c++)
+        a[r][c] -= f * a[col][c];
+      b[r] -= f * b[col];
+    }
+  }
+  for (int r = 7; r >= 0; r--) {
+    double sum = b[r];
+    for (int c = r + 1; c < 8; c++)
+      sum -= a[r][c] * x[c];
+    x[r] = sum / a[r][r];
+  }
+  return true;
+}
+
+} // namespace
+
+bool applyHomography(const float *h, double x, double y, double *outX,
+                     double *outY) {
+  double w = h[2] * x + h[5] * y + h[8];
+  if (!(w > 1e-12))
+    return false;
+  *outX = (h[0] * x + h[3] * y + h[6]) / w;
+  *outY = (h[1] * x + h[4] * y + h[7]) / w;
+  return std::isfinite(*outX) && std::isfinite(*outY);
+}
+
+bool homographyFromQuads(const double *src, const double *dst, float *out) {
+  // Normalise both quads to about unit scale so the system is well
+  // conditioned at 4K coordinates.
+  double scale = 0.0;
+  for (int i = 0; i < 8; i++)
+    scale = std::max(scale, std::max(std::fabs(src[i]), std::fabs(dst[i])));
+  if (!(scale > 0.0) || !std::isfinite(scale))
+    return false;
+  const double inv = 1.0 / scale;
+
+  double a[8][8];
+  double b[8];
+  for (int i = 0; i < 4; i++) {
+    double x = src[2 * i] * inv, y = src[2 * i + 1] * inv;
+    double u = dst[2 * i] * inv, v = dst[2 * i + 1] * inv;
+    // Unknowns: h0 h3 h6 h1 h4 h7 h2 h5 (h8 = 1).
+    double *r0 = a[2 * i];
+    double *r1 = a[2 * i + 1];
+    r0[0] = x, r0[1] = y, r0[2] = 1, r0[3] = 0, r0[4] = 0, r0[5] = 0;
+    r0[6] = -u * x, r0[7] = -u * y;
+    r1[0] = 0, r1[1] = 0, r1[2] = 0, r1[3] = x, r1[4] = y, r1[5] = 1;
+    r1[6] = -v * x, r1[7] = -v * y;
+    b[2 * i] = u;
+    b[2 * i + 1] = v;
+  }
+
+  double p[8];
+  if (!solve8(a, b, p))
+    return false;
+
+  // Undo the normalisation: H = S^-1 * Hn * S with S = diag(inv, inv, 1).
+  out[0] = (float)p[0];
+  out[3] = (float)p[1];
+  out[6] = (float)(p[2] * scale);
+  out[1] = (float)p[3];
+  out[4] = (float)p[4];
+  out[7] = (float)(p[5] * scale);
+  out[2] = (float)(p[6] * inv);
+  out[5] = (float)(p[7] * inv);
+  out[8] = 1.0f;
+  for (int i = 0; i < 9; i++)
+    if (!std::isfinite(out[i]))
+      return false;
+  return true;
+}
+
+bool interpolateHomography(const float *h0, const float *h1, double t,
+                           double width, double height, float *out) {
+  const double corners[8] = {0, 0, width, 0, width, height, 0, height};
+  double blended[8];
+  for (int i = 0; i < 4; i++) {
+    double x0, y0, x1, y1;
+    if (!applyHomography(h0, corners[2 * i], corners[2 * i + 1], &x0, &y0) ||
+        !applyHomography(h1, corners[2 * i], corners[2 * i + 1], &x1, &y1))
+      return false;
+    blended[2 * i] = x0 + (x1 - x0) * t;
+    blended[2 * i + 1] = y0 + (y1 - y0) * t;
+  }
+  return homographyFromQuads(corners, blended, out);
+}
+
+void scaleHomography(const float *h, double scale, float *out) {
+  // Column-major: column 2 (translation) grows, row 2 (perspective) shrinks.
+  for (int i = 0; i < 9; i++)
+    out[i] = h[i];
+  out[6] = (float)(h[6] * scale);
+  out[7] = (float)(h[7] * scale);
+  out[2] = (float)(h[2] / scale);
+  out[5] = (float)(h[5] / scale);
+}
+
+} // namespace gphyx
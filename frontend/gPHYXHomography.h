@@ -0,0 +1,31 @@
+#ifndef gPHYXHomography_h
+#define gPHYXHomography_h
+
+namespace gphyx {
+
+// 3x3 homographies are stored column-major (as Vision's simd_float3x3 and
+// the Metal kernel use them): x' = (h0 x + h3 y + h6) / (h2 x + h5 y + h8).
+
+// Maps (x, y); false when the point lands on or behind the horizon.
+bool applyHomography(const float *h, double x, double y, double *outX,
+                     double *outY);
+
+// Direct linear transform from four correspondences (x, y pairs): the
+// homography taking src[i] to dst[i], scaled so h8 == 1. False when the
+// points are degenerate (three collinear, coincident, ...).
+bool homographyFromQuads(const double *src, const double *dst, float *out);
+
+// Blends two homographies by moving the images of the frame corners
+// (0,0)-(width,height) linearly with t and refitting. Unlike blending matrix
+// entries this stays a proper, non-folding warp and is exact at t = 0 and 1.
+// False if either warp is degenerate over the frame.
+bool interpolateHomography(const float *h0, const float *h1, double t,
+                           double width, double height, float *out);
+
+// The same warp for images resampled by `scale` (pixel coordinates
+// multiplied by it): S h S^-1 with S = diag(scale, scale, 1).
+void scaleHomography(const float *h, double scale, float *out);
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,274 @@
+#include "gPHYXHomographyStore.h"
+#include <algorithm>
+#include <cmath>
+
+namespace gphyx {
+
+namespace {
+
+// Small enough that a single live insert copies little (a few tens of KB),
+// large enough that an hour at 60 fps is a few hundred chunks.
+const size_t kChunkCapacity = 512;
+
+bool timeLess(const HomographySample &a, const HomographySample &b) {
+  return compareTimes(a.time, b.time) < 0;
+}
+
+// Sorts and keeps the last of any samples with equal times.
+void sortUnique(std::vector<HomographySample> &samples) {
+  std::stable_sort(samples.begin(), samples.end(), timeLess);
+  size_t out = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    if (out > 0 && compareTimes(samples[out - 1].time, samples[i].time) == 0)
+      samples[out - 1] = samples[i];
+    else
+      samples[out++] = samples[i];
+  }
+  samples.resize(out);
+}
+
+// Merges two sorted, unique runs; `newer` wins on equal times.
+std::vector<HomographySample>
+mergeSorted(const std::vector<HomographySample> &older,
+            const std::vector<HomographySample> &newer) {
+  std::vector<HomographySample> out;
+  out.reserve(older.size() + newer.size());
+  size_t i = 0, j = 0;
+  while (i < older.size() || j < newer.size()) {
+    if (j == newer.size()) {
+      out.push_back(older[i++]);
+    } else if (i == older.size()) {
+      out.push_back(newer[j++]);
+    } else {
+      int c = compareTimes(older[i].time, newer[j].time);
+      if (c < 0) {
+        out.push_back(older[i++]);
+      } else {
+        if (c == 0)
+          i++;
+        out.push_back(newer[j++]);
+      }
+    }
+  }
+  return out;
+}
+
+void appendChunks(std::vector<std::shared_ptr<const HomographyChunk>> &chunks,
+                  const std::vector<HomographySample> &sorted) {
+  for (size_t begin = 0; begin < sorted.size(); begin += kChunkCapacity) {
+    size_t end = std::min(sorted.size(), begin + kChunkCapacity);
+    std::vector<HomographySample> piece(sorted.begin() + begin,
+                                        sorted.begin() + end);
+    chunks.push_back(std::make_shared<const HomographyChunk>(piece));
+  }
+}
+
+} // namespace
+
+int compareTimes(const MediaTime &a, const MediaTime &b) {
+  if (a.timescale == b.timescale)
+    return a.value < b.value ? -1 : (a.value > b.value ? 1 : 0);
+  // value * timescale can exceed 64 bits on long clips with fine timescales.
+  __int128 l = (__int128)a.value * b.timescale;
+  __int128 r = (__int128)b.value * a.timescale;
+  return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+// --- HomographyChunk
+
+HomographyChunk::HomographyChunk(const std::vector<HomographySample> &sorted) {
+  times_.reserve(sorted.size());
+  matrices_.reserve(sorted.size());
+  confidences_.reserve(sorted.size());
+  signatures_.reserve(sorted.size());
+  for (const HomographySample &s : sorted) {
+    times_.push_back(s.time);
+    matrices_.push_back(s.matrix);
+    confidences_.push_back(s.confidence);
+    signatures_.push_back(s.signature);
+  }
+
+  if (times_.size() >= 2) {
+    const int32_t scale = times_[0].timescale;
+    const int64_t step = times_[1].value - times_[0].value;
+    uniform_ = step > 0;
+    for (size_t i = 1; uniform_ && i < times_.size(); i++) {
+      uniform_ = times_[i].timescale == scale &&
+                 times_[i].value - times_[i - 1].value == step;
+    }
+    step_ = step;
+  }
+}
+
+size_t HomographyChunk::lowerBound(const MediaTime &t) const {
+  if (uniform_ && t.timescale == times_[0].timescale) {
+    int64_t d = t.value - times_[0].value;
+    if (d <= 0)
+      return 0;
+    size_t i = (size_t)((d + step_ - 1) / step_);
+    return std::min(i, times_.size());
+  }
+  auto it = std::lower_bound(times_.begin(), times_.end(), t,
+                             [](const MediaTime &a, const MediaTime &b) {
+                               return compareTimes(a, b) < 0;
+                             });
+  return (size_t)(it - times_.begin());
+}
+
+void HomographyChunk::appendTo(std::vector<HomographySample> &out) const {
+  for (size_t i = 0; i < times_.size(); i++)
+    out.push_back(sample(i));
+}
+
+// --- HomographyTrack
+
+size_t HomographyTrack::chunkFor(const MediaTime &t) const {
+  auto it = std::lower_bound(
+      chunks_.begin(), chunks_.end(), t,
+      [](const std::shared_ptr<const HomographyChunk> &c, const MediaTime &v) {
+        return compareTimes(c->last(), v) < 0;
+      });
+  return (size_t)(it - chunks_.begin());
+}
+
+bool HomographyTrack::find(const MediaTime &t, double toleranceSeconds,
+                           Matrix3 *out) const {
+  size_t c = chunkFor(t);
+  if (c < chunks_.size()) {
+    const HomographyChunk &chunk = *chunks_[c];
+    size_t i = chunk.lowerBound(t);
+    if (i < chunk.size() && compareTimes(chunk.time(i), t) == 0) {
+      *out = chunk.matrix(i);
+      return true;
+    }
+  }
+
+  HomographySample sample;
+  if (!find(t, toleranceSeconds, &sample))
+    return false;
+  *out = sample.matrix;
+  return true;
+}
+
+bool HomographyTrack::find(const MediaTime &t, double toleranceSeconds,
+                           HomographySample *out) const {
+  size_t c = chunkFor(t);
+  if (c < chunks_.size()) {
+    const HomographyChunk &chunk = *chunks_[c];
+    size_t i = chunk.lowerBound(t);
+    if (i < chunk.size() && compareTimes(chunk.time(i), t) == 0) {
+      *out = chunk.sample(i);
+      return true;
+    }
+  }
+
+  // Otherwise the closer neighbour, if it is within tolerance.
+  Neighbours n = neighbours(t);
+  const double sec = t.seconds();
+  double best = toleranceSeconds;
+  bool found = false;
+  if (n.hasBefore && sec - n.before.time.seconds() <= best) {
+    best = sec - n.before.time.seconds();
+    *out = n.before;
+    found = true;
+  }
+  if (n.hasAfter && n.after.time.seconds() - sec <= best) {
+    *out = n.after;
+    found = true;
+  }
+  return found;
+}
+
+HomographyTrack::Neighbours
+HomographyTrack::neighbours(const MediaTime &t) const {
+  Neighbours n;
+  size_t c = chunkFor(t);
+
+  // First sample not before t: (c, i).
+  size_t i = c < chunks_.size() ? chunks_[c]->lowerBound(t) : 0;
+
+  // Before: the sample just ahead of (c, i).
+  if (c < chunks_.size() && i > 0) {
+    n.hasBefore = true;
+    n.before = chunks_[c]->sample(i - 1);
+  } else if (c > 0) {
+    const HomographyChunk &prev = *chunks_[c - 1];
+    n.hasBefore = true;
+    n.before = prev.sample(prev.size() - 1);
+  }
+
+  // After: (c, i), or the next one if it sits exactly on t.
+  if (c < chunks_.size()) {
+    if (compareTimes(chunks_[c]->time(i), t) == 0)
+      i++;
+    if (i == chunks_[c]->size()) {
+      c++;
+      i = 0;
+    }
+    if (c < chunks_.size()) {
+      n.hasAfter = true;
+      n.after = chunks_[c]->sample(i);
+    }
+  }
+  return n;
+}
+
+HomographyTrack
+HomographyTrack::inserted(std::vector<HomographySample> samples) const {
+  sortUnique(samples);
+  if (samples.empty())
+    return *this;
+
+  HomographyTrack next;
+  if (chunks_.empty()) {
+    appendChunks(next.chunks_, samples);
+    next.count_ = samples.size();
+    return next;
+  }
+
+  // Route every sample to the chunk whose range it falls in (past the end
+  // goes to the last chunk), then rebuild only those chunks.
+  size_t s = 0;
+  for (size_t c = 0; c < chunks_.size(); c++) {
+    const bool lastChunk = c + 1 == chunks_.size();
+    size_t begin = s;
+    while (s < samples.size() &&
+           (lastChunk ||
+            compareTimes(samples[s].time, chunks_[c]->last()) <= 0))
+      s++;
+    if (s == begin) {
+      next.chunks_.push_back(chunks_[c]);
+      continue;
+    }
+    std::vector<HomographySample> existing;
+    existing.reserve(chunks_[c]->size());
+    chunks_[c]->appendTo(existing);
+    std::vector<HomographySample> added(samples.begin() + begin,
+                                        samples.begin() + s);
+    appendChunks(next.chunks_, mergeSorted(existing, added));
+  }
+
+  for (const auto &chunk : next.chunks_)
+    next.count_ += chunk->size();
+  return next;
+}
+
+// --- HomographyStore
+
+void HomographyStore::insert(const HomographySample &sample) {
+  insertBatch({sample});
+}
+
+void HomographyStore::insertBatch(std::vector<HomographySample> samples) {
+  if (samples.empty())
+    return;
+  track_.update([&](HomographyTrack &track) {
+    track = track.inserted(std::move(samples));
+  });
+}
+
+void HomographyStore::clear() {
+  track_.update([](HomographyTrack &track) { track = HomographyTrack(); });
+}
+
+} // namespace gphyx
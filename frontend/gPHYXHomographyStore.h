@@ -0,0 +1,116 @@
+#ifndef gPHYXHomographyStore_h
+#define gPHYXHomographyStore_h
+
+#include "gPHYXSnapshot.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gphyx {
+
+// Rational media time, the same shape as CMTime's value/timescale. Times
+// with different timescales compare exactly.
+struct MediaTime {
+  int64_t value = 0;
+  int32_t timescale = 1;
+
+  double seconds() const { return timescale ? (double)value / timescale : 0; }
+};
+
+// <0, 0, >0 like strcmp.
+int compareTimes(const MediaTime &a, const MediaTime &b);
+
+typedef std::array<float, 9> Matrix3; // column-major, see gPHYXHomography.h
+
+struct HomographySample {
+  MediaTime time;
+  Matrix3 matrix;
+  float confidence = 1.0f; // registration confidence, 0..1
+  // Identifies the tracking inputs (reference plate, ROI) the matrix was
+  // computed from; a sample whose inputs changed since is stale.
+  uint64_t signature = 0;
+};
+
+// Immutable, time-sorted run of samples. Times and matrices live in separate
+// contiguous arrays so searches only touch the times.
+class HomographyChunk {
+public:
+  explicit HomographyChunk(const std::vector<HomographySample> &sorted);
+
+  size_t size() const { return times_.size(); }
+  const MediaTime &time(size_t i) const { return times_[i]; }
+  const Matrix3 &matrix(size_t i) const { return matrices_[i]; }
+  float confidence(size_t i) const { return confidences_[i]; }
+  HomographySample sample(size_t i) const {
+    return {times_[i], matrices_[i], confidences_[i], signatures_[i]};
+  }
+  const MediaTime &first() const { return times_.front(); }
+  const MediaTime &last() const { return times_.back(); }
+
+  // Index of the first sample not before `t` (size() if none).
+  size_t lowerBound(const MediaTime &t) const;
+  void appendTo(std::vector<HomographySample> &out) const;
+
+private:
+  std::vector<MediaTime> times_;
+  std::vector<Matrix3> matrices_;
+  std::vector<float> confidences_;
+  std::vector<uint64_t> signatures_;
+  // Set when every sample shares one timescale and one step, which is what
+  // frame-by-frame analysis produces: lookups are then plain arithmetic.
+  bool uniform_ = false;
+  int64_t step_ = 0;
+};
+
+// One consistent view of all samples of an instance. Cheap to copy: chunks
+// are shared between versions.
+class HomographyTrack {
+public:
+  struct Neighbours {
+    bool hasBefore = false;
+    bool hasAfter = false;
+    HomographySample before; // latest sample strictly before the time
+    HomographySample after;  // earliest sample strictly after the time
+  };
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  // Sample within `toleranceSeconds` of `t`, the closest one if several.
+  bool find(const MediaTime &t, double toleranceSeconds, Matrix3 *out) const;
+  bool find(const MediaTime &t, double toleranceSeconds,
+            HomographySample *out) const;
+  Neighbours neighbours(const MediaTime &t) const;
+
+  // Merges `samples` (any order; later duplicates win) into a new version.
+  HomographyTrack inserted(std::vector<HomographySample> samples) const;
+
+private:
+  // Chunk holding the first sample not before `t`; chunks_.size() if none.
+  size_t chunkFor(const MediaTime &t) const;
+
+  std::vector<std::shared_ptr<const HomographyChunk>> chunks_;
+  size_t count_ = 0;
+};
+
+// Per-instance homography cache. Readers take a snapshot and never wait on
+// writers; writers copy only the chunks they touch.
+class HomographyStore {
+public:
+  std::shared_ptr<const HomographyTrack> snapshot() const {
+    return track_.load();
+  }
+
+  void insert(const HomographySample &sample);
+  void insertBatch(std::vector<HomographySample> samples);
+  void clear();
+
+private:
+  Snapshot<HomographyTrack> track_;
+};
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef gPHYXImage_h
+#define gPHYXImage_h
+
+#include "gPHYXRegion.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace gphyx {
+
+// Pixel layouts the host hands us (see IOSurfaceGetPixelFormat).
+enum class PixelFormat : uint32_t {
+  Unknown = 0,
+  BGRA8,   // kCVPixelFormatType_32BGRA
+  RGBA16F, // kCVPixelFormatType_64RGBAHalf
+  RGBA32F, // kCVPixelFormatType_128RGBAFloat
+};
+
+inline size_t bytesPerPixel(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::BGRA8:
+    return 4;
+  case PixelFormat::RGBA16F:
+    return 8;
+  case PixelFormat::RGBA32F:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+// Non-owning view of a locked surface. originX/originY place the surface's
+// pixel (0, 0) in image space (top-left origin), so tiles of the same image
+// line up with each other.
+struct ImageView {
+  void *data = nullptr;
+  size_t bytesPerRow = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+  PixelFormat format = PixelFormat::Unknown;
+  int32_t originX = 0;
+  int32_t originY = 0;
+
+  bool valid() const {
+    return data && width > 0 && height > 0 && bytesPerPixel(format) > 0 &&
+           bytesPerRow >= (size_t)width * bytesPerPixel(format);
+  }
+  PixelRect imageRect() const {
+    return makePixelRect(originX, originY, width, height);
+  }
+  uint8_t *row(int32_t y) const {
+    return static_cast<uint8_t *>(data) + (size_t)y * bytesPerRow;
+  }
+};
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,159 @@
+// The CPU fill over 8 lanes, for x86-64 CPUs with AVX2 and F16C; the rest
+// of the binary keeps the baseline instruction set. inpaintCPU picks this
+// at run time.
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXSimd.h"
+
+#if GPHYX_SIMD_AVX2
+
+// Everything gPHYXInpaintLanes.h includes, ahead of the target switch, so
+// shared inline code keeps the baseline instruction set.
+#include "gPHYXBlit.h"
+#include "gPHYXParallel.h"
+#include "gPHYXPixel.h"
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+#include <vector>
+
+namespace gphyx {
+
+bool cpuHasAVX2() {
+  static const bool has =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+  return has;
+}
+
+} // namespace gphyx
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,f16c"))),            \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c")
+#endif
+
+#include "gPHYXInpaintLanes.h"
+
+namespace gphyx {
+
+namespace {
+
+struct Lanes8 {
+  static const int kCount = 8;
+  // Member operators: GCC leaves friends defined in a class out of the
+  // target pragma.
+  struct F {
+    __m256 v;
+    F operator+(F b) const { return {_mm256_add_ps(v, b.v)}; }
+    F operator-(F b) const { return {_mm256_sub_ps(v, b.v)}; }
+    F operator*(F b) const { return {_mm256_mul_ps(v, b.v)}; }
+    F operator/(F b) const { return {_mm256_div_ps(v, b.v)}; }
+  };
+  struct M {
+    __m256 v;
+  };
+
+  static F splat(float s) { return {_mm256_set1_ps(s)}; }
+  static F ramp() {
+    return {_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)};
+  }
+  static F min(F a, F b) { return {_mm256_min_ps(a.v, b.v)}; }
+  static F max(F a, F b) { return {_mm256_max_ps(a.v, b.v)}; }
+  static F floor(F a) { return {_mm256_floor_ps(a.v)}; }
+  static M less(F a, F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+  static M greaterEqual(F a, F b) {
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+  }
+  static M both(M a, M b) { return {_mm256_and_ps(a.v, b.v)}; }
+  static uint32_t bits(M m) { return (uint32_t)_mm256_movemask_ps(m.v); }
+  static void truncate(F a, int32_t *out) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                        _mm256_cvttps_epi32(a.v));
+  }
+  static uint32_t maskBits(const uint8_t *p) {
+    return (uint32_t)_mm_movemask_epi8(
+               _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))) &
+           0xffu;
+  }
+  // Pixels k and k + 4 share a register; the 4x4 transposes then run in
+  // both 128-bit halves at once.
+  static void transpose(const float *rgba, F *planes) {
+    __m256 r[4];
+    for (int k = 0; k < 4; k++)
+      r[k] = _mm256_insertf128_ps(
+          _mm256_castps128_ps256(_mm_loadu_ps(rgba + 4 * k)),
+          _mm_loadu_ps(rgba + 16 + 4 * k), 1);
+    transposePairs(r, planes);
+  }
+  static void transposePairs(const __m256 *r, F *planes) {
+    const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    const __m256 t1 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 t2 = _mm256_unpackhi_ps(r[0], r[1]);
+    const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    planes[0].v = _mm256_shuffle_ps(t0, t1, 0x44);
+    planes[1].v = _mm256_shuffle_ps(t0, t1, 0xee);
+    planes[2].v = _mm256_shuffle_ps(t2, t3, 0x44);
+    planes[3].v = _mm256_shuffle_ps(t2, t3, 0xee);
+  }
+  static void untranspose(const F *planes, float *rgba) {
+    const __m256 t0 = _mm256_unpacklo_ps(planes[0].v, planes[1].v);
+    const __m256 t1 = _mm256_unpackhi_ps(planes[0].v, planes[1].v);
+    const __m256 t2 = _mm256_unpacklo_ps(planes[2].v, planes[3].v);
+    const __m256 t3 = _mm256_unpackhi_ps(planes[2].v, planes[3].v);
+    const __m256 p04 = _mm256_shuffle_ps(t0, t2, 0x44);
+    const __m256 p15 = _mm256_shuffle_ps(t0, t2, 0xee);
+    const __m256 p26 = _mm256_shuffle_ps(t1, t3, 0x44);
+    const __m256 p37 = _mm256_shuffle_ps(t1, t3, 0xee);
+    _mm256_storeu_ps(rgba, _mm256_permute2f128_ps(p04, p15, 0x20));
+    _mm256_storeu_ps(rgba + 8, _mm256_permute2f128_ps(p26, p37, 0x20));
+    _mm256_storeu_ps(rgba + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+    _mm256_storeu_ps(rgba + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+  }
+  static void unpackBGRA8(const uint32_t *words, F *planes) {
+    const __m256i w =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words));
+    const __m256i byte = _mm256_set1_epi32(255);
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+    planes[0].v = _mm256_mul_ps(
+        _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(w, 16), byte)),
+        scale);
+    planes[1].v = _mm256_mul_ps(
+        _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(w, 8), byte)),
+        scale);
+    planes[2].v =
+        _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(w, byte)), scale);
+    planes[3].v =
+        _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(w, 24)), scale);
+  }
+  // Converted straight into the pairs transpose() builds.
+  static void unpackRGBA16F(const uint16_t *halves, F *planes) {
+    __m256 r[4];
+    for (int k = 0; k < 4; k++)
+      r[k] = _mm256_cvtph_ps(_mm_unpacklo_epi64(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(halves + 4 * k)),
+          _mm_loadl_epi64(
+              reinterpret_cast<const __m128i *>(halves + 16 + 4 * k))));
+    transposePairs(r, planes);
+  }
+};
+
+} // namespace
+
+void inpaintAVX2(const InpaintJob &job) { inpaintLanes<Lanes8>(job); }
+
+void inpaintCoverageAVX2(const InpaintJob &job, uint8_t *out,
+                         size_t bytesPerRow) {
+  inpaintCoverageLanes<Lanes8>(job, out, bytesPerRow);
+}
+
+} // namespace gphyx
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXInpaintLanes.h"
+
+namespace gphyx {
+
+int32_t inpaintLaneCount(int32_t maxLanes) {
+#if GPHYX_SIMD_AVX2
+  if (maxLanes >= 8 && cpuHasAVX2())
+    return 8;
+#endif
+  if (maxLanes >= Lanes4::kCount)
+    return Lanes4::kCount;
+  return 1;
+}
+
+bool inpaintCPU(const InpaintJob &job) {
+  if (!job.source.valid() || !job.destination.valid() ||
+      !job.reference.valid() || !job.mask.data)
+    return false;
+  if (job.region.empty())
+    return true;
+  if (intersectRects(job.region, job.destination.imageRect()).area() !=
+          job.region.area() ||
+      intersectRects(job.region, job.source.imageRect()).area() !=
+          job.region.area() ||
+      job.mask.width < job.region.width() ||
+      job.mask.height < job.region.height())
+    return false;
+
+  switch (inpaintLaneCount(job.maxLanes)) {
+#if GPHYX_SIMD_AVX2
+  case 8:
+    inpaintAVX2(job);
+    break;
+#endif
+  case 1:
+    inpaintLanes<Lanes1>(job);
+    break;
+  default:
+    inpaintLanes<Lanes4>(job);
+    break;
+  }
+  return !job.cancel.cancelled();
+}
+
+bool inpaintCoverage(const InpaintJob &job, uint8_t *out, size_t bytesPerRow) {
+  if (!job.reference.valid() || !job.mask.data || !out ||
+      bytesPerRow < (size_t)job.region.width() ||
+      job.mask.width < job.region.width() ||
+      job.mask.height < job.region.height())
+    return false;
+
+  switch (inpaintLaneCount(job.maxLanes)) {
+#if GPHYX_SIMD_AVX2
+  case 8:
+    inpaintCoverageAVX2(job, out, bytesPerRow);
+    break;
+#endif
+  case 1:
+    inpaintCoverageLanes<Lanes1>(job, out, bytesPerRow);
+    break;
+  default:
+    inpaintCoverageLanes<Lanes4>(job, out, bytesPerRow);
+    break;
+  }
+  return !job.cancel.cancelled();
+}
+
+} // namespace gphyx
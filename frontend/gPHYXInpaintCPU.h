@@ -0,0 +1,72 @@
+#ifndef gPHYXInpaintCPU_h
+#define gPHYXInpaintCPU_h
+
+#include "gPHYXCancel.h"
+#include "gPHYXImage.h"
+#include "gPHYXMaskTiles.h"
+#include "gPHYXTiledImage.h"
+
+namespace gphyx {
+
+// Reference-plate sampling filter. Nearest matches inpaint_kernel exactly
+// (truncating the warped coordinate); the others sample at pixel centres with
+// clamp-to-edge neighbours.
+enum class SampleMode : uint32_t {
+  Nearest = 0,
+  Bilinear = 1,
+  Bicubic = 2, // Catmull-Rom
+};
+
+// 8-bit coverage plane, same convention as the R8Unorm Metal mask texture:
+// a pixel is inside the mask when its value is > 127.
+struct MaskView {
+  const uint8_t *data = nullptr;
+  size_t bytesPerRow = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+  // Optional occupancy of the part covering the job's region. Passes then
+  // skip empty tiles, so the destination must already hold the source there.
+  const MaskTiles *tiles = nullptr;
+};
+
+// CPU counterpart of inpaint_kernel. `region` and the homography work in
+// image space; each view's origin places its tile in its own image, so the
+// source and destination tiles only need to contain `region`.
+struct InpaintJob {
+  ImageView source;      // kept where the mask is off or the warp misses
+  ImageView destination; // written only inside `region`
+  ImageView reference;   // clean plate sampled through the homography
+  // Optional blocked copy of `reference`, read instead of it when it matches.
+  const TiledImage *tiledReference = nullptr;
+  MaskView mask;         // covers `region` exactly
+  PixelRect region;      // image space
+  float homography[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}; // column-major, dst->ref
+  SampleMode sampling = SampleMode::Nearest;
+  // Above 1, the reference is sampled once per coarseStep-square block of
+  // `region` and the result repeated over the block's masked pixels: a quick
+  // preview fill, not what inpaintCoverage describes.
+  int32_t coarseStep = 1;
+  // Widest vector the passes may use: 8 lanes where the CPU has AVX2, else
+  // 4 (SSE2, NEON). 1 runs them a pixel at a time, for comparison.
+  int32_t maxLanes = 8;
+  // Polled per row or tile. Once cancelled the passes stop early, leaving
+  // the output partly written, and return false.
+  CancelToken cancel;
+};
+
+// Runs the mask test, homography mapping and reference fetch over
+// job.region, rows spread across cores. Returns false on unusable input or
+// when cancelled.
+bool inpaintCPU(const InpaintJob &job);
+
+// Pixels per step the passes would use for a job with this maxLanes.
+int32_t inpaintLaneCount(int32_t maxLanes);
+
+// Which pixels of job.region inpaintCPU replaces: 255 where the mask is on
+// and the warp lands on the reference, 0 elsewhere. Source and destination
+// are not used. False as inpaintCPU.
+bool inpaintCoverage(const InpaintJob &job, uint8_t *out, size_t bytesPerRow);
+
+} // namespace gphyx
+
+#endif
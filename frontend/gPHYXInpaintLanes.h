@@ -0,0 +1,479 @@
+#ifndef gPHYXInpaintLanes_h
+#define gPHYXInpaintLanes_h
+
+// The CPU fill and coverage passes, written once over a lane type L
+// (gPHYXSimd.h): each step maps L::kCount neighbouring destination pixels
+// through the homography, tests them against the mask and the reference,
+// works out the filter taps and weights, and blends the taps, all in lanes.
+// Only the reads of the taps themselves go pixel by pixel.
+//
+// Private to gPHYXInpaintCPU.cpp and gPHYXInpaintAVX2.cpp. Everything has
+// internal linkage so each file keeps the instruction set it was built for;
+// a file built for a wider one must include the headers below first.
+
+#include "gPHYXBlit.h"
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXParallel.h"
+#include "gPHYXPixel.h"
+#include "gPHYXSimd.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Lane and scalar code must round alike; keep the compiler from fusing
+// mul+add anywhere here.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+namespace gphyx {
+
+#if GPHYX_SIMD_AVX2
+// gPHYXInpaintAVX2.cpp: the passes over 8 lanes, for CPUs with AVX2 and F16C.
+bool cpuHasAVX2();
+void inpaintAVX2(const InpaintJob &job);
+void inpaintCoverageAVX2(const InpaintJob &job, uint8_t *out,
+                         size_t bytesPerRow);
+#endif
+
+namespace {
+
+const size_t kRowsPerChunk = 8;
+const size_t kTilesPerChunk = 2;
+
+// Reference reads, from the view itself or from its blocked copy. Both give
+// the same pixels; only the memory order differs.
+template <PixelFormat Fmt> struct LinearReference {
+  static const PixelFormat kFormat = Fmt;
+  const uint8_t *data;
+  size_t bytesPerRow;
+  int32_t width;
+  int32_t height;
+
+  explicit LinearReference(const InpaintJob &job)
+      : data(static_cast<const uint8_t *>(job.reference.data)),
+        bytesPerRow(job.reference.bytesPerRow),
+        width(job.reference.width), height(job.reference.height) {}
+  const uint8_t *at(int32_t x, int32_t y) const {
+    return data + (size_t)y * bytesPerRow +
+           (size_t)x * PixelTraits<Fmt>::kBytes;
+  }
+};
+
+template <PixelFormat Fmt> struct BlockedReference {
+  static const PixelFormat kFormat = Fmt;
+  const TiledImage &image;
+  int32_t width;
+  int32_t height;
+
+  explicit BlockedReference(const InpaintJob &job)
+      : image(*job.tiledReference), width(image.width), height(image.height) {}
+  const uint8_t *at(int32_t x, int32_t y) const {
+    return image.pixels.data() + image.index(x, y) * PixelTraits<Fmt>::kBytes;
+  }
+};
+
+// One reference pixel per lane, as planar RGBA.
+template <PixelFormat Fmt, typename L> struct Fetch {
+  static void run(const uint8_t *const *pixels, typename L::F *planes) {
+    float rgba[4 * L::kCount];
+    for (int k = 0; k < L::kCount; k++)
+      PixelTraits<Fmt>::load(pixels[k], rgba + 4 * k);
+    L::transpose(rgba, planes);
+  }
+};
+
+template <typename L> struct Fetch<PixelFormat::BGRA8, L> {
+  static void run(const uint8_t *const *pixels, typename L::F *planes) {
+    uint32_t words[L::kCount];
+    for (int k = 0; k < L::kCount; k++)
+      std::memcpy(words + k, pixels[k], 4);
+    L::unpackBGRA8(words, planes);
+  }
+};
+
+template <typename L> struct Fetch<PixelFormat::RGBA16F, L> {
+  static void run(const uint8_t *const *pixels, typename L::F *planes) {
+    uint16_t halves[4 * L::kCount];
+    for (int k = 0; k < L::kCount; k++)
+      std::memcpy(halves + 4 * k, pixels[k], 8);
+    L::unpackRGBA16F(halves, planes);
+  }
+};
+
+// Reads pixel (xs[k], ys[k]) of `ref` into lane k of each plane.
+template <typename L, typename R>
+inline void gather(const R &ref, const int32_t *xs, const int32_t *ys,
+                   typename L::F *planes) {
+  const uint8_t *pixels[L::kCount];
+  for (int k = 0; k < L::kCount; k++)
+    pixels[k] = ref.at(xs[k], ys[k]);
+  Fetch<R::kFormat, L>::run(pixels, planes);
+}
+
+// Clamps to [0, size - 1] and converts to indices. Lanes off the reference
+// (inf or NaN included) land on its edge, so every lane can be read.
+template <typename L>
+inline void clampedIndices(typename L::F v, int32_t size, int32_t *out) {
+  L::truncate(L::min(L::max(v, L::splat(0.0f)), L::splat((float)(size - 1))),
+              out);
+}
+
+template <typename R, typename L> struct NearestSampler {
+  typedef R Reference;
+  typedef typename L::F F;
+
+  static void sample(const R &ref, F fx, F fy, F *out) {
+    int32_t xs[L::kCount], ys[L::kCount];
+    clampedIndices<L>(fx, ref.width, xs);
+    clampedIndices<L>(fy, ref.height, ys);
+    gather<L>(ref, xs, ys, out);
+  }
+};
+
+// Bilinear and bicubic sample at pixel centres with clamp-to-edge taps.
+template <typename R, typename L> struct BilinearSampler {
+  typedef R Reference;
+  typedef typename L::F F;
+
+  static void sample(const R &ref, F fx, F fy, F *out) {
+    const F half = L::splat(0.5f), one = L::splat(1.0f);
+    const F u = fx - half, v = fy - half;
+    const F x0f = L::floor(u), y0f = L::floor(v);
+    const F tx = u - x0f, ty = v - y0f;
+    int32_t x0[L::kCount], x1[L::kCount], y0[L::kCount], y1[L::kCount];
+    clampedIndices<L>(x0f, ref.width, x0);
+    clampedIndices<L>(x0f + one, ref.width, x1);
+    clampedIndices<L>(y0f, ref.height, y0);
+    clampedIndices<L>(y0f + one, ref.height, y1);
+
+    F a[4], b[4], c[4], d[4];
+    gather<L>(ref, x0, y0, a);
+    gather<L>(ref, x1, y0, b);
+    gather<L>(ref, x0, y1, c);
+    gather<L>(ref, x1, y1, d);
+    for (int ch = 0; ch < 4; ch++) {
+      const F top = a[ch] + (b[ch] - a[ch]) * tx;
+      const F bottom = c[ch] + (d[ch] - c[ch]) * tx;
+      out[ch] = top + (bottom - top) * ty;
+    }
+  }
+};
+
+// Catmull-Rom weights of the four taps around fraction t.
+template <typename L>
+inline void catmullRomWeights(typename L::F t, typename L::F *w) {
+  typedef typename L::F F;
+  const F half = L::splat(0.5f), one = L::splat(1.0f);
+  w[0] = ((L::splat(-0.5f) * t + one) * t - half) * t;
+  w[1] = (L::splat(1.5f) * t - L::splat(2.5f)) * t * t + one;
+  w[2] = ((L::splat(-1.5f) * t + L::splat(2.0f)) * t + half) * t;
+  w[3] = (half * t - half) * t * t;
+}
+
+template <typename R, typename L> struct BicubicSampler {
+  typedef R Reference;
+  typedef typename L::F F;
+
+  static void sample(const R &ref, F fx, F fy, F *out) {
+    const F half = L::splat(0.5f);
+    const F u = fx - half, v = fy - half;
+    const F x0f = L::floor(u), y0f = L::floor(v);
+    F wx[4], wy[4];
+    catmullRomWeights<L>(u - x0f, wx);
+    catmullRomWeights<L>(v - y0f, wy);
+
+    int32_t xs[4][L::kCount];
+    for (int i = 0; i < 4; i++)
+      clampedIndices<L>(x0f + L::splat((float)(i - 1)), ref.width, xs[i]);
+
+    const F zero = L::splat(0.0f);
+    for (int ch = 0; ch < 4; ch++)
+      out[ch] = zero;
+    for (int j = 0; j < 4; j++) {
+      int32_t ys[L::kCount];
+      clampedIndices<L>(y0f + L::splat((float)(j - 1)), ref.height, ys);
+      F row[4] = {zero, zero, zero, zero};
+      for (int i = 0; i < 4; i++) {
+        F tap[4];
+        gather<L>(ref, xs[i], ys, tap);
+        for (int ch = 0; ch < 4; ch++)
+          row[ch] = row[ch] + tap[ch] * wx[i];
+      }
+      for (int ch = 0; ch < 4; ch++)
+        out[ch] = out[ch] + row[ch] * wy[j];
+    }
+  }
+};
+
+// The homography and reference bounds in lanes. Shared by the fill and the
+// coverage pass so they agree.
+template <typename L> struct Warp {
+  typedef typename L::F F;
+  F h[9];
+  F originX, originY, width, height, zero;
+
+  explicit Warp(const InpaintJob &job) {
+    for (int i = 0; i < 9; i++)
+      h[i] = L::splat(job.homography[i]);
+    originX = L::splat((float)job.reference.originX);
+    originY = L::splat((float)job.reference.originY);
+    width = L::splat((float)job.reference.width);
+    height = L::splat((float)job.reference.height);
+    zero = L::splat(0.0f);
+  }
+
+  // Maps image pixels (fx, fy) into the reference view; the bits of the
+  // lanes that land inside it. A degenerate warp (z == 0) gives NaN or
+  // infinity; NaN fails every comparison and infinity the range check, so
+  // both count as a miss.
+  uint32_t map(F fx, F fy, F &mx, F &my) const {
+    const F z = h[2] * fx + h[5] * fy + h[8];
+    mx = (h[0] * fx + h[3] * fy + h[6]) / z - originX;
+    my = (h[1] * fx + h[4] * fy + h[7]) / z - originY;
+    return L::bits(L::both(
+        L::both(L::greaterEqual(mx, zero), L::less(mx, width)),
+        L::both(L::greaterEqual(my, zero), L::less(my, height))));
+  }
+};
+
+// Bits of the first n of L::kCount lanes.
+template <typename L> inline uint32_t firstLanes(int32_t n) {
+  return n >= L::kCount ? (1u << L::kCount) - 1u : (1u << n) - 1u;
+}
+
+// Mask bits of the n pixels at p, n <= L::kCount.
+template <typename L> inline uint32_t maskLanes(const uint8_t *p, int32_t n) {
+  if (n == L::kCount)
+    return L::maskBits(p);
+  uint8_t tail[L::kCount] = {};
+  for (int32_t k = 0; k < n; k++)
+    tail[k] = p[k];
+  return L::maskBits(tail);
+}
+
+// Processes columns [lx0, lx1) of region row `i`; `rgba` is a scratch row.
+// Without a mask row every pixel counts as inside (a full tile).
+template <typename Sampler, typename L>
+void inpaintSpan(const InpaintJob &job, const typename Sampler::Reference &ref,
+                 const Warp<L> &warp, size_t i, int32_t lx0, int32_t lx1,
+                 const uint8_t *maskRow, float *rgba) {
+  typedef typename L::F F;
+  const int32_t W = L::kCount;
+  const PixelRect &r = job.region;
+  const int32_t x0 = r.x0 + lx0;
+  const int32_t y = r.y0 + (int32_t)i;
+  const size_t srcX =
+      (size_t)(x0 - job.source.originX) * bytesPerPixel(job.source.format);
+  const size_t dstX = (size_t)(x0 - job.destination.originX) *
+                      bytesPerPixel(job.destination.format);
+
+  loadRowRGBA(job.source.format,
+              job.source.row(y - job.source.originY) + srcX, rgba, lx1 - lx0);
+
+  F planes[4];
+  float lanes[4 * W];
+  const int32_t step = job.coarseStep;
+  if (step > 1) {
+    // One sample per block, at its centre, W blocks at a time; blocks are
+    // aligned to the region.
+    const F fy =
+        L::splat((float)(r.y0 + ((int32_t)i / step) * step + step / 2));
+    const int32_t b1 = (lx1 - 1) / step + 1;
+    for (int32_t b = lx0 / step; b < b1; b += W) {
+      const F fx = L::splat((float)(r.x0 + b * step + step / 2)) +
+                   L::ramp() * L::splat((float)step);
+      F mx, my;
+      const uint32_t hit = warp.map(fx, fy, mx, my) & firstLanes<L>(b1 - b);
+      if (!hit)
+        continue;
+      Sampler::sample(ref, mx, my, planes);
+      L::untranspose(planes, lanes);
+      for (int32_t k = 0; k < W; k++) {
+        if (!(hit >> k & 1u))
+          continue;
+        const int32_t end = std::min((b + k + 1) * step, lx1);
+        for (int32_t lx = std::max((b + k) * step, lx0); lx < end; lx++)
+          if (!maskRow || maskRow[lx] > 127)
+            std::memcpy(rgba + 4 * (lx - lx0), lanes + 4 * k,
+                        4 * sizeof(float));
+      }
+    }
+  } else {
+    const F fy = L::splat((float)y);
+    const uint32_t all = firstLanes<L>(W);
+    for (int32_t lx = lx0; lx < lx1; lx += W) {
+      const int32_t n = std::min(W, lx1 - lx);
+      uint32_t want = firstLanes<L>(n);
+      if (maskRow)
+        want &= maskLanes<L>(maskRow + lx, n);
+      if (!want)
+        continue;
+
+      const F fx = L::splat((float)(r.x0 + lx)) + L::ramp();
+      F mx, my;
+      const uint32_t hit = warp.map(fx, fy, mx, my) & want;
+      if (!hit)
+        continue;
+
+      Sampler::sample(ref, mx, my, planes);
+      float *out = rgba + 4 * (lx - lx0);
+      if (hit == all) {
+        L::untranspose(planes, out);
+        continue;
+      }
+      L::untranspose(planes, lanes);
+      for (int32_t k = 0; k < n; k++)
+        if (hit >> k & 1u)
+          std::memcpy(out + 4 * k, lanes + 4 * k, 4 * sizeof(float));
+    }
+  }
+
+  storeRowRGBA(job.destination.format, rgba,
+               job.destination.row(y - job.destination.originY) + dstX,
+               lx1 - lx0);
+}
+
+template <typename Sampler, typename L>
+void inpaintTile(const InpaintJob &job, const typename Sampler::Reference &ref,
+                 const Warp<L> &warp, uint32_t index, float *rgba) {
+  const MaskTiles &tiles = *job.mask.tiles;
+  const int32_t tx = (int32_t)(index % (uint32_t)tiles.columns);
+  const int32_t ty = (int32_t)(index / (uint32_t)tiles.columns);
+  const bool full = tiles.at(tx, ty) == TileCoverage::Full;
+  const int32_t lx0 = tx * kMaskTileSize;
+  const int32_t lx1 = std::min(lx0 + kMaskTileSize, job.region.width());
+  const int32_t ly0 = ty * kMaskTileSize;
+  const int32_t ly1 = std::min(ly0 + kMaskTileSize, job.region.height());
+  for (int32_t ly = ly0; ly < ly1; ly++) {
+    const uint8_t *maskRow =
+        full ? nullptr : job.mask.data + (size_t)ly * job.mask.bytesPerRow;
+    inpaintSpan<Sampler, L>(job, ref, warp, (size_t)ly, lx0, lx1, maskRow,
+                            rgba);
+  }
+}
+
+template <typename Sampler, typename L> void runInpaint(const InpaintJob &job) {
+  const typename Sampler::Reference ref(job);
+  const Warp<L> warp(job);
+  const MaskTiles *tiles = job.mask.tiles;
+  if (tiles && tiles->matches(job.region.width(), job.region.height())) {
+    parallelFor(tiles->active.size(), kTilesPerChunk,
+                [&](size_t begin, size_t end) {
+                  float rgba[kMaskTileSize * 4];
+                  for (size_t t = begin; t < end && !job.cancel.cancelled();
+                       t++)
+                    inpaintTile<Sampler, L>(job, ref, warp, tiles->active[t],
+                                            rgba);
+                });
+    return;
+  }
+
+  const int32_t width = job.region.width();
+  parallelFor((size_t)job.region.height(), kRowsPerChunk,
+              [&](size_t begin, size_t end) {
+                std::vector<float> rgba((size_t)width * 4);
+                for (size_t i = begin; i < end && !job.cancel.cancelled(); i++)
+                  inpaintSpan<Sampler, L>(
+                      job, ref, warp, i, 0, width,
+                      job.mask.data + i * job.mask.bytesPerRow, rgba.data());
+              });
+}
+
+template <typename R, typename L> void dispatchSampler(const InpaintJob &job) {
+  switch (job.sampling) {
+  case SampleMode::Bilinear:
+    runInpaint<BilinearSampler<R, L>, L>(job);
+    break;
+  case SampleMode::Bicubic:
+    runInpaint<BicubicSampler<R, L>, L>(job);
+    break;
+  default:
+    runInpaint<NearestSampler<R, L>, L>(job);
+    break;
+  }
+}
+
+// Whether a destination row walks across reference rows steeply enough to
+// leave a block row within a block's width: near-axis-aligned warps stream
+// the linear layout just as well, and skip the block address math.
+inline bool crossesReferenceRows(const InpaintJob &job) {
+  const float *h = job.homography;
+  return std::fabs(h[1]) * (float)kRefBlockSize > std::fabs(h[0]);
+}
+
+template <PixelFormat F, typename L>
+void dispatchLayout(const InpaintJob &job) {
+  if (job.tiledReference && job.tiledReference->matches(job.reference) &&
+      crossesReferenceRows(job))
+    dispatchSampler<BlockedReference<F>, L>(job);
+  else
+    dispatchSampler<LinearReference<F>, L>(job);
+}
+
+// The fill over lanes L; the caller has checked the job.
+template <typename L> void inpaintLanes(const InpaintJob &job) {
+  switch (job.reference.format) {
+  case PixelFormat::BGRA8:
+    dispatchLayout<PixelFormat::BGRA8, L>(job);
+    break;
+  case PixelFormat::RGBA16F:
+    dispatchLayout<PixelFormat::RGBA16F, L>(job);
+    break;
+  case PixelFormat::RGBA32F:
+    dispatchLayout<PixelFormat::RGBA32F, L>(job);
+    break;
+  default:
+    break;
+  }
+}
+
+// The coverage pass over lanes L; the caller has checked the job.
+template <typename L>
+void inpaintCoverageLanes(const InpaintJob &job, uint8_t *out,
+                          size_t bytesPerRow) {
+  typedef typename L::F F;
+  const int32_t W = L::kCount;
+  const PixelRect &r = job.region;
+  const Warp<L> warp(job);
+  const MaskTiles *tiles = job.mask.tiles;
+  if (tiles && !tiles->matches(r.width(), r.height()))
+    tiles = nullptr;
+  parallelFor((size_t)r.height(), kRowsPerChunk, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end && !job.cancel.cancelled(); i++) {
+      const uint8_t *maskRow = job.mask.data + i * job.mask.bytesPerRow;
+      uint8_t *outRow = out + i * bytesPerRow;
+      const F fy = L::splat((float)(r.y0 + (int32_t)i));
+      const int32_t ty = (int32_t)i / kMaskTileSize;
+      for (int32_t lx0 = 0; lx0 < r.width(); lx0 += kMaskTileSize) {
+        const int32_t lx1 = std::min(lx0 + kMaskTileSize, r.width());
+        const TileCoverage kind =
+            tiles ? tiles->at(lx0 / kMaskTileSize, ty) : TileCoverage::Partial;
+        std::memset(outRow + lx0, 0, (size_t)(lx1 - lx0));
+        if (kind == TileCoverage::Empty)
+          continue;
+        const bool full = kind == TileCoverage::Full;
+        for (int32_t lx = lx0; lx < lx1; lx += W) {
+          const int32_t n = std::min(W, lx1 - lx);
+          uint32_t want = firstLanes<L>(n);
+          if (!full)
+            want &= maskLanes<L>(maskRow + lx, n);
+          if (!want)
+            continue;
+          F mx, my;
+          const uint32_t hit =
+              warp.map(L::splat((float)(r.x0 + lx)) + L::ramp(), fy, mx, my) &
+              want;
+          for (int32_t k = 0; k < n; k++)
+            if (hit >> k & 1u)
+              outRow[lx + k] = 255;
+        }
+      }
+    }
+  });
+}
+
+} // namespace
+} // namespace gphyx
+
+#endif
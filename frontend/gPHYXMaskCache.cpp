@@ -0,0 +1,65 @@
+#include "gPHYXMaskCache.h"
+#include "gPHYXHash.h"
+
+namespace gphyx {
+
+size_t MaskCache::KeyHash::operator()(const MaskKey &k) const {
+  const int32_t geometry[6] = {k.width,     k.height,    k.region.x0,
+                               k.region.y0, k.region.x1, k.region.y1};
+  return (size_t)hashBytes(geometry, sizeof(geometry), k.shape);
+}
+
+MaskCache::MaskCache(size_t capacityBytes) : capacity_(capacityBytes) {}
+
+MaskCoverage MaskCache::find(const MaskKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end())
+    return nullptr;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->raster;
+}
+
+MaskCoverage MaskCache::insert(const MaskKey &key, PooledBuffer coverage) {
+  if (!coverage)
+    return nullptr;
+  auto stored = std::make_shared<MaskRaster>();
+  stored->tiles =
+      classifyMaskTiles(coverage->data, coverage->shape.bytesPerRow(),
+                        key.region.width(), key.region.height());
+  stored->coverage = std::move(coverage);
+  const size_t size = stored->coverage->shape.bytes() + stored->tiles.bytes();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->raster;
+  }
+  // Too big to ever fit: hand it out uncached.
+  if (size > capacity_)
+    return stored;
+
+  evictLocked(capacity_ - size);
+  lru_.push_front(Entry{key, stored});
+  index_[key] = lru_.begin();
+  bytes_ += size;
+  return stored;
+}
+
+size_t MaskCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void MaskCache::evictLocked(size_t limit) {
+  while (bytes_ > limit && !lru_.empty()) {
+    Entry &victim = lru_.back();
+    bytes_ -= victim.raster->coverage->shape.bytes() +
+              victim.raster->tiles.bytes();
+    index_.erase(victim.key);
+    lru_.pop_back();
+  }
+}
+
+} // namespace gphyx
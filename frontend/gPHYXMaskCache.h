@@ -0,0 +1,78 @@
+#ifndef gPHYXMaskCache_h
+#define gPHYXMaskCache_h
+
+#include "gPHYXBufferPool.h"
+#include "gPHYXMaskTiles.h"
+#include "gPHYXRegion.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace gphyx {
+
+// What a rasterized mask depends on. `shape` hashes the path geometry at the
+// requested time, so a static mask has one key for the whole shot and an
+// animated one changes key only on the frames where it moves.
+struct MaskKey {
+  uint64_t shape = 0;
+  int32_t width = 0; // full mask size the path is scaled to
+  int32_t height = 0;
+  PixelRect region; // rasterized part of it
+
+  bool operator==(const MaskKey &o) const {
+    return shape == o.shape && width == o.width && height == o.height &&
+           region.x0 == o.region.x0 && region.y0 == o.region.y0 &&
+           region.x1 == o.region.x1 && region.y1 == o.region.y1;
+  }
+};
+
+// A rasterized mask: coverage bytes, region.width() per row, and their tile
+// occupancy.
+struct MaskRaster {
+  PooledBuffer coverage;
+  MaskTiles tiles;
+};
+
+// Shared and never written once cached, so renders can hold one while the
+// cache evicts it.
+typedef std::shared_ptr<const MaskRaster> MaskCoverage;
+
+// LRU cache of rasterized masks under a byte budget. Rasters are drawn into
+// buffers of the shared pool, which get them back once evicted and released.
+class MaskCache {
+public:
+  explicit MaskCache(size_t capacityBytes);
+
+  MaskCoverage find(const MaskKey &key);
+  // Classifies the tiles of `coverage`, caches both and returns the shared
+  // raster; if another thread cached the same key meanwhile, that one is
+  // returned instead.
+  MaskCoverage insert(const MaskKey &key, PooledBuffer coverage);
+
+  size_t bytes() const;
+
+private:
+  struct KeyHash {
+    size_t operator()(const MaskKey &k) const;
+  };
+  struct Entry {
+    MaskKey key;
+    std::shared_ptr<MaskRaster> raster;
+  };
+
+  void evictLocked(size_t limit);
+
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_; // most recent first
+  std::unordered_map<MaskKey, std::list<Entry>::iterator, KeyHash> index_;
+  size_t capacity_;
+  size_t bytes_ = 0;
+};
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,62 @@
+#include "gPHYXMaskTiles.h"
+#include <algorithm>
+
+namespace gphyx {
+
+namespace {
+
+int32_t tileCount(int32_t pixels) {
+  return (pixels + kMaskTileSize - 1) / kMaskTileSize;
+}
+
+} // namespace
+
+bool MaskTiles::matches(int32_t width, int32_t height) const {
+  return valid() && columns == tileCount(width) && rows == tileCount(height);
+}
+
+MaskTiles classifyMaskTiles(const uint8_t *coverage, size_t bytesPerRow,
+                            int32_t width, int32_t height) {
+  MaskTiles out;
+  if (!coverage || width <= 0 || height <= 0 || bytesPerRow < (size_t)width)
+    return out;
+  out.columns = tileCount(width);
+  out.rows = tileCount(height);
+  out.tiles.resize((size_t)out.columns * (size_t)out.rows);
+
+  // Per tile of the current band: any pixel inside, every pixel inside.
+  std::vector<uint8_t> any((size_t)out.columns);
+  std::vector<uint8_t> all((size_t)out.columns);
+  for (int32_t ty = 0; ty < out.rows; ty++) {
+    std::fill(any.begin(), any.end(), 0);
+    std::fill(all.begin(), all.end(), 1);
+    const int32_t y0 = ty * kMaskTileSize;
+    const int32_t y1 = std::min(y0 + kMaskTileSize, height);
+    for (int32_t y = y0; y < y1; y++) {
+      const uint8_t *row = coverage + (size_t)y * bytesPerRow;
+      for (int32_t tx = 0; tx < out.columns; tx++) {
+        const int32_t x0 = tx * kMaskTileSize;
+        const int32_t x1 = std::min(x0 + kMaskTileSize, width);
+        uint8_t on = 0, off = 0;
+        for (int32_t x = x0; x < x1; x++) {
+          on |= row[x] > 127;
+          off |= row[x] <= 127;
+        }
+        any[(size_t)tx] |= on;
+        all[(size_t)tx] &= (uint8_t)!off;
+      }
+    }
+
+    for (int32_t tx = 0; tx < out.columns; tx++) {
+      const size_t index = (size_t)ty * (size_t)out.columns + (size_t)tx;
+      if (!any[(size_t)tx])
+        continue; // tiles start out Empty
+      out.tiles[index] =
+          all[(size_t)tx] ? TileCoverage::Full : TileCoverage::Partial;
+      out.active.push_back((uint32_t)index);
+    }
+  }
+  return out;
+}
+
+} // namespace gphyx
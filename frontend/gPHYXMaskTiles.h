@@ -0,0 +1,47 @@
+#ifndef gPHYXMaskTiles_h
+#define gPHYXMaskTiles_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gphyx {
+
+// Side of a mask tile in pixels; the tiled Metal dispatch relies on it being
+// a multiple of its 16x16 threadgroups.
+const int32_t kMaskTileSize = 32;
+
+enum class TileCoverage : uint8_t {
+  Empty = 0, // no pixel inside the mask
+  Partial = 1,
+  Full = 2, // every pixel inside the mask
+};
+
+// Coarse occupancy of a coverage plane (inside: value > 127), so passes over
+// a mask only visit the tiles with something to do and skip the per-pixel
+// test where a tile is fully inside. Tiles on the right and bottom edges are
+// clipped to the plane.
+struct MaskTiles {
+  int32_t columns = 0;
+  int32_t rows = 0;
+  std::vector<TileCoverage> tiles; // row-major
+  std::vector<uint32_t> active;    // indices of the non-empty tiles, ascending
+
+  bool valid() const { return !tiles.empty(); }
+  // Whether this map was built for a plane of width x height.
+  bool matches(int32_t width, int32_t height) const;
+  TileCoverage at(int32_t column, int32_t row) const {
+    return tiles[(size_t)row * (size_t)columns + (size_t)column];
+  }
+  size_t bytes() const {
+    return tiles.size() * sizeof(TileCoverage) +
+           active.size() * sizeof(uint32_t);
+  }
+};
+
+MaskTiles classifyMaskTiles(const uint8_t *coverage, size_t bytesPerRow,
+                            int32_t width, int32_t height);
+
+} // namespace gphyx
+
+#endif
@@ -4,11 +4,23 @@
 #import <FxPlug/FxPlugSDK.h>
 #import <Metal/Metal.h>
 #import <PluginManager/PROAPIAccessing.h>
+#import <os/lock.h>
 
 #ifdef __cplusplus
+#import "gPHYXMaskCache.h"
 #import <vector>
 #endif
 
+#ifdef __cplusplus
+// The mask path at one time, copied out of the host inside a host callback.
+// Bounds and rasters made from it need no host API, so it can be handed to
+// worker threads.
+struct gPHYXMaskShape {
+  std::vector<FxVertex> vertices; // empty: the fallback ellipse
+  uint64_t hash = 0;              // equal hashes rasterize identically
+};
+#endif
+
 struct BezierControlPoint {
   CGPoint anchor;    // Normalized (0..1)
   CGPoint inHandle;  // Offset from anchor (normalized)
@@ -27,6 +39,8 @@ struct BezierControlPoint {
   id<MTLDevice> _device;
   id<MTLCommandQueue> _commandQueue;
 
+  // Written by renders, read by OSC drawing on the host's thread.
+  os_unfair_lock _drawHomographyLock;
   float _drawHomography[9];
 }
 
@@ -34,7 +48,7 @@ struct BezierControlPoint {
 @property(nonatomic, assign) NSInteger selectedIndex;
 @property(nonatomic, assign) NSInteger selectedPart; // 0=anchor, 1=in, 2=out
 @property(nonatomic, assign) NSInteger hoverIndex;
-@property(nonatomic, assign) BOOL hidden;
+@property(atomic, assign) BOOL hidden;
 
 - (instancetype)initWithAPIManager:(id<PROAPIAccessing>)apiManager;
 - (void)addNode:(CGPoint)pt;
@@ -44,11 +58,47 @@ struct BezierControlPoint {
                                    height:(NSUInteger)height
                                apiManager:(id<PROAPIAccessing>)apiManager
                                    atTime:(CMTime)time;
+// Rasterizes only `region` (surface pixels, top-left origin) of a
+// width x height mask; the returned texture is region-sized.
+- (id<MTLTexture>)getMaskTextureForDevice:(id<MTLDevice>)device
+                                    width:(NSUInteger)width
+                                   height:(NSUInteger)height
+                                   region:(MTLRegion)region
+                               apiManager:(id<PROAPIAccessing>)apiManager
+                                   atTime:(CMTime)time;
+// Normalized (0..1) bounding box of whatever getMaskTexture rasterizes at
+// `time`, including Bezier control points.
+- (BOOL)getMaskBounds:(CGRect *)outBounds
+           apiManager:(id<PROAPIAccessing>)apiManager
+               atTime:(CMTime)time;
+// Hash of the mask shape at `time`: equal hashes rasterize identically.
+- (uint64_t)maskShapeAtTime:(CMTime)time
+                 apiManager:(id<PROAPIAccessing>)apiManager;
 
-- (void)setDrawHomography:(float *)matrix;
+- (void)setDrawHomography:(const float *)matrix;
 #ifdef __cplusplus
 - (std::vector<BezierControlPoint> &)getCppNodes;
+// Host calls: only from a host callback.
+- (gPHYXMaskShape)maskShapeSnapshotAtTime:(CMTime)time
+                               apiManager:(id<PROAPIAccessing>)apiManager;
+// No host calls: safe on any thread.
+- (CGRect)maskBoundsForShape:(const gPHYXMaskShape &)shape;
+- (gphyx::MaskCoverage)maskCoverageForShape:(const gPHYXMaskShape &)shape
+                                      width:(NSUInteger)width
+                                     height:(NSUInteger)height
+                                     region:(MTLRegion)region;
+// CPU raster of the same region: region.size.width bytes per row, 255 inside
+// the mask, 0 outside, with its tile occupancy. Cached across instances.
+- (gphyx::MaskCoverage)maskCoverageWithWidth:(NSUInteger)width
+                                      height:(NSUInteger)height
+                                      region:(MTLRegion)region
+                                  apiManager:(id<PROAPIAccessing>)apiManager
+                                      atTime:(CMTime)time;
+// Upload of a raster returned above for `region`, reused while unchanged.
+- (id<MTLTexture>)getMaskTextureForDevice:(id<MTLDevice>)device
+                                 coverage:(const gphyx::MaskCoverage &)coverage
+                                   region:(MTLRegion)region;
 #endif
 
-@property(nonatomic, retain) NSArray<NSValue *> *maskPoints;
+@property(atomic, strong) NSArray<NSValue *> *maskPoints;
 @end
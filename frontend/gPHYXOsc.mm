@@ -1,4 +1,9 @@
 #import "gPHYXOsc.h"
+#import "gPHYXHash.h"
+#import "gPHYXMaskCache.h"
+#import "gPHYXPixel.h"
+#import "gPHYXSurface.h"
+#import "gPHYXTrace.h"
 #import <FxPlug/FxImageTile.h>
 #import <FxPlug/FxOnScreenControl.h>
 #import <FxPlug/FxOnScreenControlAPI.h>
@@ -9,9 +14,93 @@
 
 static int gOscInstanceCount = 0;
 
+// Rasterized masks kept across renders, all instances together.
+static const size_t kMaskCacheBytes = 128 << 20;
+// Uploads of recent rasters kept per OSC: one per tile of a frame or so.
+static const size_t kMaxMaskTextures = 8;
+// Shape key of the fallback ellipse (no path).
+static const uint64_t kFallbackShape = 1;
+
+struct gPHYXMaskTexture {
+  gphyx::MaskCoverage coverage;
+  id<MTLDevice> device;
+  id<MTLTexture> texture;
+};
+
+// Placeholder border, the editor's mask outline and its vertex handles,
+// written in the surface's own pixel format. Points are normalized.
+template <gphyx::PixelFormat F> struct OverlayPainter {
+  static void run(const gphyx::ImageView &view,
+                  const std::vector<CGPoint> &points) {
+    const gphyx::TypedView<F> out = gphyx::typedView<F>(view);
+    const int width = view.width;
+    const int height = view.height;
+    auto plot = [&](int x, int y, const float *rgba) {
+      if (x >= 0 && x < width && y >= 0 && y < height)
+        out.store(x, y, rgba);
+    };
+
+    // Simple yellow corner border as placeholder
+    const float yellow[4] = {1, 1, 0, 1};
+    const int margin = 50;
+    const int thickness = 5;
+    for (int x = margin; x < width - margin; x++) {
+      for (int t = 0; t < thickness; t++) {
+        plot(x, margin + t, yellow);
+        plot(x, height - margin - t - 1, yellow);
+      }
+    }
+
+    // 1. Connecting lines (Bresenham)
+    const float magenta[4] = {1, 0, 1, 1};
+    for (size_t i = 0; i < points.size(); i++) {
+      const CGPoint p1 = points[i];
+      const CGPoint p2 = points[(i + 1) % points.size()];
+      int x1 = (int)(p1.x * width);
+      int y1 = (int)(p1.y * height);
+      int x2 = (int)(p2.x * width);
+      int y2 = (int)(p2.y * height);
+
+      int dx = abs(x2 - x1);
+      int dy = abs(y2 - y1);
+      int sx = (x1 < x2) ? 1 : -1;
+      int sy = (y1 < y2) ? 1 : -1;
+      int err = dx - dy;
+
+      int cx = x1, cy = y1;
+      while (true) {
+        plot(cx, cy, magenta);
+        if (cx == x2 && cy == y2)
+          break;
+        int e2 = 2 * err;
+        if (e2 > -dy) {
+          err -= dy;
+          cx += sx;
+        }
+        if (e2 < dx) {
+          err += dx;
+          cy += sy;
+        }
+      }
+    }
+
+    // 2. Vertex handles: a small 5x5 blue square for each point
+    const float blue[4] = {0, 0, 1, 1};
+    for (const CGPoint &pt : points) {
+      int px = (int)(pt.x * width);
+      int py = (int)(pt.y * height);
+      for (int dy = -2; dy <= 2; dy++)
+        for (int dx = -2; dx <= 2; dx++)
+          plot(px + dx, py + dy, blue);
+    }
+  }
+};
+
 @implementation gPHYXOsc {
   NSUInteger _canvasWidth;
   NSUInteger _canvasHeight;
+  os_unfair_lock _maskTextureLock;
+  std::vector<gPHYXMaskTexture> _maskTextures; // most recent first
 }
 
 - (instancetype)initWithAPIManager:(id<PROAPIAccessing>)apiManager {
@@ -29,6 +118,8 @@ static int gOscInstanceCount = 0;
     _device = MTLCreateSystemDefaultDevice();
     _commandQueue = [_device newCommandQueue];
 
+    _drawHomographyLock = OS_UNFAIR_LOCK_INIT;
+    _maskTextureLock = OS_UNFAIR_LOCK_INIT;
     for (int i = 0; i < 9; i++) {
       _drawHomography[i] = (i % 4 == 0) ? 1.0f : 0.0f;
     }
@@ -58,7 +149,8 @@ static int gOscInstanceCount = 0;
   return *(std::vector<BezierControlPoint> *)_nodesPtr;
 }
 
-- (void)setDrawHomography:(float *)matrix {
+- (void)setDrawHomography:(const float *)matrix {
+  os_unfair_lock_lock(&_drawHomographyLock);
   if (matrix) {
     memcpy(_drawHomography, matrix, sizeof(float) * 9);
   } else {
@@ -66,6 +158,7 @@ static int gOscInstanceCount = 0;
       _drawHomography[i] = (i % 4 == 0) ? 1.0f : 0.0f;
     }
   }
+  os_unfair_lock_unlock(&_drawHomographyLock);
 }
 
 - (void)addNode:(CGPoint)pt {
@@ -111,103 +204,17 @@ static int gOscInstanceCount = 0;
   if (!surface)
     return;
 
-  IOSurfaceLock(surface, 0, NULL);
-  void *baseAddress = IOSurfaceGetBaseAddress(surface);
-  size_t bytesPerRow = IOSurfaceGetBytesPerRow(surface);
-  size_t surfaceWidth = IOSurfaceGetWidth(surface);
-  size_t surfaceHeight = IOSurfaceGetHeight(surface);
-
-  if (baseAddress) {
-    uint8_t *pixels = (uint8_t *)baseAddress;
-    // Simple yellow corner border as placeholder
-    int margin = 50;
-    int thickness = 5;
-    for (int x = margin; x < (int)surfaceWidth - margin; x++) {
-      for (int t = 0; t < thickness; t++) {
-        size_t off1 = (margin + t) * bytesPerRow + x * 4;
-        size_t off2 = (surfaceHeight - margin - t - 1) * bytesPerRow + x * 4;
-        pixels[off1 + 0] = 0;
-        pixels[off1 + 1] = 255;
-        pixels[off1 + 2] = 255;
-        pixels[off1 + 3] = 255;
-        pixels[off2 + 0] = 0;
-        pixels[off2 + 1] = 255;
-        pixels[off2 + 2] = 255;
-        pixels[off2 + 3] = 255;
-      }
-    }
-  }
-
-  // Draw points and lines from external editor if available
-  if (self.maskPoints && self.maskPoints.count > 0) {
-    uint8_t *pixels = (uint8_t *)baseAddress;
-
-    // 1. Draw connecting lines
-    for (int i = 0; i < (int)self.maskPoints.count; i++) {
-      NSPoint p1 = [self.maskPoints[i] pointValue];
-      NSPoint p2 =
-          [self.maskPoints[(i + 1) % self.maskPoints.count] pointValue];
-
-      int x1 = (int)(p1.x * surfaceWidth);
-      int y1 = (int)(p1.y * surfaceHeight);
-      int x2 = (int)(p2.x * surfaceWidth);
-      int y2 = (int)(p2.y * surfaceHeight);
-
-      // Simple Bresenham or just DDA for lines
-      int dx = abs(x2 - x1);
-      int dy = abs(y2 - y1);
-      int sx = (x1 < x2) ? 1 : -1;
-      int sy = (y1 < y2) ? 1 : -1;
-      int err = dx - dy;
-
-      int cx = x1, cy = y1;
-      while (true) {
-        if (cx >= 0 && cx < (int)surfaceWidth && cy >= 0 &&
-            cy < (int)surfaceHeight) {
-          size_t off = cy * bytesPerRow + cx * 4;
-          pixels[off + 0] = 255; // B (Magenta: B=255, G=0, R=255)
-          pixels[off + 1] = 0;   // G
-          pixels[off + 2] = 255; // R
-          pixels[off + 3] = 255; // A
-        }
-        if (cx == x2 && cy == y2)
-          break;
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-          err -= dy;
-          cx += sx;
-        }
-        if (e2 < dx) {
-          err += dx;
-          cy += sy;
-        }
-      }
-    }
-
-    // 2. Draw points (vertex handles)
-    for (NSValue *val in self.maskPoints) {
-      NSPoint pt = [val pointValue];
-      int px = (int)(pt.x * surfaceWidth);
-      int py = (int)(pt.y * surfaceHeight);
-
-      // Draw a small 5x5 blue square for each point
-      for (int dy = -2; dy <= 2; dy++) {
-        for (int dx = -2; dx <= 2; dx++) {
-          int nx = px + dx;
-          int ny = py + dy;
-          if (nx >= 0 && nx < (int)surfaceWidth && ny >= 0 &&
-              ny < (int)surfaceHeight) {
-            size_t off = ny * bytesPerRow + nx * 4;
-            pixels[off + 0] = 255; // B
-            pixels[off + 1] = 0;   // G
-            pixels[off + 2] = 0;   // R
-            pixels[off + 3] = 255; // A
-          }
-        }
-      }
-    }
+  std::vector<CGPoint> points;
+  for (NSValue *val in self.maskPoints) {
+    NSPoint pt = [val pointValue];
+    points.push_back(CGPointMake(pt.x, pt.y));
   }
 
+  IOSurfaceLock(surface, 0, NULL);
+  gphyx::ImageView view = gPHYXImageViewForTile(nil, surface);
+  if (view.data &&
+      !gphyx::dispatchFormat<OverlayPainter>(view.format, view, points))
+    NSLog(@"[gPHYXOsc] ⚠️ Overlay skipped: unsupported surface format");
   IOSurfaceUnlock(surface, 0, NULL);
 }
 
@@ -335,19 +342,163 @@ static int gOscInstanceCount = 0;
                                    height:(NSUInteger)height
                                apiManager:(id<PROAPIAccessing>)apiManager
                                    atTime:(CMTime)time {
-  NSLog(@"[gPHYXOsc] 🎭 getMaskTexture: %lux%lu", (unsigned long)width,
-        (unsigned long)height);
+  return [self getMaskTextureForDevice:device
+                                 width:width
+                                height:height
+                                region:MTLRegionMake2D(0, 0, width, height)
+                            apiManager:apiManager
+                                atTime:time];
+}
 
-  if (!device || width == 0 || height == 0) {
-    NSLog(@"[gPHYXOsc] ❌ Invalid device or dimensions");
-    return nil;
+- (BOOL)getMaskBounds:(CGRect *)outBounds
+           apiManager:(id<PROAPIAccessing>)apiManager
+               atTime:(CMTime)time {
+  gPHYXMaskShape shape = [self maskShapeSnapshotAtTime:time
+                                            apiManager:apiManager];
+  *outBounds = [self maskBoundsForShape:shape];
+  return YES;
+}
+
+- (CGRect)maskBoundsForShape:(const gPHYXMaskShape &)shape {
+  // Must mirror maskCoverageForShape: the path if there is one, else the
+  // fallback ellipse.
+  if (shape.vertices.empty())
+    return CGRectMake(0.25, 0.25, 0.5, 0.5);
+
+  double minX = 1.0, minY = 1.0, maxX = 0.0, maxY = 0.0;
+  for (const FxVertex &vertex : shape.vertices) {
+    // A cubic segment never leaves the hull of its control points.
+    const double xs[3] = {vertex.location.x,
+                          vertex.location.x + vertex.inTangent.x,
+                          vertex.location.x + vertex.outTangent.x};
+    const double ys[3] = {vertex.location.y,
+                          vertex.location.y + vertex.inTangent.y,
+                          vertex.location.y + vertex.outTangent.y};
+    int count = (vertex.interpStyle == kFxPathStyle_Bezier) ? 3 : 1;
+    for (int k = 0; k < count; k++) {
+      minX = MIN(minX, xs[k]);
+      maxX = MAX(maxX, xs[k]);
+      minY = MIN(minY, ys[k]);
+      maxY = MAX(maxY, ys[k]);
+    }
   }
+  return CGRectMake(minX, minY, maxX - minX, maxY - minY);
+}
 
-  if (width > 8192 || height > 8192) {
-    NSLog(@"[gPHYXOsc] ⚠️ Size too large, clamping");
-    return nil;
+// Creates a gray bitmap context for `region` of a width x height mask. The CTM
+// is shifted so callers keep drawing in full-frame CG coordinates.
+static CGContextRef CreateRegionMaskContext(uint8_t *bitmapData,
+                                            NSUInteger height,
+                                            MTLRegion region) {
+  CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+  CGContextRef context = CGBitmapContextCreate(
+      bitmapData, region.size.width, region.size.height, 8, region.size.width,
+      colorSpace, kCGImageAlphaNone);
+  CGColorSpaceRelease(colorSpace);
+  if (!context)
+    return NULL;
+
+  // Fill background with black (0)
+  CGContextSetGrayFillColor(context, 0.0, 1.0);
+  CGContextFillRect(context,
+                    CGRectMake(0, 0, region.size.width, region.size.height));
+
+  // CG is bottom-up: the region's last memory row sits at CG y = height - y1.
+  CGFloat bottom =
+      (CGFloat)height - (CGFloat)(region.origin.y + region.size.height);
+  CGContextTranslateCTM(context, -(CGFloat)region.origin.x, -bottom);
+  return context;
+}
+
+static id<MTLTexture> UploadMaskTexture(id<MTLDevice> device,
+                                        const uint8_t *bitmapData,
+                                        MTLRegion region) {
+  MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
+      texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
+                                   width:region.size.width
+                                  height:region.size.height
+                               mipmapped:NO];
+  texDesc.usage = MTLTextureUsageShaderRead;
+  id<MTLTexture> texture = [device newTextureWithDescriptor:texDesc];
+
+  [texture replaceRegion:MTLRegionMake2D(0, 0, region.size.width,
+                                         region.size.height)
+             mipmapLevel:0
+               withBytes:bitmapData
+             bytesPerRow:region.size.width];
+  return texture;
+}
+
+// Process-wide: identical masks of different instances share one raster.
+static gphyx::MaskCache &SharedMaskCache() {
+  static gphyx::MaskCache *cache = new gphyx::MaskCache(kMaskCacheBytes);
+  return *cache;
+}
+
+// Shape hash of the path geometry; field by field, FxVertex has padding.
+static uint64_t HashVertices(const std::vector<FxVertex> &vertices) {
+  uint64_t h = gphyx::kHashSeed;
+  for (const FxVertex &v : vertices) {
+    const double fields[7] = {v.location.x,   v.location.y,
+                              v.inTangent.x,  v.inTangent.y,
+                              v.outTangent.x, v.outTangent.y,
+                              (double)v.interpStyle};
+    h = gphyx::hashBytes(fields, sizeof(fields), h);
   }
+  return h;
+}
 
+static void RasterizePath(CGContextRef context,
+                          const std::vector<FxVertex> &vertices,
+                          NSUInteger width, NSUInteger height) {
+  // Draw Bezier path from vertices
+  CGContextBeginPath(context);
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const FxVertex &vertex = vertices[i];
+
+    // Convert from image space to normalized 0-1, then to pixel coords
+    double x = vertex.location.x * width;
+    double y = vertex.location.y * height;
+
+    if (i == 0) {
+      CGContextMoveToPoint(context, x, y);
+    } else if (vertex.interpStyle == kFxPathStyle_Bezier) {
+      // Previous vertex's outTangent + current inTangent
+      const FxVertex &prevVertex = vertices[i - 1];
+      double cp1x = (prevVertex.location.x + prevVertex.outTangent.x) * width;
+      double cp1y = (prevVertex.location.y + prevVertex.outTangent.y) * height;
+      double cp2x = (vertex.location.x + vertex.inTangent.x) * width;
+      double cp2y = (vertex.location.y + vertex.inTangent.y) * height;
+
+      CGContextAddCurveToPoint(context, cp1x, cp1y, cp2x, cp2y, x, y);
+    } else {
+      // Linear segment
+      CGContextAddLineToPoint(context, x, y);
+    }
+  }
+
+  CGContextClosePath(context);
+
+  // Fill path with white (1)
+  CGContextSetGrayFillColor(context, 1.0, 1.0);
+  CGContextFillPath(context);
+}
+
+// Fallback ellipse mask for when no path is set
+static void RasterizeFallback(CGContextRef context, NSUInteger width,
+                              NSUInteger height) {
+  CGContextSetGrayFillColor(context, 1.0, 1.0);
+  CGRect ellipseRect =
+      CGRectMake(width * 0.25, height * 0.25, width * 0.5, height * 0.5);
+  CGContextFillEllipseInRect(context, ellipseRect);
+}
+
+// Path vertices at `time`; NO (with the reason logged) if there is no usable
+// path and the fallback ellipse applies.
+- (BOOL)getPathVertices:(std::vector<FxVertex> &)vertices
+             apiManager:(id<PROAPIAccessing>)apiManager
+                 atTime:(CMTime)time {
   // Get path data from parameter
   id<FxParameterRetrievalAPI_v6> paramAPI =
       [apiManager apiForProtocol:@protocol(FxParameterRetrievalAPI_v6)];
@@ -355,15 +506,15 @@ static int gOscInstanceCount = 0;
       [apiManager apiForProtocol:@protocol(FxPathAPI_v3)];
 
   if (!paramAPI || !pathAPI) {
-    NSLog(@"[gPHYXOsc] ⚠️ No Path API, using fallback ellipse");
-    return [self createFallbackMaskForDevice:device width:width height:height];
+    gPHYXTrace(@"[gPHYXOsc] ⚠️ No Path API, using fallback ellipse");
+    return NO;
   }
 
   // Get path ID from parameter kParam_ShowOSC (defined as 12)
   FxPathID pathID = 0;
   if (![paramAPI getPathID:&pathID fromParameter:12 atTime:time]) {
-    NSLog(@"[gPHYXOsc] ⚠️ No path set, using fallback");
-    return [self createFallbackMaskForDevice:device width:width height:height];
+    gPHYXTrace(@"[gPHYXOsc] ⚠️ No path set, using fallback");
+    return NO;
   }
 
   // Get number of vertices
@@ -373,44 +524,17 @@ static int gOscInstanceCount = 0;
                           inPath:pathID
                           atTime:time
                            error:&error]) {
-    NSLog(@"[gPHYXOsc] ⚠️ Failed to get vertices: %@",
-          error.localizedDescription);
-    return [self createFallbackMaskForDevice:device width:width height:height];
+    gPHYXTrace(@"[gPHYXOsc] ⚠️ Failed to get vertices: %@",
+               error.localizedDescription);
+    return NO;
   }
 
   if (numVertices == 0) {
-    NSLog(@"[gPHYXOsc] ⚠️ Path has no vertices");
-    return [self createFallbackMaskForDevice:device width:width height:height];
-  }
-
-  NSLog(@"[gPHYXOsc] ✓ Path has %lu vertices", (unsigned long)numVertices);
-
-  // Create bitmap context
-  size_t bytesPerRow = width;
-  uint8_t *bitmapData = (uint8_t *)calloc(bytesPerRow * height, 1);
-
-  if (!bitmapData) {
-    NSLog(@"[gPHYXOsc] ❌ calloc failed!");
-    return nil;
+    gPHYXTrace(@"[gPHYXOsc] ⚠️ Path has no vertices");
+    return NO;
   }
 
-  CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
-  CGContextRef context = CGBitmapContextCreate(
-      bitmapData, width, height, 8, bytesPerRow, colorSpace, kCGImageAlphaNone);
-  CGColorSpaceRelease(colorSpace);
-
-  if (!context) {
-    free(bitmapData);
-    return nil;
-  }
-
-  // Fill background with black (0)
-  CGContextSetGrayFillColor(context, 0.0, 1.0);
-  CGContextFillRect(context, CGRectMake(0, 0, width, height));
-
-  // Draw Bezier path from vertices
-  CGContextBeginPath(context);
-
+  vertices.reserve(numVertices);
   for (NSUInteger i = 0; i < numVertices; i++) {
     FxVertex vertex;
     if (![pathAPI vertex:&vertex
@@ -418,117 +542,144 @@ static int gOscInstanceCount = 0;
                   ofPath:pathID
                   atTime:time
                    error:&error]) {
-      NSLog(@"[gPHYXOsc] ⚠️ Failed to get vertex %lu", (unsigned long)i);
+      gPHYXTrace(@"[gPHYXOsc] ⚠️ Failed to get vertex %lu", (unsigned long)i);
       continue;
     }
-
-    // Convert from image space to normalized 0-1, then to pixel coords
-    double x = vertex.location.x * width;
-    double y = vertex.location.y * height;
-
-    if (i == 0) {
-      CGContextMoveToPoint(context, x, y);
-    } else {
-      // Check if Bezier curve or linear
-      if (vertex.interpStyle == kFxPathStyle_Bezier) {
-        // Use Bezier curve with tangents
-        // Previous vertex's outTangent + current inTangent
-        FxVertex prevVertex;
-        if ([pathAPI vertex:&prevVertex
-                    atIndex:i - 1
-                     ofPath:pathID
-                     atTime:time
-                      error:nil]) {
-          double cp1x =
-              (prevVertex.location.x + prevVertex.outTangent.x) * width;
-          double cp1y =
-              (prevVertex.location.y + prevVertex.outTangent.y) * height;
-          double cp2x = (vertex.location.x + vertex.inTangent.x) * width;
-          double cp2y = (vertex.location.y + vertex.inTangent.y) * height;
-
-          CGContextAddCurveToPoint(context, cp1x, cp1y, cp2x, cp2y, x, y);
-        } else {
-          CGContextAddLineToPoint(context, x, y);
-        }
-      } else {
-        // Linear segment
-        CGContextAddLineToPoint(context, x, y);
-      }
-    }
+    vertices.push_back(vertex);
   }
+  return !vertices.empty();
+}
 
-  CGContextClosePath(context);
+- (gPHYXMaskShape)maskShapeSnapshotAtTime:(CMTime)time
+                               apiManager:(id<PROAPIAccessing>)apiManager {
+  gPHYXMaskShape shape;
+  // NO leaves the vertices empty: the fallback ellipse.
+  [self getPathVertices:shape.vertices apiManager:apiManager atTime:time];
+  shape.hash = shape.vertices.empty() ? kFallbackShape
+                                      : HashVertices(shape.vertices);
+  return shape;
+}
 
-  // Fill path with white (1)
-  CGContextSetGrayFillColor(context, 1.0, 1.0);
-  CGContextFillPath(context);
+- (uint64_t)maskShapeAtTime:(CMTime)time
+                 apiManager:(id<PROAPIAccessing>)apiManager {
+  return [self maskShapeSnapshotAtTime:time apiManager:apiManager].hash;
+}
 
-  // Create Metal texture
-  MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
-      texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
-                                   width:width
-                                  height:height
-                               mipmapped:NO];
-  texDesc.usage = MTLTextureUsageShaderRead;
-  id<MTLTexture> texture = [device newTextureWithDescriptor:texDesc];
+- (gphyx::MaskCoverage)maskCoverageWithWidth:(NSUInteger)width
+                                      height:(NSUInteger)height
+                                      region:(MTLRegion)region
+                                  apiManager:(id<PROAPIAccessing>)apiManager
+                                      atTime:(CMTime)time {
+  gPHYXMaskShape shape = [self maskShapeSnapshotAtTime:time
+                                            apiManager:apiManager];
+  return [self maskCoverageForShape:shape
+                              width:width
+                             height:height
+                             region:region];
+}
 
-  [texture replaceRegion:MTLRegionMake2D(0, 0, width, height)
-             mipmapLevel:0
-               withBytes:bitmapData
-             bytesPerRow:bytesPerRow];
+- (gphyx::MaskCoverage)maskCoverageForShape:(const gPHYXMaskShape &)shape
+                                      width:(NSUInteger)width
+                                     height:(NSUInteger)height
+                                     region:(MTLRegion)region {
+  if (width == 0 || height == 0 || region.size.width == 0 ||
+      region.size.height == 0 || region.origin.x + region.size.width > width ||
+      region.origin.y + region.size.height > height) {
+    NSLog(@"[gPHYXOsc] ❌ Invalid dimensions");
+    return nullptr;
+  }
 
+  if (width > 8192 || height > 8192) {
+    NSLog(@"[gPHYXOsc] ⚠️ Size too large, clamping");
+    return nullptr;
+  }
+
+  gphyx::MaskKey key;
+  key.shape = shape.hash;
+  key.width = (int32_t)width;
+  key.height = (int32_t)height;
+  key.region = gphyx::makePixelRect(
+      (int32_t)region.origin.x, (int32_t)region.origin.y,
+      (int32_t)region.size.width, (int32_t)region.size.height);
+
+  gphyx::MaskCache &cache = SharedMaskCache();
+  if (gphyx::MaskCoverage cached = cache.find(key))
+    return cached;
+
+  gPHYXTrace(@"[gPHYXOsc] 🎭 Rasterizing mask: %lux%lu region %lux%lu@(%lu,%lu)",
+             (unsigned long)width, (unsigned long)height,
+             (unsigned long)region.size.width,
+             (unsigned long)region.size.height,
+             (unsigned long)region.origin.x, (unsigned long)region.origin.y);
+
+  // Create bitmap context covering only the region
+  gphyx::BufferShape shape;
+  shape.width = (int32_t)region.size.width;
+  shape.height = (int32_t)region.size.height;
+  shape.bytesPerPixel = 1;
+  gphyx::PooledBuffer bitmap = gphyx::sharedBufferPool().acquire(shape);
+  if (!bitmap)
+    return nullptr;
+  CGContextRef context = CreateRegionMaskContext(bitmap->data, height, region);
+  if (!context)
+    return nullptr;
+  if (!shape.vertices.empty())
+    RasterizePath(context, shape.vertices, width, height);
+  else
+    RasterizeFallback(context, width, height);
   CGContextRelease(context);
-  free(bitmapData);
 
-  NSLog(@"[gPHYXOsc] ✅ Mask texture created from path");
-  return texture;
+  return cache.insert(key, std::move(bitmap));
 }
 
-// Fallback ellipse mask for when no path is set
-- (id<MTLTexture>)createFallbackMaskForDevice:(id<MTLDevice>)device
-                                        width:(NSUInteger)width
-                                       height:(NSUInteger)height {
-  size_t bytesPerRow = width;
-  uint8_t *bitmapData = (uint8_t *)calloc(bytesPerRow * height, 1);
-  if (!bitmapData)
-    return nil;
-
-  CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
-  CGContextRef context = CGBitmapContextCreate(
-      bitmapData, width, height, 8, bytesPerRow, colorSpace, kCGImageAlphaNone);
-  CGColorSpaceRelease(colorSpace);
-
-  if (!context) {
-    free(bitmapData);
+- (id<MTLTexture>)getMaskTextureForDevice:(id<MTLDevice>)device
+                                    width:(NSUInteger)width
+                                   height:(NSUInteger)height
+                                   region:(MTLRegion)region
+                               apiManager:(id<PROAPIAccessing>)apiManager
+                                   atTime:(CMTime)time {
+  if (!device) {
+    NSLog(@"[gPHYXOsc] ❌ Invalid device");
     return nil;
   }
+  return [self getMaskTextureForDevice:device
+                              coverage:[self maskCoverageWithWidth:width
+                                                            height:height
+                                                            region:region
+                                                        apiManager:apiManager
+                                                            atTime:time]
+                                region:region];
+}
 
-  // Draw ellipse in center
-  CGContextSetGrayFillColor(context, 0.0, 1.0);
-  CGContextFillRect(context, CGRectMake(0, 0, width, height));
-
-  CGContextSetGrayFillColor(context, 1.0, 1.0);
-  CGRect ellipseRect =
-      CGRectMake(width * 0.25, height * 0.25, width * 0.5, height * 0.5);
-  CGContextFillEllipseInRect(context, ellipseRect);
-
-  MTLTextureDescriptor *texDesc = [MTLTextureDescriptor
-      texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
-                                   width:width
-                                  height:height
-                               mipmapped:NO];
-  texDesc.usage = MTLTextureUsageShaderRead;
-  id<MTLTexture> texture = [device newTextureWithDescriptor:texDesc];
-
-  [texture replaceRegion:MTLRegionMake2D(0, 0, width, height)
-             mipmapLevel:0
-               withBytes:bitmapData
-             bytesPerRow:bytesPerRow];
+- (id<MTLTexture>)getMaskTextureForDevice:(id<MTLDevice>)device
+                                 coverage:(const gphyx::MaskCoverage &)coverage
+                                   region:(MTLRegion)region {
+  if (!device || !coverage)
+    return nil;
 
-  CGContextRelease(context);
-  free(bitmapData);
+  // An unchanged raster comes back as the same buffer; reuse its upload.
+  os_unfair_lock_lock(&_maskTextureLock);
+  for (auto it = _maskTextures.begin(); it != _maskTextures.end(); ++it) {
+    if (it->coverage == coverage && it->device == device) {
+      gPHYXMaskTexture hit = *it;
+      _maskTextures.erase(it);
+      _maskTextures.insert(_maskTextures.begin(), hit);
+      os_unfair_lock_unlock(&_maskTextureLock);
+      return hit.texture;
+    }
+  }
+  os_unfair_lock_unlock(&_maskTextureLock);
 
-  NSLog(@"[gPHYXOsc] ✅ Fallback ellipse mask created");
+  id<MTLTexture> texture =
+      UploadMaskTexture(device, coverage->coverage->data, region);
+  if (!texture)
+    return nil;
+  os_unfair_lock_lock(&_maskTextureLock);
+  _maskTextures.insert(_maskTextures.begin(),
+                       gPHYXMaskTexture{coverage, device, texture});
+  if (_maskTextures.size() > kMaxMaskTextures)
+    _maskTextures.pop_back();
+  os_unfair_lock_unlock(&_maskTextureLock);
   return texture;
 }
 
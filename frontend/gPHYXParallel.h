@@ -0,0 +1,71 @@
+#ifndef gPHYXParallel_h
+#define gPHYXParallel_h
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#endif
+
+namespace gphyx {
+
+inline unsigned hardwareThreads() {
+  unsigned n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+namespace detail {
+template <typename Fn> struct ParallelJob {
+  Fn *fn;
+  size_t count;
+  size_t chunk;
+};
+
+template <typename Fn> void runParallelChunk(void *ctx, size_t index) {
+  ParallelJob<Fn> *job = static_cast<ParallelJob<Fn> *>(ctx);
+  size_t begin = index * job->chunk;
+  size_t end = std::min(job->count, begin + job->chunk);
+  if (begin < end)
+    (*job->fn)(begin, end);
+}
+} // namespace detail
+
+// Splits [0, count) into contiguous chunks of at least `grain` items and runs
+// fn(begin, end) on each, using every core when the work is large enough.
+// Blocks until all chunks are done. Uses GCD on Apple platforms so repeated
+// calls share one thread pool, plain std::thread elsewhere.
+template <typename Fn>
+void parallelFor(size_t count, size_t grain, Fn &&fn) {
+  if (count == 0)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  size_t maxChunks = (count + grain - 1) / grain;
+  size_t chunks = std::min<size_t>(maxChunks, hardwareThreads());
+  if (chunks <= 1) {
+    fn((size_t)0, count);
+    return;
+  }
+
+  typedef typename std::remove_reference<Fn>::type FnType;
+  detail::ParallelJob<FnType> job = {&fn, count, (count + chunks - 1) / chunks};
+#if defined(__APPLE__)
+  dispatch_apply_f(chunks, DISPATCH_APPLY_AUTO, &job,
+                   detail::runParallelChunk<FnType>);
+#else
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  for (size_t i = 1; i < chunks; i++)
+    workers.emplace_back(detail::runParallelChunk<FnType>, &job, i);
+  detail::runParallelChunk<FnType>(&job, 0);
+  for (std::thread &t : workers)
+    t.join();
+#endif
+}
+
+} // namespace gphyx
+
+#endif
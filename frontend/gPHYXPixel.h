@@ -0,0 +1,198 @@
+#ifndef gPHYXPixel_h
+#define gPHYXPixel_h
+
+#include "gPHYXHalf.h"
+#include "gPHYXImage.h"
+#include <cstring>
+
+namespace gphyx {
+
+// Compile-time description of each PixelFormat: storage type, channel order
+// and conversions to and from unpremultiplied float RGBA. CPU kernels are
+// written once over a format parameter and instantiated per format, so inner
+// loops carry no format switches.
+template <PixelFormat F> struct PixelTraits;
+
+template <> struct PixelTraits<PixelFormat::BGRA8> {
+  typedef uint8_t Storage;
+  static const size_t kBytes = 4;
+
+  static void load(const uint8_t *p, float *rgba) {
+    rgba[0] = p[2] * (1.0f / 255.0f);
+    rgba[1] = p[1] * (1.0f / 255.0f);
+    rgba[2] = p[0] * (1.0f / 255.0f);
+    rgba[3] = p[3] * (1.0f / 255.0f);
+  }
+  static void store(const float *rgba, uint8_t *p) {
+    p[0] = toByte(rgba[2]);
+    p[1] = toByte(rgba[1]);
+    p[2] = toByte(rgba[0]);
+    p[3] = toByte(rgba[3]);
+  }
+  static uint8_t toByte(float v) {
+    v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    return (uint8_t)(v * 255.0f + 0.5f);
+  }
+  static void loadRow(const uint8_t *p, float *rgba, int32_t count) {
+    for (int32_t i = 0; i < count; i++)
+      load(p + (size_t)i * kBytes, rgba + 4 * i);
+  }
+  static void storeRow(const float *rgba, uint8_t *p, int32_t count) {
+    for (int32_t i = 0; i < count; i++)
+      store(rgba + 4 * i, p + (size_t)i * kBytes);
+  }
+};
+
+template <> struct PixelTraits<PixelFormat::RGBA16F> {
+  typedef uint16_t Storage;
+  static const size_t kBytes = 8;
+
+  // Pixels and rows alike go through the vector converters.
+  static void load(const uint8_t *p, float *rgba) {
+    uint16_t h[4];
+    std::memcpy(h, p, sizeof(h));
+    halfToFloat4(h, rgba);
+  }
+  static void store(const float *rgba, uint8_t *p) {
+    uint16_t h[4];
+    floatToHalf4(rgba, h);
+    std::memcpy(p, h, sizeof(h));
+  }
+  static void loadRow(const uint8_t *p, float *rgba, int32_t count) {
+    halfToFloatRow(reinterpret_cast<const uint16_t *>(p), rgba,
+                   (size_t)count * 4);
+  }
+  static void storeRow(const float *rgba, uint8_t *p, int32_t count) {
+    floatToHalfRow(rgba, reinterpret_cast<uint16_t *>(p), (size_t)count * 4);
+  }
+};
+
+template <> struct PixelTraits<PixelFormat::RGBA32F> {
+  typedef float Storage;
+  static const size_t kBytes = 16;
+
+  static void load(const uint8_t *p, float *rgba) {
+    std::memcpy(rgba, p, kBytes);
+  }
+  static void store(const float *rgba, uint8_t *p) {
+    std::memcpy(p, rgba, kBytes);
+  }
+  static void loadRow(const uint8_t *p, float *rgba, int32_t count) {
+    std::memcpy(rgba, p, (size_t)count * kBytes);
+  }
+  static void storeRow(const float *rgba, uint8_t *p, int32_t count) {
+    std::memcpy(p, rgba, (size_t)count * kBytes);
+  }
+};
+
+// Rec. 709 luma of an RGBA value, as the tracking copies use it.
+inline float lumaOf(const float *rgba) {
+  return 0.2126f * rgba[0] + 0.7152f * rgba[1] + 0.0722f * rgba[2];
+}
+
+// Pixels converted per pass by transformRow: 4 KB of floats, which stays in
+// L1 between the load, the work and the store.
+const int32_t kTransformChunk = 256;
+
+// Fused load-convert-process-store: streams `count` pixels of format S
+// through fn(float *rgba, int32_t n) in L1-sized chunks and writes them out
+// as format D. `src` and `dst` may be the same row.
+template <PixelFormat S, PixelFormat D, typename Fn>
+void transformRow(const uint8_t *src, uint8_t *dst, int32_t count, Fn &&fn) {
+  float rgba[kTransformChunk * 4];
+  for (int32_t i = 0; i < count; i += kTransformChunk) {
+    const int32_t n = count - i < kTransformChunk ? count - i : kTransformChunk;
+    PixelTraits<S>::loadRow(src + (size_t)i * PixelTraits<S>::kBytes, rgba, n);
+    fn(rgba, n);
+    PixelTraits<D>::storeRow(rgba, dst + (size_t)i * PixelTraits<D>::kBytes,
+                             n);
+  }
+}
+
+// An ImageView whose format is known at compile time. Build it with
+// typedView<F>() after checking the format.
+template <PixelFormat F> struct TypedView {
+  typedef PixelTraits<F> Traits;
+
+  ImageView view;
+
+  uint8_t *row(int32_t y) const { return view.row(y); }
+  uint8_t *at(int32_t x, int32_t y) const {
+    return view.row(y) + (size_t)x * Traits::kBytes;
+  }
+  void load(int32_t x, int32_t y, float *rgba) const {
+    Traits::load(at(x, y), rgba);
+  }
+  void store(int32_t x, int32_t y, const float *rgba) const {
+    Traits::store(rgba, at(x, y));
+  }
+  // Image-space variants, honouring the view's origin.
+  bool contains(int32_t ix, int32_t iy) const {
+    return ix >= view.originX && iy >= view.originY &&
+           ix < view.originX + view.width && iy < view.originY + view.height;
+  }
+  uint8_t *atImage(int32_t ix, int32_t iy) const {
+    return at(ix - view.originX, iy - view.originY);
+  }
+};
+
+template <PixelFormat F> TypedView<F> typedView(const ImageView &view) {
+  TypedView<F> t;
+  t.view = view;
+  return t;
+}
+
+// Runs Kernel<F>::run(args...) for the format given at run time, the one
+// switch a kernel needs. Returns false for unknown formats.
+template <template <PixelFormat> class Kernel, typename... Args>
+bool dispatchFormat(PixelFormat format, Args &&...args) {
+  switch (format) {
+  case PixelFormat::BGRA8:
+    Kernel<PixelFormat::BGRA8>::run(args...);
+    return true;
+  case PixelFormat::RGBA16F:
+    Kernel<PixelFormat::RGBA16F>::run(args...);
+    return true;
+  case PixelFormat::RGBA32F:
+    Kernel<PixelFormat::RGBA32F>::run(args...);
+    return true;
+  default:
+    return false;
+  }
+}
+
+namespace detail {
+template <template <PixelFormat, PixelFormat> class Kernel, PixelFormat S>
+struct BindSource {
+  template <PixelFormat D> struct Bound {
+    template <typename... Args> static void run(Args &&...args) {
+      Kernel<S, D>::run(args...);
+    }
+  };
+};
+} // namespace detail
+
+// Same for kernels over a source and a destination format.
+template <template <PixelFormat, PixelFormat> class Kernel, typename... Args>
+bool dispatchFormats(PixelFormat src, PixelFormat dst, Args &&...args) {
+  switch (src) {
+  case PixelFormat::BGRA8:
+    return dispatchFormat<
+        detail::BindSource<Kernel, PixelFormat::BGRA8>::template Bound>(
+        dst, args...);
+  case PixelFormat::RGBA16F:
+    return dispatchFormat<
+        detail::BindSource<Kernel, PixelFormat::RGBA16F>::template Bound>(
+        dst, args...);
+  case PixelFormat::RGBA32F:
+    return dispatchFormat<
+        detail::BindSource<Kernel, PixelFormat::RGBA32F>::template Bound>(
+        dst, args...);
+  default:
+    return false;
+  }
+}
+
+} // namespace gphyx
+
+#endif
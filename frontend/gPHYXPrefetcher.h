@@ -0,0 +1,50 @@
+#ifndef gPHYXPrefetcher_h
+#define gPHYXPrefetcher_h
+
+#import "gPHYXCancel.h"
+#import "gPHYXRenderAhead.h"
+#import <CoreMedia/CoreMedia.h>
+#import <Foundation/Foundation.h>
+#import <memory>
+
+// Computes the fill for `time` into `patch` on a worker thread. Returns NO
+// when the frame can't be filled ahead of its render (e.g. not tracked yet)
+// or `cancel` fired before it was done.
+// Must not call the host: the parameter and path APIs are only safe inside
+// host callbacks.
+typedef BOOL (^gPHYXFillBuilder)(CMTime time, gphyx::FillPatch &patch,
+                                 const gphyx::CancelToken &cancel);
+
+// Called on the render's thread for each frame about to be queued, so it may
+// read from the host what the builder for `time` needs. nil skips the frame.
+typedef gPHYXFillBuilder (^gPHYXFillPlanner)(CMTime time);
+
+// Process-wide render-ahead. Foreground renders report where the playhead
+// is; the frames it is heading to get their fills computed in the background
+// so that their render is a cache lookup and a copy.
+@interface gPHYXPrefetcher : NSObject
+
++ (instancetype)sharedPrefetcher;
+
+// Feeds the playhead prediction of an instance with a render at `time`. A
+// jump drops the prefetches still queued and cancels the running one. With a
+// planner, the predicted frames that are not cached yet are queued. Returns
+// YES for a jump.
+- (BOOL)noteRenderForInstanceID:(NSString *)instanceID
+                           time:(CMTime)time
+                        planner:(gPHYXFillPlanner)planner;
+
+- (std::shared_ptr<const gphyx::FillPatch>)patchForInstanceID:
+                                               (NSString *)instanceID
+                                                         time:(CMTime)time;
+
+// Whether the instance's last render was of `time`: the playhead has not
+// moved on since.
+- (BOOL)isLastRenderOfInstanceID:(NSString *)instanceID atTime:(CMTime)time;
+
+// Forgets the instance's patches and queued work, e.g. on a new plate.
+- (void)invalidateInstanceID:(NSString *)instanceID;
+
+@end
+
+#endif
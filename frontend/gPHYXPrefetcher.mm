@@ -0,0 +1,180 @@
+#import "gPHYXPrefetcher.h"
+#import <os/lock.h>
+#import <string>
+#import <unordered_map>
+#import <unordered_set>
+
+// Frames computed ahead of the playhead. Enough to hide a fill behind a few
+// frames of playback without racing far past where the user stops.
+static const size_t kLookaheadFrames = 6;
+// Default memory for cached fills; override with the gPHYXRenderAheadMB
+// user default.
+static const NSInteger kDefaultBudgetMB = 256;
+static NSString *const kBudgetDefaultsKey = @"gPHYXRenderAheadMB";
+
+namespace {
+
+struct Playhead {
+  gphyx::PlayheadPredictor predictor;
+  uint64_t generation = 0; // bumped on jumps; stale jobs check it
+  // Handed to this generation's builds, cancelled when it is bumped.
+  gphyx::CancelToken cancel = gphyx::CancelToken::make();
+
+  void advance() {
+    generation++;
+    cancel.cancel();
+    cancel = gphyx::CancelToken::make();
+  }
+};
+
+std::string FrameKey(const std::string &instance, const gphyx::MediaTime &t) {
+  return instance + "|" + std::to_string(t.value) + "/" +
+         std::to_string(t.timescale);
+}
+
+} // namespace
+
+@implementation gPHYXPrefetcher {
+  os_unfair_lock _lock;
+  std::unordered_map<std::string, Playhead> _playheads;
+  std::unordered_set<std::string> _queued; // FrameKeys queued or running
+  std::unique_ptr<gphyx::FillPatchCache> _cache;
+  dispatch_queue_t _queue;
+}
+
++ (instancetype)sharedPrefetcher {
+  static gPHYXPrefetcher *prefetcher = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    prefetcher = [[gPHYXPrefetcher alloc] init];
+  });
+  return prefetcher;
+}
+
+- (instancetype)init {
+  if (self = [super init]) {
+    _lock = OS_UNFAIR_LOCK_INIT;
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSInteger budgetMB = [defaults integerForKey:kBudgetDefaultsKey];
+    if (budgetMB <= 0)
+      budgetMB = kDefaultBudgetMB;
+    _cache.reset(new gphyx::FillPatchCache((size_t)budgetMB << 20));
+    // Fills already spread over all cores; one job at a time is plenty and
+    // keeps the foreground render ahead in the CPU queue.
+    _queue = dispatch_queue_create(
+        "com.gphyx.renderahead",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL,
+                                                QOS_CLASS_UTILITY, 0));
+    NSLog(@"[gPHYX] ⏩ Render-ahead budget %ld MB", (long)budgetMB);
+  }
+  return self;
+}
+
+static gphyx::MediaTime MediaTimeOf(CMTime time) {
+  gphyx::MediaTime t;
+  t.value = time.value;
+  t.timescale = time.timescale;
+  return t;
+}
+
+- (BOOL)noteRenderForInstanceID:(NSString *)instanceID
+                           time:(CMTime)time
+                        planner:(gPHYXFillPlanner)planner {
+  const std::string instance(instanceID.UTF8String ?: "");
+  std::vector<gphyx::MediaTime> queue;
+  uint64_t generation = 0;
+  gphyx::CancelToken cancel;
+  BOOL jumped = NO;
+
+  os_unfair_lock_lock(&_lock);
+  Playhead &playhead = _playheads[instance];
+  jumped = playhead.predictor.observe(MediaTimeOf(time));
+  if (jumped)
+    playhead.advance();
+  generation = playhead.generation;
+  cancel = playhead.cancel;
+  if (planner) {
+    for (const gphyx::MediaTime &t :
+         playhead.predictor.upcoming(kLookaheadFrames)) {
+      if (!_cache->contains(instance, t) &&
+          _queued.insert(FrameKey(instance, t)).second)
+        queue.push_back(t);
+    }
+  }
+  os_unfair_lock_unlock(&_lock);
+
+  // Planned outside the lock: the planner calls into the host. By value:
+  // blocks capture references as references.
+  for (gphyx::MediaTime t : queue) {
+    gPHYXFillBuilder builder = planner(CMTimeMake(t.value, t.timescale));
+    if (!builder) {
+      os_unfair_lock_lock(&_lock);
+      _queued.erase(FrameKey(instance, t));
+      os_unfair_lock_unlock(&_lock);
+      continue;
+    }
+    dispatch_async(_queue, ^{
+      [self runJobForInstance:instance
+                         time:t
+                   generation:generation
+                       cancel:cancel
+                      builder:builder];
+    });
+  }
+  return jumped;
+}
+
+- (void)runJobForInstance:(const std::string &)instance
+                     time:(gphyx::MediaTime)t
+               generation:(uint64_t)generation
+                   cancel:(const gphyx::CancelToken &)cancel
+                  builder:(gPHYXFillBuilder)builder {
+  if ([self isCurrentGeneration:generation instance:instance]) {
+    @autoreleasepool {
+      auto patch = std::make_shared<gphyx::FillPatch>();
+      if (builder(CMTimeMake(t.value, t.timescale), *patch, cancel) &&
+          [self isCurrentGeneration:generation instance:instance])
+        _cache->insert(instance, t, std::move(patch));
+    }
+  }
+  os_unfair_lock_lock(&_lock);
+  _queued.erase(FrameKey(instance, t));
+  os_unfair_lock_unlock(&_lock);
+}
+
+- (BOOL)isCurrentGeneration:(uint64_t)generation
+                   instance:(const std::string &)instance {
+  os_unfair_lock_lock(&_lock);
+  auto it = _playheads.find(instance);
+  BOOL current = it != _playheads.end() && it->second.generation == generation;
+  os_unfair_lock_unlock(&_lock);
+  return current;
+}
+
+- (std::shared_ptr<const gphyx::FillPatch>)patchForInstanceID:
+                                               (NSString *)instanceID
+                                                         time:(CMTime)time {
+  return _cache->find(instanceID.UTF8String ?: "", MediaTimeOf(time));
+}
+
+- (BOOL)isLastRenderOfInstanceID:(NSString *)instanceID atTime:(CMTime)time {
+  const std::string instance(instanceID.UTF8String ?: "");
+  gphyx::MediaTime last;
+  os_unfair_lock_lock(&_lock);
+  auto it = _playheads.find(instance);
+  BOOL found = it != _playheads.end() && it->second.predictor.last(&last);
+  os_unfair_lock_unlock(&_lock);
+  return found && gphyx::compareTimes(last, MediaTimeOf(time)) == 0;
+}
+
+- (void)invalidateInstanceID:(NSString *)instanceID {
+  const std::string instance(instanceID.UTF8String ?: "");
+  os_unfair_lock_lock(&_lock);
+  auto it = _playheads.find(instance);
+  if (it != _playheads.end())
+    it->second.advance();
+  os_unfair_lock_unlock(&_lock);
+  _cache->eraseInstance(instance);
+}
+
+@end
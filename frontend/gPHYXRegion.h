@@ -0,0 +1,115 @@
+#ifndef gPHYXRegion_h
+#define gPHYXRegion_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace gphyx {
+
+// Axis-aligned pixel rectangle in surface coordinates (top-left origin, rows
+// growing downwards). Half-open: [x0, x1) x [y0, y1).
+struct PixelRect {
+  int32_t x0 = 0;
+  int32_t y0 = 0;
+  int32_t x1 = 0;
+  int32_t y1 = 0;
+
+  int32_t width() const { return x1 > x0 ? x1 - x0 : 0; }
+  int32_t height() const { return y1 > y0 ? y1 - y0 : 0; }
+  bool empty() const { return x1 <= x0 || y1 <= y0; }
+  uint64_t area() const { return (uint64_t)width() * (uint64_t)height(); }
+};
+
+inline PixelRect makePixelRect(int32_t x, int32_t y, int32_t w, int32_t h) {
+  PixelRect r;
+  r.x0 = x;
+  r.y0 = y;
+  r.x1 = x + w;
+  r.y1 = y + h;
+  return r;
+}
+
+inline PixelRect intersectRects(const PixelRect &a, const PixelRect &b) {
+  PixelRect r;
+  r.x0 = std::max(a.x0, b.x0);
+  r.y0 = std::max(a.y0, b.y0);
+  r.x1 = std::min(a.x1, b.x1);
+  r.y1 = std::min(a.y1, b.y1);
+  if (r.empty())
+    return PixelRect();
+  return r;
+}
+
+inline PixelRect unionRects(const PixelRect &a, const PixelRect &b) {
+  if (a.empty())
+    return b;
+  if (b.empty())
+    return a;
+  PixelRect r;
+  r.x0 = std::min(a.x0, b.x0);
+  r.y0 = std::min(a.y0, b.y0);
+  r.x1 = std::max(a.x1, b.x1);
+  r.y1 = std::max(a.y1, b.y1);
+  return r;
+}
+
+inline PixelRect expandRect(const PixelRect &r, int32_t margin) {
+  if (r.empty())
+    return r;
+  PixelRect e;
+  e.x0 = r.x0 - margin;
+  e.y0 = r.y0 - margin;
+  e.x1 = r.x1 + margin;
+  e.y1 = r.y1 + margin;
+  return e;
+}
+
+// Converts a normalized mask bounding box (0..1, bottom-up, the way the mask
+// is rasterized through CoreGraphics) into the surface pixels it covers. The
+// box is grown by max(minMargin, relMargin * longest side) so feathering and
+// the tracker's search window stay inside, then clipped to the surface.
+inline PixelRect maskRegionForNormalizedBounds(double minX, double minY,
+                                               double maxX, double maxY,
+                                               int32_t width, int32_t height,
+                                               double relMargin,
+                                               int32_t minMargin) {
+  PixelRect surface = makePixelRect(0, 0, width, height);
+  if (width <= 0 || height <= 0 || maxX < minX || maxY < minY)
+    return PixelRect();
+
+  PixelRect r;
+  r.x0 = (int32_t)std::floor(minX * width);
+  r.x1 = (int32_t)std::ceil(maxX * width);
+  // CG row 0 is the bottom of the bitmap, memory row 0 is the top.
+  r.y0 = (int32_t)std::floor(height - maxY * height);
+  r.y1 = (int32_t)std::ceil(height - minY * height);
+
+  double longest = (double)std::max(r.x1 - r.x0, r.y1 - r.y0);
+  int32_t margin =
+      std::max(minMargin, (int32_t)std::ceil(longest * relMargin));
+  return intersectRects(expandRect(r, margin), surface);
+}
+
+// Part of a width x height frame a captured plate keeps in colour: the mask
+// region grown on each side by its own size (at least minMargin), so the
+// fill still lands on the plate as tracking moves the mask around. The whole
+// frame when there is no mask region yet.
+inline PixelRect plateRegionForMask(const PixelRect &maskRegion, int32_t width,
+                                    int32_t height, int32_t minMargin) {
+  PixelRect frame = makePixelRect(0, 0, width, height);
+  if (maskRegion.empty())
+    return frame;
+  PixelRect r;
+  const int32_t mx = std::max(minMargin, maskRegion.width());
+  const int32_t my = std::max(minMargin, maskRegion.height());
+  r.x0 = maskRegion.x0 - mx;
+  r.y0 = maskRegion.y0 - my;
+  r.x1 = maskRegion.x1 + mx;
+  r.y1 = maskRegion.y1 + my;
+  return intersectRects(r, frame);
+}
+
+} // namespace gphyx
+
+#endif
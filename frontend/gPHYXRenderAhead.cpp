@@ -0,0 +1,197 @@
+#include "gPHYXRenderAhead.h"
+#include "gPHYXHash.h"
+#include "gPHYXPixel.h"
+#include <cstring>
+
+namespace gphyx {
+
+namespace {
+
+// Steps longer than this are seeks, not playback.
+const double kMaxPlaybackStepSeconds = 0.5;
+
+// Copies the covered patch pixels; fixed-size copies of one pixel each.
+template <PixelFormat F> struct CompositeRows {
+  static void run(const FillPatch &patch, const ImageView &dst,
+                  const PixelRect &area) {
+    const size_t bpp = PixelTraits<F>::kBytes;
+    const TypedView<F> out = typedView<F>(dst);
+    const size_t patchRow = (size_t)patch.region.width();
+    for (int32_t y = area.y0; y < area.y1; y++) {
+      const size_t py = (size_t)(y - patch.region.y0);
+      const uint8_t *cov = patch.coverage.data() + py * patchRow;
+      const uint8_t *src = patch.pixels.data() + py * patchRow * bpp;
+      for (int32_t x = area.x0; x < area.x1; x++) {
+        const size_t px = (size_t)(x - patch.region.x0);
+        if (cov[px])
+          std::memcpy(out.atImage(x, y), src + px * bpp, bpp);
+      }
+    }
+  }
+};
+
+} // namespace
+
+bool makeFillPatch(const InpaintJob &job, PixelFormat format, FillPatch &out) {
+  const size_t bpp = bytesPerPixel(format);
+  if (bpp == 0 || job.region.empty())
+    return false;
+
+  const size_t width = (size_t)job.region.width();
+  const size_t height = (size_t)job.region.height();
+  out.region = job.region;
+  out.format = format;
+  out.pixels.assign(width * height * bpp, 0);
+  out.coverage.assign(width * height, 0);
+
+  // The patch is both source and destination: uncovered pixels stay zero and
+  // are never composited.
+  ImageView view;
+  view.data = out.pixels.data();
+  view.bytesPerRow = width * bpp;
+  view.width = (int32_t)width;
+  view.height = (int32_t)height;
+  view.originX = job.region.x0;
+  view.originY = job.region.y0;
+  view.format = format;
+
+  InpaintJob fill = job;
+  fill.source = view;
+  fill.destination = view;
+  return inpaintCPU(fill) &&
+         inpaintCoverage(job, out.coverage.data(), width);
+}
+
+bool compositeFillPatch(const FillPatch &patch, const ImageView &dst) {
+  if (patch.format != dst.format || !dst.valid())
+    return false;
+  const PixelRect area = intersectRects(patch.region, dst.imageRect());
+  if (area.empty())
+    return true;
+  return dispatchFormat<CompositeRows>(patch.format, patch, dst, area);
+}
+
+// --- PlayheadPredictor
+
+bool PlayheadPredictor::observe(const MediaTime &t) {
+  if (!hasLast_) {
+    hasLast_ = true;
+    last_ = t;
+    return false;
+  }
+  if (compareTimes(t, last_) == 0)
+    return false; // another tile of the same frame
+
+  bool jumped = true;
+  int64_t step = 0;
+  if (t.timescale == last_.timescale) {
+    step = t.value - last_.value;
+    const double seconds = (double)step / t.timescale;
+    const bool playback = seconds > -kMaxPlaybackStepSeconds &&
+                          seconds < kMaxPlaybackStepSeconds;
+    // Same direction, no more than twice the previous step: still playing,
+    // maybe at another speed.
+    const bool continues =
+        step_ != 0 && (step > 0) == (step_ > 0) &&
+        (step > 0 ? step <= 2 * step_ : step >= 2 * step_);
+    jumped = !continues;
+    if (!playback)
+      step = 0;
+  }
+  step_ = step;
+  last_ = t;
+  return jumped;
+}
+
+std::vector<MediaTime> PlayheadPredictor::upcoming(size_t count) const {
+  std::vector<MediaTime> times;
+  if (!hasLast_ || step_ == 0)
+    return times;
+  times.reserve(count);
+  for (size_t k = 1; k <= count; k++) {
+    MediaTime t = last_;
+    t.value += step_ * (int64_t)k;
+    if (t.value < 0)
+      break;
+    times.push_back(t);
+  }
+  return times;
+}
+
+bool PlayheadPredictor::last(MediaTime *t) const {
+  if (hasLast_)
+    *t = last_;
+  return hasLast_;
+}
+
+// --- FillPatchCache
+
+size_t FillPatchCache::KeyHash::operator()(const Key &k) const {
+  uint64_t h = hashBytes(k.instance.data(), k.instance.size());
+  h = hashBytes(&k.value, sizeof(k.value), h);
+  return (size_t)hashBytes(&k.timescale, sizeof(k.timescale), h);
+}
+
+FillPatchCache::FillPatchCache(size_t budgetBytes) : budget_(budgetBytes) {}
+
+std::shared_ptr<const FillPatch>
+FillPatchCache::find(const std::string &instance, const MediaTime &t) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(Key{instance, t.value, t.timescale});
+  if (it == index_.end())
+    return nullptr;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->patch;
+}
+
+bool FillPatchCache::contains(const std::string &instance,
+                              const MediaTime &t) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.count(Key{instance, t.value, t.timescale}) != 0;
+}
+
+void FillPatchCache::insert(const std::string &instance, const MediaTime &t,
+                            std::shared_ptr<const FillPatch> patch) {
+  if (!patch || patch->bytes() > budget_)
+    return;
+  Key key{instance, t.value, t.timescale};
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    bytes_ -= it->second->patch->bytes();
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  evictLocked(budget_ - patch->bytes());
+  bytes_ += patch->bytes();
+  lru_.push_front(Entry{key, std::move(patch)});
+  index_[key] = lru_.begin();
+}
+
+void FillPatchCache::eraseInstance(const std::string &instance) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = lru_.begin(); it != lru_.end();) {
+    if (it->key.instance == instance) {
+      bytes_ -= it->patch->bytes();
+      index_.erase(it->key);
+      it = lru_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t FillPatchCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void FillPatchCache::evictLocked(size_t limit) {
+  while (bytes_ > limit && !lru_.empty()) {
+    bytes_ -= lru_.back().patch->bytes();
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+}
+
+} // namespace gphyx
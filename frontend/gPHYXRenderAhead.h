@@ -0,0 +1,99 @@
+#ifndef gPHYXRenderAhead_h
+#define gPHYXRenderAhead_h
+
+#include "gPHYXHomographyStore.h"
+#include "gPHYXInpaintCPU.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gphyx {
+
+// The fill a render would paint over the mask region, computed ahead of time.
+// Pixels are in `format`, region.width() per row; `coverage` marks the pixels
+// the fill replaces (255), everything else keeps the source.
+struct FillPatch {
+  PixelRect region; // image space
+  PixelFormat format = PixelFormat::Unknown;
+  uint64_t signature = 0; // inputs it was made from, see the effect
+  std::vector<uint8_t> pixels;
+  std::vector<uint8_t> coverage;
+
+  size_t bytes() const { return pixels.size() + coverage.size(); }
+};
+
+// Runs `job` (source and destination ignored) into a patch of `format`.
+// False if the job is unusable or was cancelled; `out` is then incomplete.
+bool makeFillPatch(const InpaintJob &job, PixelFormat format, FillPatch &out);
+
+// Paints the covered pixels of `patch` that fall inside `dst` (a tile placed
+// by its origin). False if the formats differ; nothing is written then.
+bool compositeFillPatch(const FillPatch &patch, const ImageView &dst);
+
+// Guesses the next frames from the last renders of one instance. Renders of
+// a new time continuing the current step (forwards or backwards, any speed)
+// keep the prediction; anything else is a jump.
+class PlayheadPredictor {
+public:
+  // Returns true when `t` does not continue the motion seen so far.
+  bool observe(const MediaTime &t);
+  // Up to `count` frames ahead in the direction of play; none while paused
+  // or right after a jump.
+  std::vector<MediaTime> upcoming(size_t count) const;
+  // The time observed last; false before the first.
+  bool last(MediaTime *t) const;
+
+private:
+  bool hasLast_ = false;
+  MediaTime last_;
+  int64_t step_ = 0; // in last_.timescale, signed
+};
+
+// Bounded LRU of fill patches by instance and frame time.
+class FillPatchCache {
+public:
+  explicit FillPatchCache(size_t budgetBytes);
+
+  std::shared_ptr<const FillPatch> find(const std::string &instance,
+                                        const MediaTime &t);
+  bool contains(const std::string &instance, const MediaTime &t) const;
+  void insert(const std::string &instance, const MediaTime &t,
+              std::shared_ptr<const FillPatch> patch);
+  void eraseInstance(const std::string &instance);
+
+  size_t bytes() const;
+
+private:
+  struct Key {
+    std::string instance;
+    int64_t value;
+    int32_t timescale;
+    bool operator==(const Key &o) const {
+      return value == o.value && timescale == o.timescale &&
+             instance == o.instance;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &k) const;
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<const FillPatch> patch;
+  };
+
+  void evictLocked(size_t limit);
+
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_; // most recent first
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  size_t budget_;
+  size_t bytes_ = 0;
+};
+
+} // namespace gphyx
+
+#endif
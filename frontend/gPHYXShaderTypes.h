@@ -0,0 +1,27 @@
+#ifndef gPHYXShaderTypes_h
+#define gPHYXShaderTypes_h
+
+// Shared between InpaintKernel.metal and the host-side encoder.
+#include <simd/simd.h>
+
+// Positions are image pixels (top-left origin). The *Origin fields place each
+// texture's pixel (0, 0) in its image, so tiled inputs line up.
+typedef struct {
+  vector_uint2 regionOrigin;      // Top-left of the processed region
+  vector_uint2 regionSize;        // The mask texture covers exactly this region
+  vector_uint2 sourceOrigin;      // sourceTexture tile
+  vector_uint2 destinationOrigin; // destTexture tile
+  vector_uint2 referenceOrigin;   // refTexture tile, in the reference image
+  uint32_t sampling; // gphyx::SampleMode: 0 nearest, 1 bilinear, 2 bicubic
+} gPHYXInpaintParams;
+
+// Side of a mask tile, gphyx::kMaskTileSize; one grid slice per tile.
+#define GPHYX_MASK_TILE_SIZE 32
+
+// A mask tile with pixels inside the mask, positioned in the region.
+typedef struct {
+  vector_ushort2 origin; // region pixels
+  uint32_t full;         // every pixel inside: the mask is not read
+} gPHYXMaskTile;
+
+#endif
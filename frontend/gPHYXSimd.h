@@ -0,0 +1,228 @@
+#ifndef gPHYXSimd_h
+#define gPHYXSimd_h
+
+#include "gPHYXHalf.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Lane types for kernels that process several pixels per step: F holds one
+// float per pixel and M one pass/fail flag per pixel. Lanes4 is SSE2 on x86
+// and NEON on ARM64; Lanes1 is plain C++, for other CPUs and for comparing
+// against. An AVX2 Lanes8 lives in gPHYXInpaintAVX2.cpp, the one file built
+// for it.
+//
+// Every operation rounds exactly like the scalar float code it replaces
+// (no fused multiply-add), so all lane widths give the same pixels. min()
+// and max() return their second argument when the first is NaN.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GPHYX_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GPHYX_SIMD_NEON 1
+#endif
+
+// gPHYXInpaintAVX2.cpp provides 8-lane kernels, picked at run time.
+#if GPHYX_SIMD_SSE && (defined(__x86_64__) || defined(_M_X64))
+#define GPHYX_SIMD_AVX2 1
+#endif
+
+namespace gphyx {
+
+struct Lanes1 {
+  static const int kCount = 1;
+  struct F {
+    float v;
+    friend F operator+(F a, F b) { return {a.v + b.v}; }
+    friend F operator-(F a, F b) { return {a.v - b.v}; }
+    friend F operator*(F a, F b) { return {a.v * b.v}; }
+    friend F operator/(F a, F b) { return {a.v / b.v}; }
+  };
+  typedef bool M;
+
+  static F splat(float s) { return {s}; }
+  static F ramp() { return {0.0f}; }
+  static F min(F a, F b) { return {a.v < b.v ? a.v : b.v}; }
+  static F max(F a, F b) { return {a.v > b.v ? a.v : b.v}; }
+  static F floor(F a) { return {std::floor(a.v)}; }
+  static M less(F a, F b) { return a.v < b.v; }
+  static M greaterEqual(F a, F b) { return a.v >= b.v; }
+  static M both(M a, M b) { return a && b; }
+  static uint32_t bits(M m) { return m ? 1u : 0u; }
+  // Lanes must hold values that fit an int32.
+  static void truncate(F a, int32_t *out) { out[0] = (int32_t)a.v; }
+  // Bit k set where p[k] > 127.
+  static uint32_t maskBits(const uint8_t *p) { return p[0] > 127 ? 1u : 0u; }
+  // kCount RGBA pixels, interleaved, to one F per channel and back.
+  static void transpose(const float *rgba, F *planes) {
+    for (int c = 0; c < 4; c++)
+      planes[c].v = rgba[c];
+  }
+  static void untranspose(const F *planes, float *rgba) {
+    for (int c = 0; c < 4; c++)
+      rgba[c] = planes[c].v;
+  }
+  // kCount BGRA8 pixels, one per 32-bit word, to planar RGBA in [0, 1].
+  static void unpackBGRA8(const uint32_t *words, F *planes) {
+    const uint32_t w = words[0];
+    planes[0].v = (float)((w >> 16) & 255u) * (1.0f / 255.0f);
+    planes[1].v = (float)((w >> 8) & 255u) * (1.0f / 255.0f);
+    planes[2].v = (float)(w & 255u) * (1.0f / 255.0f);
+    planes[3].v = (float)(w >> 24) * (1.0f / 255.0f);
+  }
+  // kCount RGBA16F pixels, four halves each, to planar RGBA.
+  static void unpackRGBA16F(const uint16_t *halves, F *planes) {
+    float rgba[4];
+    halfToFloat4(halves, rgba);
+    transpose(rgba, planes);
+  }
+};
+
+#if GPHYX_SIMD_SSE
+struct Lanes4 {
+  static const int kCount = 4;
+  struct F {
+    __m128 v;
+    friend F operator+(F a, F b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend F operator-(F a, F b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend F operator*(F a, F b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend F operator/(F a, F b) { return {_mm_div_ps(a.v, b.v)}; }
+  };
+  struct M {
+    __m128 v;
+  };
+
+  static F splat(float s) { return {_mm_set1_ps(s)}; }
+  static F ramp() { return {_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)}; }
+  static F min(F a, F b) { return {_mm_min_ps(a.v, b.v)}; }
+  static F max(F a, F b) { return {_mm_max_ps(a.v, b.v)}; }
+  // SSE2 has no round instruction; exact for |a| < 2^31.
+  static F floor(F a) {
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return {_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)))};
+  }
+  static M less(F a, F b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+  static M greaterEqual(F a, F b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+  static M both(M a, M b) { return {_mm_and_ps(a.v, b.v)}; }
+  static uint32_t bits(M m) { return (uint32_t)_mm_movemask_ps(m.v); }
+  static void truncate(F a, int32_t *out) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_cvttps_epi32(a.v));
+  }
+  // The top bit of each byte is set exactly when it is > 127.
+  static uint32_t maskBits(const uint8_t *p) {
+    int32_t word;
+    std::memcpy(&word, p, 4);
+    return (uint32_t)_mm_movemask_epi8(_mm_cvtsi32_si128(word)) & 0xfu;
+  }
+  static void transpose(const float *rgba, F *planes) {
+    __m128 p0 = _mm_loadu_ps(rgba), p1 = _mm_loadu_ps(rgba + 4);
+    __m128 p2 = _mm_loadu_ps(rgba + 8), p3 = _mm_loadu_ps(rgba + 12);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    planes[0].v = p0;
+    planes[1].v = p1;
+    planes[2].v = p2;
+    planes[3].v = p3;
+  }
+  static void untranspose(const F *planes, float *rgba) {
+    __m128 p0 = planes[0].v, p1 = planes[1].v;
+    __m128 p2 = planes[2].v, p3 = planes[3].v;
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    _mm_storeu_ps(rgba, p0);
+    _mm_storeu_ps(rgba + 4, p1);
+    _mm_storeu_ps(rgba + 8, p2);
+    _mm_storeu_ps(rgba + 12, p3);
+  }
+  static void unpackBGRA8(const uint32_t *words, F *planes) {
+    const __m128i w =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(words));
+    const __m128i byte = _mm_set1_epi32(255);
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    planes[0].v = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w, 16), byte)), scale);
+    planes[1].v = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w, 8), byte)), scale);
+    planes[2].v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(w, byte)), scale);
+    planes[3].v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(w, 24)), scale);
+  }
+  // F16C isn't baseline; one checked call converts all four pixels.
+  static void unpackRGBA16F(const uint16_t *halves, F *planes) {
+    float rgba[16];
+    halfToFloatRow(halves, rgba, 16);
+    transpose(rgba, planes);
+  }
+};
+#elif GPHYX_SIMD_NEON && defined(__aarch64__)
+struct Lanes4 {
+  static const int kCount = 4;
+  // Plain mul/add (no vfma) so results match Lanes1 bit for bit.
+  struct F {
+    float32x4_t v;
+    friend F operator+(F a, F b) { return {vaddq_f32(a.v, b.v)}; }
+    friend F operator-(F a, F b) { return {vsubq_f32(a.v, b.v)}; }
+    friend F operator*(F a, F b) { return {vmulq_f32(a.v, b.v)}; }
+    friend F operator/(F a, F b) { return {vdivq_f32(a.v, b.v)}; }
+  };
+  struct M {
+    uint32x4_t v;
+  };
+
+  static F splat(float s) { return {vdupq_n_f32(s)}; }
+  static F ramp() {
+    static const float kRamp[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    return {vld1q_f32(kRamp)};
+  }
+  // The "nm" forms return the number when one operand is NaN.
+  static F min(F a, F b) { return {vminnmq_f32(a.v, b.v)}; }
+  static F max(F a, F b) { return {vmaxnmq_f32(a.v, b.v)}; }
+  static F floor(F a) { return {vrndmq_f32(a.v)}; }
+  static M less(F a, F b) { return {vcltq_f32(a.v, b.v)}; }
+  static M greaterEqual(F a, F b) { return {vcgeq_f32(a.v, b.v)}; }
+  static M both(M a, M b) { return {vandq_u32(a.v, b.v)}; }
+  static uint32_t bits(M m) {
+    static const int32_t kShift[4] = {0, 1, 2, 3};
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(m.v, 31), vld1q_s32(kShift)));
+  }
+  static void truncate(F a, int32_t *out) {
+    vst1q_s32(out, vcvtq_s32_f32(a.v));
+  }
+  static uint32_t maskBits(const uint8_t *p) {
+    return (p[0] > 127 ? 1u : 0u) | (p[1] > 127 ? 2u : 0u) |
+           (p[2] > 127 ? 4u : 0u) | (p[3] > 127 ? 8u : 0u);
+  }
+  static void transpose(const float *rgba, F *planes) {
+    const float32x4x4_t p = vld4q_f32(rgba);
+    for (int c = 0; c < 4; c++)
+      planes[c].v = p.val[c];
+  }
+  static void untranspose(const F *planes, float *rgba) {
+    float32x4x4_t p;
+    for (int c = 0; c < 4; c++)
+      p.val[c] = planes[c].v;
+    vst4q_f32(rgba, p);
+  }
+  static void unpackBGRA8(const uint32_t *words, F *planes) {
+    const uint32x4_t w = vld1q_u32(words);
+    const uint32x4_t byte = vdupq_n_u32(255);
+    const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+    planes[0].v = vmulq_f32(
+        vcvtq_f32_u32(vandq_u32(vshrq_n_u32(w, 16), byte)), scale);
+    planes[1].v =
+        vmulq_f32(vcvtq_f32_u32(vandq_u32(vshrq_n_u32(w, 8), byte)), scale);
+    planes[2].v = vmulq_f32(vcvtq_f32_u32(vandq_u32(w, byte)), scale);
+    planes[3].v = vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(w, 24)), scale);
+  }
+  static void unpackRGBA16F(const uint16_t *halves, F *planes) {
+    const uint16x4x4_t h = vld4_u16(halves);
+    for (int c = 0; c < 4; c++)
+      planes[c].v = vcvt_f32_f16(vreinterpret_f16_u16(h.val[c]));
+  }
+};
+#else
+typedef Lanes1 Lanes4;
+#endif
+
+} // namespace gphyx
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef gPHYXSnapshot_h
+#define gPHYXSnapshot_h
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace gphyx {
+
+// Read-mostly shared value. Readers grab an immutable snapshot without
+// waiting on writers; writers copy, mutate and publish under a writer-only
+// mutex. Meant for small, rarely written state (registries, settings).
+template <typename T> class Snapshot {
+public:
+  Snapshot() : current_(std::make_shared<const T>()) {}
+
+  std::shared_ptr<const T> load() const { return std::atomic_load(&current_); }
+
+  template <typename Fn> void update(Fn &&mutate) {
+    std::lock_guard<std::mutex> lock(writerMutex_);
+    std::shared_ptr<T> next = std::make_shared<T>(*std::atomic_load(&current_));
+    mutate(*next);
+    std::atomic_store(&current_, std::shared_ptr<const T>(std::move(next)));
+  }
+
+private:
+  std::shared_ptr<const T> current_;
+  std::mutex writerMutex_;
+};
+
+} // namespace gphyx
+
+#endif
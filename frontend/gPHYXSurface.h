@@ -0,0 +1,199 @@
+#ifndef gPHYXSurface_h
+#define gPHYXSurface_h
+
+#import "gPHYXBlit.h"
+#import "gPHYXBufferPool.h"
+#import "gPHYXImage.h"
+#import <CoreVideo/CoreVideo.h>
+#import <FxPlug/FxPlugSDK.h>
+#import <IOSurface/IOSurface.h>
+#import <Metal/Metal.h>
+
+// Bridges host IOSurfaces into the portable gphyx image views. Callers must
+// hold the surface lock while the view is in use.
+
+static inline gphyx::PixelFormat gPHYXPixelFormatForSurface(
+    IOSurfaceRef surface) {
+  switch (IOSurfaceGetPixelFormat(surface)) {
+  case kCVPixelFormatType_32BGRA:
+    return gphyx::PixelFormat::BGRA8;
+  case kCVPixelFormatType_64RGBAHalf:
+    return gphyx::PixelFormat::RGBA16F;
+  case kCVPixelFormatType_128RGBAFloat:
+    return gphyx::PixelFormat::RGBA32F;
+  default:
+    return gphyx::PixelFormat::Unknown;
+  }
+}
+
+// Metal format that views a surface as it is laid out; the kernels read and
+// write floats through it whichever format the host chose.
+static inline MTLPixelFormat
+gPHYXMetalPixelFormatForSurface(IOSurfaceRef surface) {
+  switch (gPHYXPixelFormatForSurface(surface)) {
+  case gphyx::PixelFormat::BGRA8:
+    return MTLPixelFormatBGRA8Unorm;
+  case gphyx::PixelFormat::RGBA16F:
+    return MTLPixelFormatRGBA16Float;
+  case gphyx::PixelFormat::RGBA32F:
+    return MTLPixelFormatRGBA32Float;
+  default:
+    return MTLPixelFormatInvalid;
+  }
+}
+
+// FxRects are image pixels with a bottom-up y axis; the gphyx rects are
+// relative to the image's top-left corner.
+static inline gphyx::PixelRect gPHYXPixelRectForFxRect(FxRect rect,
+                                                       FxRect image) {
+  return gphyx::makePixelRect(rect.left - image.left, image.top - rect.top,
+                              rect.right - rect.left, rect.top - rect.bottom);
+}
+
+static inline FxRect gPHYXFxRectForPixelRect(const gphyx::PixelRect &rect,
+                                             FxRect image) {
+  FxRect out;
+  out.left = image.left + rect.x0;
+  out.right = image.left + rect.x1;
+  out.top = image.top - rect.y0;
+  out.bottom = image.top - rect.y1;
+  return out;
+}
+
+// The origin places the tile inside its full image, top-left based, so tiles
+// of different sizes (e.g. source vs destination) line up.
+static inline gphyx::ImageView gPHYXImageViewForTile(FxImageTile *tile,
+                                                     IOSurfaceRef surface) {
+  gphyx::ImageView view;
+  if (!surface)
+    return view;
+  view.data = IOSurfaceGetBaseAddress(surface);
+  view.bytesPerRow = IOSurfaceGetBytesPerRow(surface);
+  view.width = (int32_t)IOSurfaceGetWidth(surface);
+  view.height = (int32_t)IOSurfaceGetHeight(surface);
+  view.format = gPHYXPixelFormatForSurface(surface);
+  if (tile) {
+    FxRect image = tile.imagePixelBounds;
+    FxRect bounds = tile.tilePixelBounds;
+    view.originX = bounds.left - image.left;
+    view.originY = image.top - bounds.top;
+  }
+  return view;
+}
+
+// Luma of `surface`, box-filtered down by `downsample`, into `dst`.
+static inline bool gPHYXCopySurfaceLuma(IOSurfaceRef surface,
+                                        int32_t downsample, uint8_t *dst,
+                                        size_t dstBytesPerRow) {
+  IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+  bool copied = gphyx::downsampleLuma(
+      dst, dstBytesPerRow, gPHYXImageViewForTile(nil, surface), downsample);
+  IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+  return copied;
+}
+
+// Detached copy of `rect` (surface pixels, clipped to the surface) of a host
+// surface. Host tiles are recycled once the render returns, so anything that
+// outlives the render and is sampled in colour (captured plates) must own its
+// pixels. IOSurface-backed so Metal can read it. Returns NULL for formats
+// blitImage can't copy.
+static inline CVPixelBufferRef
+gPHYXCreatePixelBufferCopy(IOSurfaceRef surface, const gphyx::PixelRect &rect) {
+  if (!surface ||
+      gPHYXPixelFormatForSurface(surface) == gphyx::PixelFormat::Unknown)
+    return NULL;
+  gphyx::PixelRect area = gphyx::intersectRects(
+      rect, gphyx::makePixelRect(0, 0, (int32_t)IOSurfaceGetWidth(surface),
+                                 (int32_t)IOSurfaceGetHeight(surface)));
+  if (area.empty())
+    return NULL;
+
+  NSDictionary *attrs = @{(id)kCVPixelBufferIOSurfacePropertiesKey : @{}};
+  CVPixelBufferRef copy = NULL;
+  if (CVPixelBufferCreate(kCFAllocatorDefault, (size_t)area.width(),
+                          (size_t)area.height(),
+                          IOSurfaceGetPixelFormat(surface),
+                          (__bridge CFDictionaryRef)attrs,
+                          &copy) != kCVReturnSuccess)
+    return NULL;
+
+  CVPixelBufferLockBaseAddress(copy, 0);
+  gphyx::ImageView dst;
+  dst.data = CVPixelBufferGetBaseAddress(copy);
+  dst.bytesPerRow = CVPixelBufferGetBytesPerRow(copy);
+  dst.width = area.width();
+  dst.height = area.height();
+  dst.format = gPHYXPixelFormatForSurface(surface);
+  dst.originX = area.x0;
+  dst.originY = area.y0;
+  IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+  bool copied = gphyx::blitImage(dst, gPHYXImageViewForTile(nil, surface));
+  IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+  CVPixelBufferUnlockBaseAddress(copy, 0);
+
+  if (!copied) {
+    CVPixelBufferRelease(copy);
+    return NULL;
+  }
+  return copy;
+}
+
+// 8-bit luma copy of a host surface, reduced by `downsample`, for tracking.
+static inline CVPixelBufferRef gPHYXCreateLumaCopy(IOSurfaceRef surface,
+                                                   int32_t downsample) {
+  if (!surface || downsample < 1)
+    return NULL;
+  size_t width = IOSurfaceGetWidth(surface) / (size_t)downsample;
+  size_t height = IOSurfaceGetHeight(surface) / (size_t)downsample;
+  CVPixelBufferRef copy = NULL;
+  if (width == 0 || height == 0 ||
+      CVPixelBufferCreate(kCFAllocatorDefault, width, height,
+                          kCVPixelFormatType_OneComponent8, NULL,
+                          &copy) != kCVReturnSuccess)
+    return NULL;
+
+  CVPixelBufferLockBaseAddress(copy, 0);
+  bool copied = gPHYXCopySurfaceLuma(
+      surface, downsample, (uint8_t *)CVPixelBufferGetBaseAddress(copy),
+      CVPixelBufferGetBytesPerRow(copy));
+  CVPixelBufferUnlockBaseAddress(copy, 0);
+  if (!copied) {
+    CVPixelBufferRelease(copy);
+    return NULL;
+  }
+  return copy;
+}
+
+static inline void gPHYXReleasePooledBytes(void *releaseRefCon, const void *) {
+  delete static_cast<gphyx::PooledBuffer *>(releaseRefCon);
+}
+
+// Same luma copy in a buffer of the shared pool, charged to `owner` until the
+// pixel buffer is released. The per-frame tracking copies come from here.
+static inline CVPixelBufferRef
+gPHYXCreatePooledLumaCopy(IOSurfaceRef surface, int32_t downsample,
+                          uint64_t owner) {
+  if (!surface || downsample < 1)
+    return NULL;
+  gphyx::BufferShape shape;
+  shape.width = (int32_t)(IOSurfaceGetWidth(surface) / (size_t)downsample);
+  shape.height = (int32_t)(IOSurfaceGetHeight(surface) / (size_t)downsample);
+  shape.bytesPerPixel = 1;
+  gphyx::PooledBuffer buffer = gphyx::sharedBufferPool().acquire(shape, owner);
+  if (!buffer || !gPHYXCopySurfaceLuma(surface, downsample, buffer->data,
+                                       shape.bytesPerRow()))
+    return NULL;
+
+  gphyx::PooledBuffer *hold = new gphyx::PooledBuffer(buffer);
+  CVPixelBufferRef copy = NULL;
+  if (CVPixelBufferCreateWithBytes(
+          kCFAllocatorDefault, (size_t)shape.width, (size_t)shape.height,
+          kCVPixelFormatType_OneComponent8, buffer->data, shape.bytesPerRow(),
+          gPHYXReleasePooledBytes, hold, NULL, &copy) != kCVReturnSuccess) {
+    delete hold;
+    return NULL;
+  }
+  return copy;
+}
+
+#endif
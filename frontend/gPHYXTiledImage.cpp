@@ -0,0 +1,40 @@
+#include "gPHYXTiledImage.h"
+#include "gPHYXParallel.h"
+#include <algorithm>
+#include <cstring>
+
+namespace gphyx {
+
+bool tileImage(const ImageView &src, TiledImage &out) {
+  if (!src.valid())
+    return false;
+  const size_t bpp = bytesPerPixel(src.format);
+  const int32_t blockColumns =
+      (src.width + kRefBlockSize - 1) >> kRefBlockShift;
+  const int32_t blockRows = (src.height + kRefBlockSize - 1) >> kRefBlockShift;
+  out.width = src.width;
+  out.height = src.height;
+  out.blockColumns = blockColumns;
+  out.format = src.format;
+  out.pixels.assign((size_t)blockColumns * (size_t)blockRows *
+                        (size_t)(kRefBlockSize * kRefBlockSize) * bpp,
+                    0);
+
+  parallelFor((size_t)blockRows, 1, [&](size_t begin, size_t end) {
+    for (size_t by = begin; by < end; by++) {
+      const int32_t y0 = (int32_t)by << kRefBlockShift;
+      const int32_t y1 = std::min(y0 + kRefBlockSize, src.height);
+      for (int32_t y = y0; y < y1; y++) {
+        const uint8_t *row = src.row(y);
+        for (int32_t x0 = 0; x0 < src.width; x0 += kRefBlockSize) {
+          const int32_t n = std::min(kRefBlockSize, src.width - x0);
+          std::memcpy(out.pixels.data() + out.index(x0, y) * bpp,
+                      row + (size_t)x0 * bpp, (size_t)n * bpp);
+        }
+      }
+    }
+  });
+  return true;
+}
+
+} // namespace gphyx
@@ -0,0 +1,50 @@
+#ifndef gPHYXTiledImage_h
+#define gPHYXTiledImage_h
+
+#include "gPHYXImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gphyx {
+
+// Side of a block is 1 << kRefBlockShift: 8 pixels keeps one block row of
+// RGBA16F in a single 64-byte cache line.
+const int32_t kRefBlockShift = 3;
+const int32_t kRefBlockSize = 1 << kRefBlockShift;
+
+// Copy of an image in kRefBlockSize-square blocks, pixels row-major inside a
+// block and blocks row-major across the image. Samplers walking the image
+// at an angle (rotated or perspective warps) then touch a few cache lines
+// per neighbourhood instead of one per row. Edge blocks are padded.
+struct TiledImage {
+  std::vector<uint8_t> pixels;
+  int32_t width = 0;
+  int32_t height = 0;
+  int32_t blockColumns = 0;
+  PixelFormat format = PixelFormat::Unknown;
+
+  bool valid() const { return !pixels.empty(); }
+  // Whether this is a copy of an image of `view`'s size and format.
+  bool matches(const ImageView &view) const {
+    return valid() && width == view.width && height == view.height &&
+           format == view.format;
+  }
+  // Offset of pixel (x, y) in pixels, to be scaled by the pixel size.
+  size_t index(int32_t x, int32_t y) const {
+    const size_t block = (size_t)(y >> kRefBlockShift) * (size_t)blockColumns +
+                         (size_t)(x >> kRefBlockShift);
+    const size_t inBlock =
+        (size_t)(((y & (kRefBlockSize - 1)) << kRefBlockShift) |
+                 (x & (kRefBlockSize - 1)));
+    return (block << (2 * kRefBlockShift)) + inBlock;
+  }
+  size_t bytes() const { return pixels.size(); }
+};
+
+// Copies `src` (origin ignored) into blocks. False if it is unusable.
+bool tileImage(const ImageView &src, TiledImage &out);
+
+} // namespace gphyx
+
+#endif
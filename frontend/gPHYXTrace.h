@@ -0,0 +1,20 @@
+#ifndef gPHYXTrace_h
+#define gPHYXTrace_h
+
+#import <Foundation/Foundation.h>
+
+// Logging for the render path: once per render, tile or mask lookup. At
+// playback rates NSLog there floods the unified log and holds up the render,
+// so it is compiled out unless GPHYX_RENDER_TRACE is 1, e.g. from
+// OTHER_CFLAGS in a debug build. The arguments are still type-checked.
+#ifndef GPHYX_RENDER_TRACE
+#define GPHYX_RENDER_TRACE 0
+#endif
+
+#define gPHYXTrace(...)                                                        \
+  do {                                                                         \
+    if (GPHYX_RENDER_TRACE)                                                    \
+      NSLog(__VA_ARGS__);                                                      \
+  } while (0)
+
+#endif
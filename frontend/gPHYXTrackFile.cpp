@@ -0,0 +1,190 @@
+#include "gPHYXTrackFile.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gphyx {
+
+namespace {
+
+const char kTrackMagic[8] = {'G', 'P', 'H', 'X', 'T', 'R', 'K', 0};
+const uint32_t kTrackVersion = 2; // 2: per-record tracking signature
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t sourceIdentity;
+  uint8_t reserved[40];
+};
+static_assert(sizeof(FileHeader) == 64, "track header layout");
+
+struct FileRecord {
+  int64_t value;
+  int32_t timescale;
+  float confidence;
+  uint64_t signature;
+  float roi[4];
+  float matrix[9];
+  uint32_t checksum; // of everything above
+};
+static_assert(sizeof(FileRecord) == 80, "track record layout");
+
+uint32_t recordChecksum(const FileRecord &r) {
+  return (uint32_t)hashBytes(&r, offsetof(FileRecord, checksum));
+}
+
+FileRecord encode(const TrackRecord &in) {
+  FileRecord r;
+  std::memset(&r, 0, sizeof(r));
+  r.value = in.sample.time.value;
+  r.timescale = in.sample.time.timescale;
+  r.confidence = in.sample.confidence;
+  r.signature = in.sample.signature;
+  std::memcpy(r.roi, in.roi, sizeof(r.roi));
+  std::memcpy(r.matrix, in.sample.matrix.data(), sizeof(r.matrix));
+  r.checksum = recordChecksum(r);
+  return r;
+}
+
+bool headerMatches(const FileHeader &h, uint64_t sourceIdentity) {
+  return std::memcmp(h.magic, kTrackMagic, sizeof(kTrackMagic)) == 0 &&
+         h.version == kTrackVersion && h.recordSize == sizeof(FileRecord) &&
+         h.sourceIdentity == sourceIdentity;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0)
+      return false;
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+} // namespace
+
+TrackFile::TrackFile(std::string path, uint64_t sourceIdentity)
+    : path_(std::move(path)), sourceIdentity_(sourceIdentity) {}
+
+TrackFile::~TrackFile() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool TrackFile::load(std::vector<TrackRecord> &out) const {
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = (size_t)st.st_size;
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const uint8_t *base = static_cast<const uint8_t *>(map);
+  FileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  if (!headerMatches(header, sourceIdentity_)) {
+    ::munmap(map, size);
+    return false;
+  }
+
+  const size_t count = (size - sizeof(FileHeader)) / sizeof(FileRecord);
+  out.reserve(out.size() + count);
+  for (size_t i = 0; i < count; i++) {
+    FileRecord r;
+    std::memcpy(&r, base + sizeof(FileHeader) + i * sizeof(FileRecord),
+                sizeof(r));
+    if (r.checksum != recordChecksum(r) || r.timescale <= 0)
+      continue;
+    TrackRecord rec;
+    rec.sample.time.value = r.value;
+    rec.sample.time.timescale = r.timescale;
+    rec.sample.confidence = r.confidence;
+    rec.sample.signature = r.signature;
+    std::memcpy(rec.sample.matrix.data(), r.matrix, sizeof(r.matrix));
+    std::memcpy(rec.roi, r.roi, sizeof(rec.roi));
+    out.push_back(rec);
+  }
+  ::munmap(map, size);
+  return true;
+}
+
+bool TrackFile::openForAppend() {
+  if (fd_ >= 0)
+    return true;
+  int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  FileHeader header;
+  bool valid = ::fstat(fd, &st) == 0 &&
+               (size_t)st.st_size >= sizeof(FileHeader) &&
+               ::pread(fd, &header, sizeof(header), 0) ==
+                   (ssize_t)sizeof(header) &&
+               headerMatches(header, sourceIdentity_);
+
+  if (valid) {
+    // Drop a record torn by a crash mid-append so the next one lines up.
+    size_t records = ((size_t)st.st_size - sizeof(FileHeader)) /
+                     sizeof(FileRecord);
+    valid = ::ftruncate(fd, (off_t)(sizeof(FileHeader) +
+                                    records * sizeof(FileRecord))) == 0;
+  } else {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kTrackMagic, sizeof(kTrackMagic));
+    header.version = kTrackVersion;
+    header.recordSize = sizeof(FileRecord);
+    header.sourceIdentity = sourceIdentity_;
+    valid = ::ftruncate(fd, 0) == 0 && writeAll(fd, &header, sizeof(header));
+  }
+
+  if (!valid) {
+    ::close(fd);
+    return false;
+  }
+  fd_ = fd;
+  return true;
+}
+
+bool TrackFile::append(const TrackRecord &record) {
+  FileRecord r = encode(record);
+  std::lock_guard<std::mutex> lock(mutex_);
+  return openForAppend() && writeAll(fd_, &r, sizeof(r));
+}
+
+bool TrackFile::append(const std::vector<TrackRecord> &records) {
+  if (records.empty())
+    return true;
+  std::vector<FileRecord> encoded;
+  encoded.reserve(records.size());
+  for (const TrackRecord &rec : records)
+    encoded.push_back(encode(rec));
+  std::lock_guard<std::mutex> lock(mutex_);
+  return openForAppend() &&
+         writeAll(fd_, encoded.data(), encoded.size() * sizeof(FileRecord));
+}
+
+void TrackFile::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  ::truncate(path_.c_str(), 0);
+}
+
+} // namespace gphyx
@@ -0,0 +1,59 @@
+#ifndef gPHYXTrackFile_h
+#define gPHYXTrackFile_h
+
+#include "gPHYXHash.h"
+#include "gPHYXHomographyStore.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gphyx {
+
+// One tracked frame as persisted: the sample plus the ROI it was tracked
+// with (normalized x, y, width, height).
+struct TrackRecord {
+  HomographySample sample;
+  float roi[4] = {0, 0, 1, 1};
+};
+
+// Append-only binary sidecar holding an instance's tracked homographies, so
+// analysis survives the plugin service being restarted. A fixed header ties
+// the file to its source media; fixed-size, checksummed records follow in
+// the order they were tracked, later records for a time replacing earlier
+// ones. Native byte order.
+class TrackFile {
+public:
+  // `sourceIdentity` names the media the track belongs to; a file written
+  // for other media is ignored on load and restarted on the next append.
+  TrackFile(std::string path, uint64_t sourceIdentity);
+  ~TrackFile();
+
+  TrackFile(const TrackFile &) = delete;
+  TrackFile &operator=(const TrackFile &) = delete;
+
+  const std::string &path() const { return path_; }
+  uint64_t sourceIdentity() const { return sourceIdentity_; }
+
+  // Maps the file read-only and decodes its records. Torn or corrupt
+  // records are skipped. False if the file is missing or foreign.
+  bool load(std::vector<TrackRecord> &out) const;
+
+  bool append(const TrackRecord &record);
+  bool append(const std::vector<TrackRecord> &records);
+
+  // Drops all records (the header is rewritten on the next append).
+  void reset();
+
+private:
+  bool openForAppend();
+
+  std::string path_;
+  uint64_t sourceIdentity_;
+  std::mutex mutex_;
+  int fd_ = -1;
+};
+
+} // namespace gphyx
+
+#endif
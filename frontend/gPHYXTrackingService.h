@@ -0,0 +1,43 @@
+#ifndef gPHYXTrackingService_h
+#define gPHYXTrackingService_h
+
+#import <CoreMedia/CoreMedia.h>
+#import <CoreVideo/CoreVideo.h>
+#import <Foundation/Foundation.h>
+
+// Called on a worker thread with the column-major 3x3 homography and the
+// registration confidence (0..1).
+typedef void (^gPHYXTrackingCompletion)(const float *homography,
+                                        float confidence);
+
+// Process-wide background registration. Renders queue frames that miss the
+// homography cache and carry on with an estimate; workers run the Vision
+// registration and hand results back through the completion block.
+@interface gPHYXTrackingService : NSObject
+
++ (instancetype)sharedService;
+
+// Queues `frame` (which must be a copy the caller no longer touches) for
+// registration against `reference`. Jobs are keyed by instance and time, so
+// asking twice for the same frame is a no-op. Returns NO if not queued.
+- (BOOL)enqueueFrame:(CVPixelBufferRef)frame
+           reference:(CVPixelBufferRef)reference
+                 roi:(CGRect)roi
+          instanceID:(NSString *)instanceID
+                time:(CMTime)time
+          completion:(gPHYXTrackingCompletion)completion;
+
+// YES while a job for this frame is queued or running.
+- (BOOL)hasJobForInstanceID:(NSString *)instanceID time:(CMTime)time;
+
+// Drops queued jobs of one instance and stops its running ones; no job
+// cancelled here calls its completion.
+- (void)cancelJobsForInstanceID:(NSString *)instanceID;
+// Same, sparing the job for `time` (the frame now under the playhead).
+- (void)cancelJobsForInstanceID:(NSString *)instanceID exceptTime:(CMTime)time;
+
+- (NSUInteger)pendingJobCount;
+
+@end
+
+#endif
@@ -0,0 +1,224 @@
+#import "gPHYXTrackingService.h"
+#import "gPHYXCancel.h"
+#import "gPHYXFillXPC-Swift.h"
+#import <os/lock.h>
+
+// Registration of one 4K frame takes long enough that more than a couple of
+// workers only fight over the GPU.
+static const NSUInteger kMaxTrackingWorkers = 2;
+// Each queued job holds a full-resolution frame copy. When the playhead moves
+// faster than the workers, the oldest frames are the least useful.
+static const NSUInteger kMaxPendingJobs = 6;
+
+@interface gPHYXTrackingJob : NSObject
+@property(nonatomic, copy) NSString *key;
+@property(nonatomic, copy) NSString *instanceID;
+@property(nonatomic, assign) CGRect roi;
+@property(nonatomic, copy) gPHYXTrackingCompletion completion;
+@property(nonatomic, assign) CVPixelBufferRef frame;     // retained
+@property(nonatomic, assign) CVPixelBufferRef reference; // retained
+@property(nonatomic, assign) gphyx::CancelToken cancel;
+// The tracker running the job, so a cancel can stop its registration.
+@property(nonatomic, strong) gPHYXVisionTracker *tracker;
+@end
+
+@implementation gPHYXTrackingJob
+- (void)dealloc {
+  if (_frame)
+    CVPixelBufferRelease(_frame);
+  if (_reference)
+    CVPixelBufferRelease(_reference);
+}
+@end
+
+static NSString *JobKey(NSString *instanceID, CMTime time) {
+  return [NSString stringWithFormat:@"%@|%lld/%d", instanceID,
+                                    (long long)time.value, time.timescale];
+}
+
+@implementation gPHYXTrackingService {
+  os_unfair_lock _lock;
+  NSMutableArray<gPHYXTrackingJob *> *_pending; // oldest first
+  NSMutableSet<NSString *> *_activeKeys;        // pending + running
+  NSMutableArray<gPHYXTrackingJob *> *_running;
+  NSMutableArray<gPHYXVisionTracker *> *_idleTrackers;
+  NSUInteger _runningWorkers;
+  dispatch_queue_t _queue;
+}
+
++ (instancetype)sharedService {
+  static gPHYXTrackingService *service = nil;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    service = [[gPHYXTrackingService alloc] init];
+  });
+  return service;
+}
+
+- (instancetype)init {
+  if (self = [super init]) {
+    _lock = OS_UNFAIR_LOCK_INIT;
+    _pending = [NSMutableArray array];
+    _activeKeys = [NSMutableSet set];
+    _running = [NSMutableArray array];
+    _idleTrackers = [NSMutableArray array];
+    _queue = dispatch_queue_create(
+        "com.gphyx.tracking",
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT,
+                                                QOS_CLASS_USER_INITIATED, 0));
+  }
+  return self;
+}
+
+- (BOOL)enqueueFrame:(CVPixelBufferRef)frame
+           reference:(CVPixelBufferRef)reference
+                 roi:(CGRect)roi
+          instanceID:(NSString *)instanceID
+                time:(CMTime)time
+          completion:(gPHYXTrackingCompletion)completion {
+  if (!frame || !reference || !completion)
+    return NO;
+
+  gPHYXTrackingJob *job = [[gPHYXTrackingJob alloc] init];
+  job.key = JobKey(instanceID, time);
+  job.instanceID = instanceID;
+  job.roi = roi;
+  job.completion = completion;
+  job.frame = CVPixelBufferRetain(frame);
+  job.reference = CVPixelBufferRetain(reference);
+  job.cancel = gphyx::CancelToken::make();
+
+  gPHYXTrackingJob *dropped = nil;
+  BOOL startWorker = NO;
+  os_unfair_lock_lock(&_lock);
+  if ([_activeKeys containsObject:job.key]) {
+    os_unfair_lock_unlock(&_lock);
+    return NO;
+  }
+  if (_pending.count >= kMaxPendingJobs) {
+    dropped = _pending.firstObject;
+    [_pending removeObjectAtIndex:0];
+    [_activeKeys removeObject:dropped.key];
+  }
+  [_pending addObject:job];
+  [_activeKeys addObject:job.key];
+  if (_runningWorkers < kMaxTrackingWorkers) {
+    _runningWorkers++;
+    startWorker = YES;
+  }
+  os_unfair_lock_unlock(&_lock);
+
+  if (startWorker) {
+    dispatch_async(_queue, ^{
+      [self drainJobs];
+    });
+  }
+  if (dropped) {
+    // Its frame copy is released here, outside the lock.
+    NSLog(@"[gPHYX] ⏭️ Tracking queue full, dropped %@", dropped.key);
+  }
+  return YES;
+}
+
+- (void)drainJobs {
+  gPHYXVisionTracker *tracker = nil;
+  os_unfair_lock_lock(&_lock);
+  tracker = _idleTrackers.lastObject;
+  if (tracker)
+    [_idleTrackers removeLastObject];
+  os_unfair_lock_unlock(&_lock);
+  if (!tracker)
+    tracker = [[gPHYXVisionTracker alloc] init];
+
+  for (;;) {
+    gPHYXTrackingJob *job = nil;
+    os_unfair_lock_lock(&_lock);
+    // Newest first: that is the frame the playhead is on.
+    job = _pending.lastObject;
+    if (job) {
+      [_pending removeLastObject];
+      job.tracker = tracker;
+      [_running addObject:job];
+    } else {
+      _runningWorkers--;
+      [_idleTrackers addObject:tracker];
+    }
+    os_unfair_lock_unlock(&_lock);
+    if (!job)
+      return;
+
+    @autoreleasepool {
+      NSArray<NSNumber *> *result =
+          job.cancel.cancelled()
+              ? nil
+              : [tracker estimateHomographyWithConfidenceFrom:job.frame
+                                                           to:job.reference
+                                                          roi:job.roi];
+      // A cancelled registration is cut short and reports identity.
+      if (result.count == 10 && !job.cancel.cancelled()) {
+        float h[9];
+        for (int i = 0; i < 9; i++)
+          h[i] = [result[i] floatValue];
+        job.completion(h, [result[9] floatValue]);
+      }
+    }
+
+    os_unfair_lock_lock(&_lock);
+    [_running removeObject:job];
+    job.tracker = nil;
+    if (!job.cancel.cancelled())
+      [_activeKeys removeObject:job.key];
+    os_unfair_lock_unlock(&_lock);
+  }
+}
+
+- (BOOL)hasJobForInstanceID:(NSString *)instanceID time:(CMTime)time {
+  NSString *key = JobKey(instanceID, time);
+  os_unfair_lock_lock(&_lock);
+  BOOL active = [_activeKeys containsObject:key];
+  os_unfair_lock_unlock(&_lock);
+  return active;
+}
+
+- (void)cancelJobsForInstanceID:(NSString *)instanceID {
+  [self cancelJobsForInstanceID:instanceID exceptTime:kCMTimeInvalid];
+}
+
+- (void)cancelJobsForInstanceID:(NSString *)instanceID exceptTime:(CMTime)time {
+  NSString *spared = CMTIME_IS_VALID(time) ? JobKey(instanceID, time) : nil;
+  NSMutableArray<gPHYXTrackingJob *> *cancelled = [NSMutableArray array];
+  os_unfair_lock_lock(&_lock);
+  for (gPHYXTrackingJob *job in _pending) {
+    if ([job.instanceID isEqualToString:instanceID] &&
+        ![job.key isEqualToString:spared]) {
+      [cancelled addObject:job];
+      [_activeKeys removeObject:job.key];
+    }
+  }
+  [_pending removeObjectsInArray:cancelled];
+  for (gPHYXTrackingJob *job in _running) {
+    if ([job.instanceID isEqualToString:instanceID] &&
+        ![job.key isEqualToString:spared] && !job.cancel.cancelled()) {
+      job.cancel.cancel();
+      // Under the lock: the tracker can't have moved on to another job.
+      [job.tracker cancel];
+      // The frame may be queued again while the worker winds down.
+      [_activeKeys removeObject:job.key];
+      [cancelled addObject:job];
+    }
+  }
+  os_unfair_lock_unlock(&_lock);
+  if (cancelled.count > 0) {
+    NSLog(@"[gPHYX] 🛑 Cancelled %lu tracking jobs for %@",
+          (unsigned long)cancelled.count, instanceID);
+  }
+}
+
+- (NSUInteger)pendingJobCount {
+  os_unfair_lock_lock(&_lock);
+  NSUInteger count = _pending.count;
+  os_unfair_lock_unlock(&_lock);
+  return count;
+}
+
+@end
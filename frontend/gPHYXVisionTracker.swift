@@ -7,13 +7,27 @@ public class gPHYXVisionTracker: NSObject {
     
     private var sequenceHandler = VNSequenceRequestHandler()
     private var registrationHandler = VNSequenceRequestHandler()
+    // VNSequenceRequestHandler is not thread-safe; renders and analysis may
+    // call in concurrently.
+    private let lock = NSLock()
+    // Registration in flight, so cancel() can stop it from another thread.
+    private let requestLock = NSLock()
+    private var currentRequest: VNRequest?
     
     @objc public func reset() {
+        lock.lock()
+        defer { lock.unlock() }
         sequenceHandler = VNSequenceRequestHandler()
         registrationHandler = VNSequenceRequestHandler()
     }
     
     @objc public func estimateHomography(from sourceBuffer: CVPixelBuffer, to referenceBuffer: CVPixelBuffer, roi: CGRect) -> [Float] {
+        return Array(estimateHomographyWithConfidence(from: sourceBuffer, to: referenceBuffer, roi: roi).prefix(9))
+    }
+    
+    // Same as estimateHomography, with the observation confidence (0..1)
+    // appended as a tenth element. Failed registrations report identity at 0.
+    @objc public func estimateHomographyWithConfidence(from sourceBuffer: CVPixelBuffer, to referenceBuffer: CVPixelBuffer, roi: CGRect) -> [Float] {
         let request = VNHomographicImageRegistrationRequest(targetedCVPixelBuffer: referenceBuffer)
         
         // Apply MOCHA-style ROI (normalized 0..1)
@@ -22,6 +36,16 @@ public class gPHYXVisionTracker: NSObject {
             request.regionOfInterest = roi
         }
         
+        lock.lock()
+        defer { lock.unlock() }
+        requestLock.lock()
+        currentRequest = request
+        requestLock.unlock()
+        defer {
+            requestLock.lock()
+            currentRequest = nil
+            requestLock.unlock()
+        }
         do {
             try registrationHandler.perform([request], on: sourceBuffer)
             if let observation = request.results?.first as? VNImageHomographicAlignmentObservation {
@@ -30,12 +54,21 @@ public class gPHYXVisionTracker: NSObject {
                 return [
                     matrix.columns.0.x, matrix.columns.0.y, matrix.columns.0.z,
                     matrix.columns.1.x, matrix.columns.1.y, matrix.columns.1.z,
-                    matrix.columns.2.x, matrix.columns.2.y, matrix.columns.2.z
+                    matrix.columns.2.x, matrix.columns.2.y, matrix.columns.2.z,
+                    observation.confidence
                 ]
             }
         } catch {
             print("[gPHYX] Vision Registration Error: \(error)")
         }
-        return [1, 0, 0, 0, 1, 0, 0, 0, 1] // Identity
+        return [1, 0, 0, 0, 1, 0, 0, 0, 1, 0] // Identity
+    }
+
+    // Stops the registration in flight, if any; it then reports identity at
+    // confidence 0, which callers that cancelled must not publish.
+    @objc public func cancel() {
+        requestLock.lock()
+        defer { requestLock.unlock() }
+        currentRequest?.cancel()
     }
 }
@@ -46,6 +46,8 @@ pluginkit -r -i com.gphyx.FillEffect || true
 pluginkit -r -u 6DCCA884-B35D-47A3-8D8A-6AC095D895ED || true
 
 echo "=== 4. Building Project (Release) ==="
+# The Xcode project is generated from project.yml and not kept in git.
+xcodegen generate
 xcodebuild build -project gPHYXFill.xcodeproj -scheme gPHYXFill -configuration Release -derivedDataPath "$LOCAL_DERIVED_DATA"
 
 # The actual build product is named gPHYXFill.app
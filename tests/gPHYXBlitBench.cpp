@@ -0,0 +1,53 @@
+#include "gPHYXBlit.h"
+#include "gPHYXParallel.h"
+#include "gPHYXTest.h"
+#include <cstring>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+// Throughput of the fail-safe copy on a 4K frame: bytes read plus bytes
+// written per second, against a single memcpy of the same frame.
+namespace {
+
+const int32_t kWidth = 3840;
+const int32_t kHeight = 2160;
+const int kRuns = 10;
+
+void report(const char *name, const TestImage &dst, const TestImage &src,
+            double ms) {
+  const double bytes = (double)kWidth * kHeight *
+                       (bytesPerPixel(src.view.format) +
+                        bytesPerPixel(dst.view.format));
+  std::printf("%-28s %7.2f ms %7.2f GB/s\n", name, ms, bytes / ms * 1e-6);
+}
+
+void run(const char *name, PixelFormat from, PixelFormat to) {
+  TestImage src(kWidth, kHeight, from);
+  TestImage dst(kWidth, kHeight, to);
+  for (size_t i = 0; i < src.bytes.size(); i++)
+    src.bytes[i] = (uint8_t)(noise((uint32_t)i) & 0x3b); // finite halves
+  blitImage(dst.view, src.view); // fault the pages in
+  report(name, dst, src, bestMs(kRuns, [&] { blitImage(dst.view, src.view); }));
+}
+
+} // namespace
+
+int main() {
+  std::printf("4K frame, %u thread(s)\n", hardwareThreads());
+  {
+    TestImage src(kWidth, kHeight, PixelFormat::RGBA16F);
+    TestImage dst(kWidth, kHeight, PixelFormat::RGBA16F);
+    std::memcpy(dst.bytes.data(), src.bytes.data(), src.bytes.size());
+    report("memcpy RGBA16F", dst, src, bestMs(kRuns, [&] {
+             std::memcpy(dst.bytes.data(), src.bytes.data(),
+                         src.bytes.size());
+           }));
+  }
+  run("blit RGBA16F -> RGBA16F", PixelFormat::RGBA16F, PixelFormat::RGBA16F);
+  run("blit RGBA16F -> RGBA32F", PixelFormat::RGBA16F, PixelFormat::RGBA32F);
+  run("blit RGBA32F -> RGBA16F", PixelFormat::RGBA32F, PixelFormat::RGBA16F);
+  run("blit RGBA16F -> BGRA8", PixelFormat::RGBA16F, PixelFormat::BGRA8);
+  run("blit BGRA8 -> RGBA16F", PixelFormat::BGRA8, PixelFormat::RGBA16F);
+  return 0;
+}
@@ -0,0 +1,196 @@
+#include "gPHYXBlit.h"
+#include "gPHYXHalf.h"
+#include "gPHYXTest.h"
+#include <cstring>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+namespace {
+
+void fillNoise(TestImage &image, uint32_t seed) {
+  const size_t rowBytes =
+      (size_t)image.view.width * bytesPerPixel(image.view.format);
+  for (int32_t y = 0; y < image.view.height; y++) {
+    uint8_t *row = image.view.row(y);
+    for (size_t i = 0; i < rowBytes; i++)
+      row[i] = (uint8_t)noise(seed + (uint32_t)(y * rowBytes + i));
+  }
+}
+
+// Same format, both sides padded: pixels are copied, the padding is not.
+void testStride() {
+  TestImage src(37, 11, PixelFormat::BGRA8, 12);
+  TestImage dst(37, 11, PixelFormat::BGRA8, 20);
+  fillNoise(src, 1);
+  std::memset(dst.bytes.data(), 0xcd, dst.bytes.size());
+  GPHYX_CHECK(blitImage(dst.view, src.view));
+
+  bool pixels = true, padding = true;
+  for (int32_t y = 0; y < 11; y++) {
+    pixels &= std::memcmp(dst.view.row(y), src.view.row(y), 37 * 4) == 0;
+    for (size_t i = 37 * 4; i < dst.view.bytesPerRow; i++)
+      padding &= dst.view.row(y)[i] == 0xcd;
+  }
+  GPHYX_CHECK(pixels);
+  GPHYX_CHECK(padding);
+}
+
+// A tile placed at (5, 3) in image space takes the source pixels there; the
+// clip leaves the rest of the tile alone.
+void testTileOrigin() {
+  TestImage src(64, 32, PixelFormat::RGBA32F);
+  fillNoise(src, 2);
+  TestImage tile(16, 8, PixelFormat::RGBA32F, 0, 5, 3);
+  GPHYX_CHECK(blitImage(tile.view, src.view));
+  bool placed = true;
+  for (int32_t y = 0; y < 8; y++)
+    placed &= std::memcmp(tile.view.row(y), src.view.row(y + 3) + 5 * 16,
+                          16 * 16) == 0;
+  GPHYX_CHECK(placed);
+
+  // Source tile offset the other way, into a full-size destination.
+  TestImage srcTile(8, 4, PixelFormat::RGBA32F, 32, 40, 20);
+  fillNoise(srcTile, 3);
+  TestImage dst(64, 32, PixelFormat::RGBA32F);
+  GPHYX_CHECK(blitImage(dst.view, srcTile.view));
+  bool inside = true, outside = true;
+  for (int32_t y = 0; y < 32; y++)
+    for (int32_t x = 0; x < 64; x++) {
+      const uint8_t *d = dst.view.row(y) + (size_t)x * 16;
+      if (x >= 40 && x < 48 && y >= 20 && y < 24) {
+        inside &= std::memcmp(d, srcTile.view.row(y - 20) + (x - 40) * 16,
+                              16) == 0;
+      } else {
+        for (int i = 0; i < 16; i++)
+          outside &= d[i] == 0;
+      }
+    }
+  GPHYX_CHECK(inside);
+  GPHYX_CHECK(outside);
+
+  const PixelRect clip = makePixelRect(8, 4, 4, 2);
+  TestImage clipped(16, 8, PixelFormat::RGBA32F, 0, 5, 3);
+  GPHYX_CHECK(blitImage(clipped.view, src.view, &clip));
+  int written = 0;
+  for (int32_t y = 0; y < 8; y++)
+    for (int32_t x = 0; x < 16; x++) {
+      const uint8_t *d = clipped.view.row(y) + (size_t)x * 16;
+      bool zero = true;
+      for (int i = 0; i < 16; i++)
+        zero &= d[i] == 0;
+      written += zero ? 0 : 1;
+    }
+  GPHYX_CHECK(written == 4 * 2);
+
+  TestImage far(4, 4, PixelFormat::RGBA32F, 0, 1000, 1000);
+  GPHYX_CHECK(blitImage(far.view, src.view)); // disjoint: nothing to do
+}
+
+void testConversions() {
+  // BGRA8 -> RGBA32F: channels swapped, bytes scaled to [0, 1].
+  TestImage bgra(256, 1, PixelFormat::BGRA8);
+  for (int32_t x = 0; x < 256; x++) {
+    uint8_t *p = bgra.view.row(0) + x * 4;
+    p[0] = (uint8_t)x;         // B
+    p[1] = (uint8_t)(255 - x); // G
+    p[2] = (uint8_t)(x / 2);   // R
+    p[3] = 255;
+  }
+  TestImage rgba32(256, 1, PixelFormat::RGBA32F);
+  GPHYX_CHECK(blitImage(rgba32.view, bgra.view));
+  bool scaled = true;
+  const float *f = reinterpret_cast<const float *>(rgba32.view.row(0));
+  for (int32_t x = 0; x < 256; x++) {
+    scaled &= f[x * 4 + 0] == (float)(x / 2) * (1.0f / 255.0f);
+    scaled &= f[x * 4 + 1] == (float)(255 - x) * (1.0f / 255.0f);
+    scaled &= f[x * 4 + 2] == (float)x * (1.0f / 255.0f);
+    scaled &= f[x * 4 + 3] == 1.0f;
+  }
+  GPHYX_CHECK(scaled);
+
+  // And back, exactly.
+  TestImage back(256, 1, PixelFormat::BGRA8);
+  GPHYX_CHECK(blitImage(back.view, rgba32.view));
+  GPHYX_CHECK(back.bytes == bgra.bytes);
+
+  // RGBA32F -> RGBA16F: the scalar converter, value for value, including
+  // out-of-range and subnormal inputs.
+  const float values[] = {0.0f, -0.0f, 1.0f,   -2.5f,    0.1f,
+                          1e-6f, 7e4f, 65504.f, 1.0f / 3, 3e-8f};
+  const int32_t count = (int32_t)(sizeof(values) / sizeof(values[0]));
+  TestImage wide(count, 1, PixelFormat::RGBA32F);
+  float *w = reinterpret_cast<float *>(wide.view.row(0));
+  for (int32_t i = 0; i < count; i++)
+    for (int c = 0; c < 4; c++)
+      w[i * 4 + c] = values[(i + c) % count];
+  TestImage half(count, 1, PixelFormat::RGBA16F);
+  GPHYX_CHECK(blitImage(half.view, wide.view));
+  bool halves = true;
+  const uint16_t *h = reinterpret_cast<const uint16_t *>(half.view.row(0));
+  for (int32_t i = 0; i < count * 4; i++)
+    halves &= h[i] == floatToHalf(w[i]);
+  GPHYX_CHECK(halves);
+
+  // One pixel at a time, as the fill reads and writes them: the same.
+  bool pixels = true;
+  for (int32_t i = 0; i < count; i++) {
+    uint16_t p[4];
+    float f4[4];
+    floatToHalf4(w + i * 4, p);
+    halfToFloat4(h + i * 4, f4);
+    for (int c = 0; c < 4; c++)
+      pixels &= p[c] == h[i * 4 + c] && f4[c] == halfToFloat(h[i * 4 + c]);
+  }
+  GPHYX_CHECK(pixels);
+
+  // RGBA16F -> BGRA8: clamped to [0, 1], rounded to nearest.
+  TestImage narrow(count, 1, PixelFormat::BGRA8);
+  GPHYX_CHECK(blitImage(narrow.view, half.view));
+  bool clamped = true;
+  for (int32_t i = 0; i < count; i++) {
+    const uint8_t *p = narrow.view.row(0) + i * 4;
+    const int order[4] = {2, 1, 0, 3}; // BGRA from RGBA
+    for (int c = 0; c < 4; c++) {
+      float v = halfToFloat(h[i * 4 + order[c]]);
+      v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+      clamped &= p[c] == (uint8_t)(v * 255.0f + 0.5f);
+    }
+  }
+  GPHYX_CHECK(clamped);
+}
+
+// Enough rows to be split across cores; every row lands once.
+void testParallelRows() {
+  TestImage src(1024, 600, PixelFormat::RGBA16F, 64);
+  fillNoise(src, 4);
+  TestImage dst(1024, 600, PixelFormat::RGBA16F);
+  GPHYX_CHECK(blitImage(dst.view, src.view));
+  bool rows = true;
+  for (int32_t y = 0; y < 600; y++)
+    rows &= std::memcmp(dst.view.row(y), src.view.row(y), 1024 * 8) == 0;
+  GPHYX_CHECK(rows);
+}
+
+void testInvalid() {
+  TestImage ok(4, 4, PixelFormat::BGRA8);
+  ImageView unknown = ok.view;
+  unknown.format = PixelFormat::Unknown;
+  ImageView shortRows = ok.view;
+  shortRows.bytesPerRow = 8;
+  GPHYX_CHECK(!blitImage(ok.view, unknown));
+  GPHYX_CHECK(!blitImage(unknown, ok.view));
+  GPHYX_CHECK(!blitImage(ok.view, shortRows));
+  GPHYX_CHECK(!blitImage(ok.view, ImageView()));
+}
+
+} // namespace
+
+int main() {
+  testStride();
+  testTileOrigin();
+  testConversions();
+  testParallelRows();
+  testInvalid();
+  return finish("gPHYXBlitTest");
+}
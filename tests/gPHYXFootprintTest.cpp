@@ -0,0 +1,210 @@
+#include "gPHYXFootprint.h"
+#include "gPHYXTest.h"
+#include <cmath>
+#include <cstring>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+namespace {
+
+const float kIdentity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+bool sameRect(const PixelRect &a, const PixelRect &b) {
+  return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+bool contains(const PixelRect &outer, const PixelRect &inner) {
+  return inner.empty() || (outer.x0 <= inner.x0 && outer.y0 <= inner.y0 &&
+                           outer.x1 >= inner.x1 && outer.y1 >= inner.y1);
+}
+
+// The footprint allows for float rounding in the kernels, which can cost a
+// pixel on the low side of an exact integer warp; never more.
+bool tight(const PixelRect &footprint, const PixelRect &expected) {
+  return contains(footprint, expected) && footprint.x0 >= expected.x0 - 1 &&
+         footprint.y0 >= expected.y0 - 1 && footprint.x1 == expected.x1 &&
+         footprint.y1 == expected.y1;
+}
+
+void rotation(float degrees, float cx, float cy, float *h) {
+  const float a = degrees * 3.14159265f / 180.0f;
+  const float c = std::cos(a), s = std::sin(a);
+  const float m[9] = {c, s, 0, -s, c, 0, cx - c * cx + s * cy,
+                      cy - s * cx - c * cy, 1};
+  std::memcpy(h, m, sizeof(m));
+}
+
+void testSamplerMargins() {
+  GPHYX_CHECK(samplingRadius(SampleMode::Nearest) == 0);
+  GPHYX_CHECK(samplingRadius(SampleMode::Bilinear) == 1);
+  GPHYX_CHECK(samplingRadius(SampleMode::Bicubic) == 2);
+}
+
+// Identity: the part of the tile inside the mask, grown by the filter's
+// radius and clipped to the reference.
+void testIdentity() {
+  const PixelRect ref = makePixelRect(0, 0, 1920, 1080);
+  const PixelRect tile = makePixelRect(256, 256, 256, 256);
+  const PixelRect mask = makePixelRect(300, 200, 100, 400);
+  const PixelRect filled = intersectRects(tile, mask);
+  for (SampleMode mode :
+       {SampleMode::Nearest, SampleMode::Bilinear, SampleMode::Bicubic}) {
+    const int32_t r = samplingRadius(mode);
+    const PixelRect expected = makePixelRect(
+        filled.x0 - r, filled.y0 - r, filled.width() + 2 * r,
+        filled.height() + 2 * r);
+    GPHYX_CHECK(
+        tight(referenceFootprint(tile, mask, kIdentity, mode, ref), expected));
+  }
+
+  // At the reference's corner the margin is clipped away.
+  const PixelRect corner = makePixelRect(0, 0, 64, 64);
+  GPHYX_CHECK(sameRect(referenceFootprint(corner, corner, kIdentity,
+                                          SampleMode::Bicubic, ref),
+                       makePixelRect(0, 0, 66, 66)));
+
+  // A tile that misses the mask reads nothing.
+  GPHYX_CHECK(referenceFootprint(makePixelRect(0, 0, 64, 64), mask, kIdentity,
+                                 SampleMode::Bicubic, ref)
+                  .empty());
+
+  // Translation moves the footprint with it.
+  float shifted[9];
+  std::memcpy(shifted, kIdentity, sizeof(shifted));
+  shifted[6] = 10.0f;
+  shifted[7] = -20.0f;
+  GPHYX_CHECK(
+      tight(referenceFootprint(tile, mask, shifted, SampleMode::Nearest, ref),
+            makePixelRect(filled.x0 + 10, filled.y0 - 20, filled.width(),
+                          filled.height())));
+}
+
+// Rotated: every pixel a filter reads is inside the footprint, and the
+// footprint is no bigger than the hull of those reads needs.
+void testRotation() {
+  const PixelRect ref = makePixelRect(0, 0, 640, 480);
+  const PixelRect tile = makePixelRect(200, 150, 128, 96);
+  for (float degrees : {5.0f, 30.0f, 90.0f, 135.0f}) {
+    float h[9];
+    rotation(degrees, 320.0f, 240.0f, h);
+    for (SampleMode mode :
+         {SampleMode::Nearest, SampleMode::Bilinear, SampleMode::Bicubic}) {
+      const PixelRect footprint =
+          referenceFootprint(tile, tile, h, mode, ref);
+      const int32_t r = samplingRadius(mode);
+      PixelRect reads;
+      for (int32_t y = tile.y0; y < tile.y1; y++)
+        for (int32_t x = tile.x0; x < tile.x1; x++) {
+          const float fx = (float)x, fy = (float)y;
+          const float z = h[2] * fx + h[5] * fy + h[8];
+          const float mx = (h[0] * fx + h[3] * fy + h[6]) / z;
+          const float my = (h[1] * fx + h[4] * fy + h[7]) / z;
+          const int32_t px = (int32_t)std::floor(mx);
+          const int32_t py = (int32_t)std::floor(my);
+          reads = unionRects(reads, intersectRects(
+                                        makePixelRect(px - r, py - r,
+                                                      2 * r + 1, 2 * r + 1),
+                                        ref));
+        }
+      GPHYX_CHECK(contains(footprint, reads));
+      GPHYX_CHECK(footprint.width() <= reads.width() + 2);
+      GPHYX_CHECK(footprint.height() <= reads.height() + 2);
+    }
+  }
+}
+
+// Perspective with w <= 0 over part of the tile has no bounded image: the
+// whole reference is needed.
+void testDegenerate() {
+  const PixelRect ref = makePixelRect(0, 0, 640, 480);
+  const PixelRect tile = makePixelRect(0, 0, 64, 64);
+  float h[9];
+  std::memcpy(h, kIdentity, sizeof(h));
+  h[2] = -0.02f; // w = 1 - 0.02 x: zero at x = 50, negative beyond
+  GPHYX_CHECK(sameRect(
+      referenceFootprint(tile, tile, h, SampleMode::Nearest, ref), ref));
+
+  h[2] = 0.0f;
+  h[8] = 0.0f; // w == 0 everywhere
+  GPHYX_CHECK(sameRect(warpedFootprint(tile, h, 0, ref), ref));
+
+  h[8] = -1.0f; // w < 0 everywhere
+  GPHYX_CHECK(sameRect(warpedFootprint(tile, h, 0, ref), ref));
+
+  const float nan = std::nanf("");
+  const float bad[9] = {nan, 0, 0, 0, 1, 0, 0, 0, 1};
+  GPHYX_CHECK(sameRect(warpedFootprint(tile, bad, 0, ref), ref));
+
+  // Empty inputs stay empty.
+  GPHYX_CHECK(warpedFootprint(PixelRect(), kIdentity, 2, ref).empty());
+  GPHYX_CHECK(warpedFootprint(tile, kIdentity, 2, PixelRect()).empty());
+
+  // Far off the reference: nothing to read, and no int32 overflow.
+  float far[9];
+  std::memcpy(far, kIdentity, sizeof(far));
+  far[6] = 1e12f;
+  GPHYX_CHECK(warpedFootprint(tile, far, 2, ref).empty());
+}
+
+// End to end: filling from only the footprint of the reference gives the
+// same pixels as filling from all of it.
+void testFillFromFootprint() {
+  const int32_t width = 256, height = 192;
+  const PixelFormat format = PixelFormat::RGBA32F;
+  const size_t bpp = bytesPerPixel(format);
+  TestImage source(width, height, format);
+  TestImage reference(width, height, format);
+  for (size_t i = 0; i < reference.bytes.size() / 4; i++) {
+    const float v = (float)(noise((uint32_t)i) & 255) / 255.0f;
+    std::memcpy(reference.bytes.data() + i * 4, &v, 4);
+  }
+  const PixelRect region = makePixelRect(40, 30, 150, 120);
+  const PixelRect tile = makePixelRect(64, 64, 64, 64);
+  const PixelRect filled = intersectRects(tile, region);
+  std::vector<uint8_t> mask((size_t)filled.area(), 255);
+
+  for (SampleMode mode :
+       {SampleMode::Nearest, SampleMode::Bilinear, SampleMode::Bicubic}) {
+    float h[9];
+    rotation(23.0f, width / 2.0f, height / 2.0f, h);
+    const PixelRect footprint =
+        referenceFootprint(tile, region, h, mode, reference.view.imageRect());
+    TestImage crop(footprint.width(), footprint.height(), format, 0,
+                   footprint.x0, footprint.y0);
+    for (int32_t y = 0; y < footprint.height(); y++)
+      std::memcpy(crop.view.row(y),
+                  reference.view.row(y + footprint.y0) + footprint.x0 * bpp,
+                  (size_t)footprint.width() * bpp);
+
+    TestImage full(width, height, format), cropped(width, height, format);
+    InpaintJob job;
+    std::memcpy(job.homography, h, sizeof(h));
+    job.sampling = mode;
+    job.source = source.view;
+    job.mask.data = mask.data();
+    job.mask.bytesPerRow = (size_t)filled.width();
+    job.mask.width = filled.width();
+    job.mask.height = filled.height();
+    job.region = filled;
+    job.destination = full.view;
+    job.reference = reference.view;
+    GPHYX_CHECK(inpaintCPU(job));
+    job.destination = cropped.view;
+    job.reference = crop.view;
+    GPHYX_CHECK(inpaintCPU(job));
+    GPHYX_CHECK(full.bytes != source.bytes);
+    GPHYX_CHECK(full.bytes == cropped.bytes);
+  }
+}
+
+} // namespace
+
+int main() {
+  testSamplerMargins();
+  testIdentity();
+  testRotation();
+  testDegenerate();
+  testFillFromFootprint();
+  return finish("gPHYXFootprintTest");
+}
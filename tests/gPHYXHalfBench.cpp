@@ -0,0 +1,68 @@
+#include "gPHYXHalf.h"
+#include "gPHYXTest.h"
+#include <cmath>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+// Bandwidth of the row converters on the halves of one 4K RGBA16F frame,
+// single-threaded: bytes read plus bytes written per second, against the
+// scalar functions they replace, and of the per-pixel converters the fill
+// reads and writes single pixels with. The outputs are compared as well.
+namespace {
+
+const size_t kCount = (size_t)3840 * 2160 * 4;
+const int kRuns = 10;
+
+void report(const char *name, double ms) {
+  const double bytes = (double)kCount * (sizeof(uint16_t) + sizeof(float));
+  std::printf("%-24s %7.2f ms %7.2f GB/s\n", name, ms, bytes / ms * 1e-6);
+}
+
+} // namespace
+
+int main() {
+  std::vector<uint16_t> halves(kCount), back(kCount);
+  std::vector<float> floats(kCount), expected(kCount);
+  for (size_t i = 0; i < kCount; i++)
+    halves[i] = (uint16_t)(noise((uint32_t)i) & 0x3bff); // finite, <= 1
+  halfToFloatRow(halves.data(), floats.data(), kCount); // fault the pages in
+  floatToHalfRow(floats.data(), back.data(), kCount);
+
+  std::printf("4K RGBA16F frame, %zu halves\n", kCount);
+  report("halfToFloat (scalar)", bestMs(kRuns, [&] {
+           for (size_t i = 0; i < kCount; i++)
+             expected[i] = halfToFloat(halves[i]);
+         }));
+  report("halfToFloatRow", bestMs(kRuns, [&] {
+           halfToFloatRow(halves.data(), floats.data(), kCount);
+         }));
+  std::vector<float> perPixel(kCount);
+  report("halfToFloat4", bestMs(kRuns, [&] {
+           for (size_t i = 0; i < kCount; i += 4)
+             halfToFloat4(&halves[i], &perPixel[i]);
+         }));
+  const bool widened = floats == expected && perPixel == expected;
+
+  std::vector<uint16_t> narrowed(kCount);
+  report("floatToHalf (scalar)", bestMs(kRuns, [&] {
+           for (size_t i = 0; i < kCount; i++)
+             narrowed[i] = floatToHalf(floats[i]);
+         }));
+  report("floatToHalfRow", bestMs(kRuns, [&] {
+           floatToHalfRow(floats.data(), back.data(), kCount);
+         }));
+  std::vector<uint16_t> pixelHalves(kCount);
+  report("floatToHalf4", bestMs(kRuns, [&] {
+           for (size_t i = 0; i < kCount; i += 4)
+             floatToHalf4(&floats[i], &pixelHalves[i]);
+         }));
+  const bool roundTrip =
+      back == narrowed && back == halves && pixelHalves == narrowed;
+
+  if (!widened || !roundTrip) {
+    std::fprintf(stderr, "vector conversions differ from the scalar ones\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,468 @@
+#include "gPHYXHalf.h"
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXTest.h"
+#include "gPHYXTiledImage.h"
+#include <cmath>
+#include <cstring>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+// The scalar fill below must round like the kernels: no fused mul+add.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+namespace {
+
+const PixelFormat kFormats[] = {PixelFormat::BGRA8, PixelFormat::RGBA16F,
+                                PixelFormat::RGBA32F};
+const SampleMode kModes[] = {SampleMode::Nearest, SampleMode::Bilinear,
+                             SampleMode::Bicubic};
+
+// Finite, in-range values in every format.
+void fillPixels(TestImage &image, uint32_t seed) {
+  for (int32_t y = 0; y < image.view.height; y++)
+    for (int32_t x = 0; x < image.view.width; x++) {
+      uint8_t *p =
+          image.view.row(y) + (size_t)x * bytesPerPixel(image.view.format);
+      for (int c = 0; c < 4; c++) {
+        const float v =
+            (float)(noise(seed + (uint32_t)((y * 4096 + x) * 4 + c)) & 1023) /
+            1023.0f;
+        switch (image.view.format) {
+        case PixelFormat::BGRA8:
+          p[c] = (uint8_t)(v * 255.0f);
+          break;
+        case PixelFormat::RGBA16F: {
+          const uint16_t h = floatToHalf(v);
+          std::memcpy(p + 2 * c, &h, 2);
+          break;
+        }
+        default:
+          std::memcpy(p + 4 * c, &v, 4);
+          break;
+        }
+      }
+    }
+}
+
+// An ellipse over most of the region: full, partial and empty tiles.
+std::vector<uint8_t> ellipseMask(int32_t width, int32_t height) {
+  std::vector<uint8_t> mask((size_t)width * height);
+  for (int32_t y = 0; y < height; y++)
+    for (int32_t x = 0; x < width; x++) {
+      const float dx = (x + 0.5f - width * 0.5f) / (width * 0.4f);
+      const float dy = (y + 0.5f - height * 0.5f) / (height * 0.4f);
+      mask[(size_t)y * width + x] = dx * dx + dy * dy <= 1.0f ? 255 : 0;
+    }
+  return mask;
+}
+
+// Column-major homographies (destination -> reference): a shift, a rotation
+// about the image centre and a mild perspective.
+void makeHomography(int kind, float cx, float cy, float *h) {
+  const float identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  std::memcpy(h, identity, sizeof(identity));
+  switch (kind) {
+  case 0:
+    h[6] = 3.25f;
+    h[7] = -1.5f;
+    break;
+  case 1: {
+    const float a = 17.0f * 3.14159265f / 180.0f;
+    const float c = std::cos(a), s = std::sin(a);
+    h[0] = c;
+    h[1] = s;
+    h[3] = -s;
+    h[4] = c;
+    h[6] = cx - c * cx + s * cy;
+    h[7] = cy - s * cx - c * cy;
+    break;
+  }
+  default:
+    h[0] = 1.05f;
+    h[1] = 0.02f;
+    h[2] = 0.0004f;
+    h[3] = -0.03f;
+    h[4] = 0.97f;
+    h[5] = -0.0002f;
+    h[6] = -4.0f;
+    h[7] = 6.0f;
+    break;
+  }
+}
+
+struct Scene {
+  static const int32_t kWidth = 160;
+  static const int32_t kHeight = 96;
+  TestImage source, reference;
+  std::vector<uint8_t> mask;
+  MaskTiles tiles;
+  PixelRect region;
+
+  Scene(PixelFormat format)
+      : source(kWidth, kHeight, format, 16),
+        reference(kWidth + 24, kHeight + 10, format, 8, -12, -5) {
+    fillPixels(source, 10);
+    fillPixels(reference, 20);
+    region = makePixelRect(13, 7, 130, 75);
+    mask = ellipseMask(region.width(), region.height());
+    tiles = classifyMaskTiles(mask.data(), (size_t)region.width(),
+                              region.width(), region.height());
+  }
+
+  // Destination starts as the source, as the render's passthrough copy
+  // leaves it.
+  void run(InpaintJob job, TestImage &out) const {
+    std::memcpy(out.bytes.data(), source.bytes.data(), source.bytes.size());
+    job.source = source.view;
+    job.destination = out.view;
+    job.reference = reference.view;
+    job.mask.data = mask.data();
+    job.mask.bytesPerRow = (size_t)region.width();
+    job.mask.width = region.width();
+    job.mask.height = region.height();
+    job.region = region;
+    GPHYX_CHECK(inpaintCPU(job));
+  }
+};
+
+// A plain per-pixel fill written from the kernel's definition, sharing no
+// code with the lane passes: decode the taps, filter, encode.
+float clampUnit(float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); }
+
+void decodePixel(const ImageView &view, int32_t x, int32_t y, float *rgba) {
+  x = x < 0 ? 0 : (x >= view.width ? view.width - 1 : x);
+  y = y < 0 ? 0 : (y >= view.height ? view.height - 1 : y);
+  const uint8_t *p = view.row(y) + (size_t)x * bytesPerPixel(view.format);
+  switch (view.format) {
+  case PixelFormat::BGRA8:
+    rgba[0] = p[2] * (1.0f / 255.0f);
+    rgba[1] = p[1] * (1.0f / 255.0f);
+    rgba[2] = p[0] * (1.0f / 255.0f);
+    rgba[3] = p[3] * (1.0f / 255.0f);
+    break;
+  case PixelFormat::RGBA16F:
+    for (int c = 0; c < 4; c++) {
+      uint16_t h;
+      std::memcpy(&h, p + 2 * c, 2);
+      rgba[c] = halfToFloat(h);
+    }
+    break;
+  default:
+    std::memcpy(rgba, p, 16);
+    break;
+  }
+}
+
+void encodePixel(PixelFormat format, const float *rgba, uint8_t *p) {
+  switch (format) {
+  case PixelFormat::BGRA8: {
+    const int order[4] = {2, 1, 0, 3};
+    for (int c = 0; c < 4; c++)
+      p[c] = (uint8_t)(clampUnit(rgba[order[c]]) * 255.0f + 0.5f);
+    break;
+  }
+  case PixelFormat::RGBA16F:
+    for (int c = 0; c < 4; c++) {
+      const uint16_t h = floatToHalf(rgba[c]);
+      std::memcpy(p + 2 * c, &h, 2);
+    }
+    break;
+  default:
+    std::memcpy(p, rgba, 16);
+    break;
+  }
+}
+
+void cubicWeights(float t, float *w) {
+  w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+  w[1] = (1.5f * t - 2.5f) * t * t + 1.0f;
+  w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+  w[3] = (0.5f * t - 0.5f) * t * t;
+}
+
+void samplePixel(const ImageView &ref, SampleMode mode, float mx, float my,
+                 float *out) {
+  if (mode == SampleMode::Nearest) {
+    decodePixel(ref, (int32_t)mx, (int32_t)my, out);
+    return;
+  }
+  const float u = mx - 0.5f, v = my - 0.5f;
+  const float x0f = std::floor(u), y0f = std::floor(v);
+  const int32_t x0 = (int32_t)x0f, y0 = (int32_t)y0f;
+  const float tx = u - x0f, ty = v - y0f;
+  if (mode == SampleMode::Bilinear) {
+    float a[4], b[4], c[4], d[4];
+    decodePixel(ref, x0, y0, a);
+    decodePixel(ref, x0 + 1, y0, b);
+    decodePixel(ref, x0, y0 + 1, c);
+    decodePixel(ref, x0 + 1, y0 + 1, d);
+    for (int ch = 0; ch < 4; ch++) {
+      const float top = a[ch] + (b[ch] - a[ch]) * tx;
+      const float bottom = c[ch] + (d[ch] - c[ch]) * tx;
+      out[ch] = top + (bottom - top) * ty;
+    }
+    return;
+  }
+  float wx[4], wy[4];
+  cubicWeights(tx, wx);
+  cubicWeights(ty, wy);
+  for (int ch = 0; ch < 4; ch++)
+    out[ch] = 0.0f;
+  for (int j = 0; j < 4; j++) {
+    float row[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 4; i++) {
+      float tap[4];
+      decodePixel(ref, x0 - 1 + i, y0 - 1 + j, tap);
+      for (int ch = 0; ch < 4; ch++)
+        row[ch] = row[ch] + tap[ch] * wx[i];
+    }
+    for (int ch = 0; ch < 4; ch++)
+      out[ch] = out[ch] + row[ch] * wy[j];
+  }
+}
+
+// Where region pixel (lx, ly) samples the reference, in its view; false if
+// the mask is off there or the warp misses.
+bool scalarWarp(const InpaintJob &job, int32_t lx, int32_t ly, float *mx,
+                float *my) {
+  if (job.mask.data[(size_t)ly * job.mask.bytesPerRow + lx] <= 127)
+    return false;
+  const int32_t step = job.coarseStep;
+  const PixelRect &r = job.region;
+  const float fx = (float)(step > 1 ? r.x0 + lx / step * step + step / 2
+                                    : r.x0 + lx);
+  const float fy = (float)(step > 1 ? r.y0 + ly / step * step + step / 2
+                                    : r.y0 + ly);
+  const float *h = job.homography;
+  const float z = h[2] * fx + h[5] * fy + h[8];
+  *mx = (h[0] * fx + h[3] * fy + h[6]) / z - (float)job.reference.originX;
+  *my = (h[1] * fx + h[4] * fy + h[7]) / z - (float)job.reference.originY;
+  return *mx >= 0.0f && *mx < (float)job.reference.width && *my >= 0.0f &&
+         *my < (float)job.reference.height;
+}
+
+// job.destination must already hold the source.
+void scalarFill(const InpaintJob &job) {
+  const PixelRect &r = job.region;
+  const ImageView &dst = job.destination;
+  for (int32_t ly = 0; ly < r.height(); ly++)
+    for (int32_t lx = 0; lx < r.width(); lx++) {
+      float mx, my, rgba[4];
+      if (!scalarWarp(job, lx, ly, &mx, &my))
+        continue;
+      samplePixel(job.reference, job.sampling, mx, my, rgba);
+      encodePixel(dst.format, rgba,
+                  dst.row(r.y0 + ly - dst.originY) +
+                      (size_t)(r.x0 + lx - dst.originX) *
+                          bytesPerPixel(dst.format));
+    }
+}
+
+const int32_t kLaneCounts[] = {1, 4, 8};
+
+// Every lane width against the scalar fill, byte for byte, over every format,
+// filter and warp: plain, with tile occupancy, in coarse blocks and from a
+// blocked copy of the reference.
+void testLanesMatchScalar() {
+  for (PixelFormat format : kFormats) {
+    Scene scene(format);
+    TiledImage blocks;
+    GPHYX_CHECK(tileImage(scene.reference.view, blocks));
+    TestImage lanes(Scene::kWidth, Scene::kHeight, format, 16);
+    TestImage scalar(Scene::kWidth, Scene::kHeight, format, 16);
+    for (SampleMode mode : kModes)
+      for (int kind = 0; kind < 3; kind++)
+        for (int variant = 0; variant < 4; variant++) {
+          InpaintJob job;
+          makeHomography(kind, Scene::kWidth / 2.0f, Scene::kHeight / 2.0f,
+                         job.homography);
+          job.sampling = mode;
+          job.mask.tiles = variant == 1 ? &scene.tiles : nullptr;
+          job.coarseStep = variant == 2 ? 4 : 1;
+          job.tiledReference = variant == 3 ? &blocks : nullptr;
+          std::memcpy(scalar.bytes.data(), scene.source.bytes.data(),
+                      scene.source.bytes.size());
+          InpaintJob plain = job;
+          plain.destination = scalar.view;
+          plain.reference = scene.reference.view;
+          plain.mask.data = scene.mask.data();
+          plain.mask.bytesPerRow = (size_t)scene.region.width();
+          plain.region = scene.region;
+          scalarFill(plain);
+          for (int32_t count : kLaneCounts) {
+            job.maxLanes = count;
+            scene.run(job, lanes);
+            const bool same = lanes.bytes == scalar.bytes;
+            GPHYX_CHECK(same);
+            if (!same)
+              std::fprintf(stderr,
+                           "  format %u mode %u warp %d variant %d lanes %d\n",
+                           (unsigned)format, (unsigned)mode, kind, variant,
+                           inpaintLaneCount(count));
+          }
+        }
+  }
+}
+
+// inpaintCoverage at every lane width marks what the scalar warp replaces.
+void testCoverageMatchesScalar() {
+  Scene scene(PixelFormat::BGRA8);
+  const PixelRect &r = scene.region;
+  for (int kind = 0; kind < 3; kind++)
+    for (int variant = 0; variant < 2; variant++) {
+      InpaintJob job;
+      makeHomography(kind, Scene::kWidth / 2.0f, Scene::kHeight / 2.0f,
+                     job.homography);
+      job.reference = scene.reference.view;
+      job.mask.data = scene.mask.data();
+      job.mask.bytesPerRow = (size_t)r.width();
+      job.mask.width = r.width();
+      job.mask.height = r.height();
+      job.mask.tiles = variant == 1 ? &scene.tiles : nullptr;
+      job.region = r;
+      std::vector<uint8_t> expected(r.area());
+      for (int32_t ly = 0; ly < r.height(); ly++)
+        for (int32_t lx = 0; lx < r.width(); lx++) {
+          float mx, my;
+          expected[(size_t)ly * r.width() + lx] =
+              scalarWarp(job, lx, ly, &mx, &my) ? 255 : 0;
+        }
+      for (int32_t count : kLaneCounts) {
+        job.maxLanes = count;
+        std::vector<uint8_t> coverage(r.area(), 7);
+        GPHYX_CHECK(inpaintCoverage(job, coverage.data(), (size_t)r.width()));
+        GPHYX_CHECK(coverage == expected);
+      }
+    }
+}
+
+// Nearest sampling worked out independently: reference pixel under the
+// truncated warp inside the mask, the source everywhere else.
+void testNearestAgainstDirect() {
+  const PixelFormat format = PixelFormat::RGBA16F;
+  Scene scene(format);
+  TestImage out(Scene::kWidth, Scene::kHeight, format, 16);
+  InpaintJob job;
+  makeHomography(1, Scene::kWidth / 2.0f, Scene::kHeight / 2.0f,
+                 job.homography);
+  job.mask.tiles = &scene.tiles;
+  scene.run(job, out);
+
+  const float *h = job.homography;
+  const ImageView &ref = scene.reference.view;
+  bool ok = true;
+  int replaced = 0;
+  for (int32_t y = 0; y < Scene::kHeight; y++)
+    for (int32_t x = 0; x < Scene::kWidth; x++) {
+      const uint8_t *expected = scene.source.view.row(y) + (size_t)x * 8;
+      if (x >= scene.region.x0 && x < scene.region.x1 &&
+          y >= scene.region.y0 && y < scene.region.y1 &&
+          scene.mask[(size_t)(y - scene.region.y0) * scene.region.width() +
+                     (x - scene.region.x0)] > 127) {
+        const float fx = (float)x, fy = (float)y;
+        const float z = h[2] * fx + h[5] * fy + h[8];
+        const float mx = (h[0] * fx + h[3] * fy + h[6]) / z - ref.originX;
+        const float my = (h[1] * fx + h[4] * fy + h[7]) / z - ref.originY;
+        if (mx >= 0 && mx < ref.width && my >= 0 && my < ref.height) {
+          expected = ref.row((int32_t)my) + (size_t)(int32_t)mx * 8;
+          replaced++;
+        }
+      }
+      ok &= std::memcmp(out.view.row(y) + (size_t)x * 8, expected, 8) == 0;
+    }
+  GPHYX_CHECK(ok);
+  GPHYX_CHECK(replaced > 1000);
+
+  // inpaintCoverage marks exactly the replaced pixels.
+  std::vector<uint8_t> coverage(scene.region.area());
+  job.reference = scene.reference.view;
+  job.mask.data = scene.mask.data();
+  job.mask.bytesPerRow = (size_t)scene.region.width();
+  job.mask.width = scene.region.width();
+  job.mask.height = scene.region.height();
+  job.region = scene.region;
+  GPHYX_CHECK(inpaintCoverage(job, coverage.data(),
+                              (size_t)scene.region.width()));
+  int covered = 0;
+  for (uint8_t c : coverage)
+    covered += c == 255 ? 1 : 0;
+  GPHYX_CHECK(covered == replaced);
+}
+
+// Tiles of the destination and source placed anywhere in the image only
+// need to contain the region.
+void testTileOrigins() {
+  const PixelFormat format = PixelFormat::RGBA32F;
+  Scene scene(format);
+  TestImage whole(Scene::kWidth, Scene::kHeight, format, 16);
+  InpaintJob job;
+  makeHomography(2, 0, 0, job.homography);
+  job.sampling = SampleMode::Bilinear;
+  scene.run(job, whole);
+
+  const PixelRect &r = scene.region;
+  TestImage src(r.width() + 3, r.height() + 2, format, 0, r.x0 - 1, r.y0 - 2);
+  TestImage dst(r.width(), r.height(), format, 40, r.x0, r.y0);
+  for (int32_t y = 0; y < src.view.height; y++)
+    std::memcpy(src.view.row(y),
+                scene.source.view.row(y + src.view.originY) +
+                    (size_t)src.view.originX * 16,
+                (size_t)src.view.width * 16);
+  for (int32_t y = 0; y < r.height(); y++)
+    std::memcpy(dst.view.row(y),
+                scene.source.view.row(y + r.y0) + (size_t)r.x0 * 16,
+                (size_t)r.width() * 16);
+  job.source = src.view;
+  job.destination = dst.view;
+  job.reference = scene.reference.view;
+  job.mask.data = scene.mask.data();
+  job.mask.bytesPerRow = (size_t)r.width();
+  job.mask.width = r.width();
+  job.mask.height = r.height();
+  job.region = r;
+  GPHYX_CHECK(inpaintCPU(job));
+  bool same = true;
+  for (int32_t y = 0; y < r.height(); y++)
+    same &= std::memcmp(dst.view.row(y),
+                        whole.view.row(y + r.y0) + (size_t)r.x0 * 16,
+                        (size_t)r.width() * 16) == 0;
+  GPHYX_CHECK(same);
+
+  // A destination tile that doesn't hold the whole region is refused.
+  job.destination.originX += 1;
+  GPHYX_CHECK(!inpaintCPU(job));
+}
+
+void testCancelled() {
+  Scene scene(PixelFormat::BGRA8);
+  TestImage out(Scene::kWidth, Scene::kHeight, PixelFormat::BGRA8, 16);
+  InpaintJob job;
+  job.cancel = CancelToken::make();
+  job.cancel.cancel();
+  std::memcpy(out.bytes.data(), scene.source.bytes.data(),
+              scene.source.bytes.size());
+  job.source = scene.source.view;
+  job.destination = out.view;
+  job.reference = scene.reference.view;
+  job.mask.data = scene.mask.data();
+  job.mask.bytesPerRow = (size_t)scene.region.width();
+  job.mask.width = scene.region.width();
+  job.mask.height = scene.region.height();
+  job.region = scene.region;
+  GPHYX_CHECK(!inpaintCPU(job));
+  GPHYX_CHECK(out.bytes == scene.source.bytes);
+}
+
+} // namespace
+
+int main() {
+  testLanesMatchScalar();
+  testCoverageMatchesScalar();
+  testNearestAgainstDirect();
+  testTileOrigins();
+  testCancelled();
+  return finish("gPHYXInpaintTest");
+}
@@ -0,0 +1,86 @@
+#ifndef gPHYXTest_h
+#define gPHYXTest_h
+
+#include "gPHYXImage.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Just enough harness for the portable core: each test is a main() that runs
+// its checks and returns non-zero if any failed; each benchmark prints the
+// best of a few timed runs.
+namespace gphyx {
+namespace test {
+
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+inline void check(bool ok, const char *expr, const char *file, int line) {
+  if (ok)
+    return;
+  failures()++;
+  std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+}
+
+inline int finish(const char *name) {
+  if (failures())
+    std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+  else
+    std::printf("%s: all checks passed\n", name);
+  return failures() ? 1 : 0;
+}
+
+// Best wall time of `runs` calls of fn(), in milliseconds.
+template <typename Fn> double bestMs(int runs, Fn &&fn) {
+  double best = 1e30;
+  for (int i = 0; i < runs; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> ms =
+        std::chrono::steady_clock::now() - start;
+    if (ms.count() < best)
+      best = ms.count();
+  }
+  return best;
+}
+
+// A heap image with optional padding at the end of each row, placed in
+// image space at (originX, originY).
+struct TestImage {
+  std::vector<uint8_t> bytes;
+  ImageView view;
+
+  TestImage(int32_t width, int32_t height, PixelFormat format,
+            size_t padBytes = 0, int32_t originX = 0, int32_t originY = 0) {
+    view.bytesPerRow = (size_t)width * bytesPerPixel(format) + padBytes;
+    bytes.assign(view.bytesPerRow * (size_t)height, 0);
+    view.data = bytes.data();
+    view.width = width;
+    view.height = height;
+    view.format = format;
+    view.originX = originX;
+    view.originY = originY;
+  }
+  TestImage(const TestImage &) = delete;
+  TestImage &operator=(const TestImage &) = delete;
+};
+
+// Deterministic noise, so runs are repeatable.
+inline uint32_t noise(uint32_t i) {
+  i ^= i >> 16;
+  i *= 0x7feb352du;
+  i ^= i >> 15;
+  i *= 0x846ca68bu;
+  return i ^ (i >> 16);
+}
+
+} // namespace test
+} // namespace gphyx
+
+#define GPHYX_CHECK(expr)                                                      \
+  ::gphyx::test::check((expr), #expr, __FILE__, __LINE__)
+
+#endif
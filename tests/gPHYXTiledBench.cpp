@@ -0,0 +1,75 @@
+#include "gPHYXInpaintCPU.h"
+#include "gPHYXParallel.h"
+#include "gPHYXTest.h"
+#include "gPHYXTiledImage.h"
+#include <cmath>
+#include <cstring>
+
+using namespace gphyx;
+using namespace gphyx::test;
+
+// Reading the captured plate row-major against reading its blocked copy, for a
+// full-frame 4K RGBA16F fill rotated about the centre: small angles walk the
+// rows, larger ones cut across them. The two must fill the same pixels.
+namespace {
+
+const int32_t kWidth = 3840;
+const int32_t kHeight = 2160;
+const PixelFormat kFormat = PixelFormat::RGBA16F;
+const int kRuns = 3;
+
+} // namespace
+
+int main() {
+  TestImage source(kWidth, kHeight, kFormat);
+  TestImage reference(kWidth, kHeight, kFormat);
+  TestImage linear(kWidth, kHeight, kFormat);
+  TestImage tiled(kWidth, kHeight, kFormat);
+  for (size_t i = 0; i < reference.bytes.size(); i++)
+    reference.bytes[i] = (uint8_t)(noise((uint32_t)i) & 0x3b); // finite
+  std::vector<uint8_t> mask((size_t)kWidth * kHeight, 255);
+
+  TiledImage blocks;
+  std::printf("4K RGBA16F, %u thread(s)\n", hardwareThreads());
+  std::printf("tileImage %.1f ms\n",
+              bestMs(kRuns, [&] { tileImage(reference.view, blocks); }));
+
+  InpaintJob job;
+  job.source = source.view;
+  job.reference = reference.view;
+  job.mask.data = mask.data();
+  job.mask.bytesPerRow = (size_t)kWidth;
+  job.mask.width = kWidth;
+  job.mask.height = kHeight;
+  job.region = makePixelRect(0, 0, kWidth, kHeight);
+
+  const char *modes[] = {"nearest", "bilinear", "bicubic"};
+  bool same = true;
+  for (int mode = 0; mode < 3; mode++) {
+    job.sampling = (SampleMode)mode;
+    for (float degrees : {0.0f, 3.0f, 10.0f, 15.0f, 45.0f, 90.0f}) {
+      const float a = degrees * 3.14159265f / 180.0f;
+      const float cx = kWidth / 2.0f, cy = kHeight / 2.0f;
+      const float c = std::cos(a), s = std::sin(a);
+      const float h[9] = {c, s, 0, -s, c, 0, cx - c * cx + s * cy,
+                          cy - s * cx - c * cy, 1};
+      std::memcpy(job.homography, h, sizeof(h));
+
+      job.destination = linear.view;
+      job.tiledReference = nullptr;
+      inpaintCPU(job); // fault the pages in
+      const double linearMs = bestMs(kRuns, [&] { inpaintCPU(job); });
+      job.destination = tiled.view;
+      job.tiledReference = &blocks;
+      inpaintCPU(job);
+      const double tiledMs = bestMs(kRuns, [&] { inpaintCPU(job); });
+
+      const bool match = linear.bytes == tiled.bytes;
+      same &= match;
+      std::printf("%-8s %4.0f deg  linear %7.1f ms  tiled %7.1f ms  x%.2f%s\n",
+                  modes[mode], degrees, linearMs, tiledMs, linearMs / tiledMs,
+                  match ? "" : "  MISMATCH");
+    }
+  }
+  return same ? 0 : 1;
+}